@@ -0,0 +1,126 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* cost per packet of the delay and reorder ferry queues at large delay x rate */
+
+/* Each run offers packets at a fixed rate to a DelayQueue (or a
+   ReorderQueue) and lets
+   them out the way the ferry does: write_packets() whenever the next
+   event is due. The clock is virtual, so the queue holds rate x delay
+   packets on every machine, and the time measured is the queue's own
+   work (including reading the clock). Runs with jitter or reordering
+   use a fixed seed, so every run reorders the same packets. */
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+
+#include "delay_queue.hh"
+#include "reorder_queue.hh"
+#include "timestamp.hh"
+#include "exception.hh"
+#include "ezio.hh"
+
+using namespace std;
+
+class CountingSink : public PacketSink
+{
+public:
+    uint64_t packets = 0;
+
+    void send( const PacketBuffer & ) override { packets++; }
+};
+
+struct Measurement
+{
+    double ns_per_packet;
+    uint64_t wakeups; /* write_packets() calls */
+    uint64_t delivered;
+};
+
+template <class QueueFactory>
+static Measurement measure( const uint64_t delay_ms, const uint64_t packets_per_second,
+                            QueueFactory && make_queue, const uint64_t packets )
+{
+    const PacketBuffer packet( string( 1500, 'x' ) );
+    const uint64_t gap_ns = 1000000000 / packets_per_second;
+
+    uint64_t now_ns = 0;
+    set_virtual_clock( now_ns );
+
+    auto queue = make_queue();
+    CountingSink sink;
+    uint64_t wakeups = 0;
+
+    const auto run = [&] ( const uint64_t count ) {
+        for ( uint64_t i = 0; i < count; i++ ) {
+            queue.read_packet( packet );
+            if ( queue.pending_output() ) {
+                queue.write_packets( sink );
+                wakeups++;
+            }
+
+            /* the timer goes off for every event before the next arrival */
+            now_ns += gap_ns;
+            while ( queue.next_event_time() != uint64_t( -1 ) and queue.next_event_time() * 1000 <= now_ns ) {
+                set_virtual_clock( queue.next_event_time() * 1000 );
+                queue.write_packets( sink );
+                wakeups++;
+            }
+            set_virtual_clock( now_ns );
+        }
+    };
+
+    /* fill to rate x delay, then measure in steady state */
+    run( delay_ms * packets_per_second / 1000 );
+    const uint64_t wakeups_before = wakeups, delivered_before = sink.packets;
+
+    const auto start = chrono::steady_clock::now();
+    run( packets );
+    const auto elapsed = chrono::steady_clock::now() - start;
+
+    return { chrono::duration_cast<chrono::nanoseconds>( elapsed ).count() / double( packets ),
+             wakeups - wakeups_before, sink.packets - delivered_before };
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        uint64_t packets = 1000000;
+        if ( argc == 2 ) {
+            packets = myatoi( argv[ 1 ] );
+        } else if ( argc != 1 ) {
+            throw runtime_error( "Usage: " + string( argv[ 0 ] ) + " [packets]" );
+        }
+
+        /* tab-separated, one line per measurement */
+        cout << "stage\tdelay_ms\tpackets_per_second\tqueued\tns_per_packet\twakeups\tdelivered" << endl;
+
+        const auto report = [&] ( const string & stage, const uint64_t delay_ms, const uint64_t packets_per_second,
+                                  const Measurement & m ) {
+            cout << stage << "\t" << delay_ms << "\t" << packets_per_second
+                 << "\t" << delay_ms * packets_per_second / 1000
+                 << "\t" << m.ns_per_packet << "\t" << m.wakeups << "\t" << m.delivered << endl;
+        };
+
+        for ( const uint64_t delay_ms : { 1, 30, 300 } ) {
+            /* 1500-byte packets at about 12 Mbit/s, 1 Gbit/s and 10 Gbit/s */
+            for ( const uint64_t packets_per_second : { 1000, 83333, 833333 } ) {
+                report( "delay", delay_ms, packets_per_second,
+                        measure( delay_ms, packets_per_second,
+                                 [&] { return DelayQueue( delay_ms ); }, packets ) );
+                report( "delay jitter=normal:1", delay_ms, packets_per_second,
+                        measure( delay_ms, packets_per_second,
+                                 [&] { return DelayQueue( delay_ms, "", "normal:1", false, 1 ); }, packets ) );
+                report( "reorder reorder=0.25 gap=5 duplicate=0.01", delay_ms, packets_per_second,
+                        measure( delay_ms, packets_per_second,
+                                 [&] { return ReorderQueue( delay_ms, 0.25, 5, 0.01, 1 ); }, packets ) );
+            }
+        }
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* cost of one Poller iteration as the number of watched fds grows */
+
+/* Each run watches n pipes for input. One of them always has a byte
+   waiting (its callback reads the byte and writes it back), so every
+   poll() returns at once and services exactly one Action; the other
+   n - 1 pipes stay idle, as most of an EventLoop's handlers do. With
+   --predicates, every Action also has a when_interested() function. */
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "poller.hh"
+#include "exception.hh"
+#include "ezio.hh"
+
+using namespace std;
+using namespace PollerShortNames;
+
+static double nanoseconds_per_iteration( const Poller::Backend backend, const unsigned int fd_count,
+                                         const bool predicates, const unsigned int iterations )
+{
+    vector< pair< unique_ptr<FileDescriptor>, unique_ptr<FileDescriptor> > > pipes;
+    for ( unsigned int i = 0; i < fd_count; i++ ) {
+        int fds[ 2 ];
+        SystemCall( "pipe", pipe( fds ) );
+        pipes.emplace_back( unique_ptr<FileDescriptor>( new FileDescriptor( fds[ 0 ] ) ),
+                            unique_ptr<FileDescriptor>( new FileDescriptor( fds[ 1 ] ) ) );
+    }
+
+    Poller poller( backend );
+    if ( poller.backend() != backend ) {
+        return -1; /* not supported here */
+    }
+
+    FileDescriptor & busy_reader = *pipes.front().first;
+    FileDescriptor & busy_writer = *pipes.front().second;
+    busy_writer.write( "x" );
+
+    for ( auto & x : pipes ) {
+        FileDescriptor & reader = *x.first;
+        const auto callback = [&] () {
+            busy_writer.write( reader.read( 1 ) );
+            return ResultType::Continue;
+        };
+
+        if ( predicates ) {
+            poller.add_action( Poller::Action( reader, Direction::In, callback, [] () { return true; } ) );
+        } else {
+            poller.add_action( Poller::Action( reader, Direction::In, callback ) );
+        }
+    }
+
+    /* warm up (registers everything with epoll or io_uring) */
+    for ( unsigned int i = 0; i < 100; i++ ) {
+        poller.poll( -1 );
+    }
+
+    const auto start = chrono::steady_clock::now();
+    for ( unsigned int i = 0; i < iterations; i++ ) {
+        poller.poll( -1 );
+    }
+    const auto elapsed = chrono::steady_clock::now() - start;
+
+    if ( busy_reader.read_count() < iterations ) {
+        throw runtime_error( "poller-bench: busy pipe was not serviced every iteration" );
+    }
+
+    return chrono::duration_cast<chrono::nanoseconds>( elapsed ).count() / double( iterations );
+}
+
+static void raise_fd_limit( void )
+{
+    rlimit limit;
+    SystemCall( "getrlimit", getrlimit( RLIMIT_NOFILE, &limit ) );
+    limit.rlim_cur = limit.rlim_max;
+    SystemCall( "setrlimit", setrlimit( RLIMIT_NOFILE, &limit ) );
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        bool predicates = false;
+        unsigned int iterations = 20000;
+        for ( int i = 1; i < argc; i++ ) {
+            if ( string( argv[ i ] ) == "--predicates" ) {
+                predicates = true;
+            } else if ( argv[ i ][ 0 ] != '-' ) {
+                iterations = myatoi( argv[ i ] );
+            } else {
+                throw runtime_error( "Usage: " + string( argv[ 0 ] ) + " [--predicates] [iterations]" );
+            }
+        }
+
+        raise_fd_limit();
+
+        const vector< pair< string, Poller::Backend > > backends = {
+            { "poll", Poller::Backend::Poll },
+            { "epoll", Poller::Backend::Epoll },
+            { "io_uring", Poller::Backend::IOUring } };
+
+        /* tab-separated, one line per measurement */
+        cout << "backend\tfds\tpredicates\tns_per_iteration" << endl;
+
+        for ( const unsigned int fd_count : { 1, 4, 16, 64, 256, 1024 } ) {
+            for ( const auto & backend : backends ) {
+                const double ns = nanoseconds_per_iteration( backend.second, fd_count, predicates, iterations );
+                cout << backend.first << "\t" << fd_count << "\t" << predicates << "\t";
+                if ( ns < 0 ) {
+                    cout << "unsupported" << endl;
+                } else {
+                    cout << static_cast<unsigned long>( ns ) << endl;
+                }
+            }
+        }
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,251 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* cost of enqueue and dequeue for each packet queue discipline */
+
+/* Each run fills a queue to a given occupancy with packets of one
+   size spread over some number of UDP flows (ECMP and the fair queue
+   hash the 5-tuple), then times enqueue/dequeue pairs, which
+   hold the occupancy steady. The clock is virtual and advances 1 us
+   per pair, so the AQMs see the same sojourn times on every machine.
+   A counting operator new reports heap allocations per pair (a queue
+   should make none in steady state) and the heap each queued packet
+   costs beyond its shared buffer. */
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <new>
+#include <cstdlib>
+
+#include <malloc.h>
+
+#include "packet_queue_factory.hh"
+#include "timestamp.hh"
+#include "exception.hh"
+#include "ezio.hh"
+
+using namespace std;
+
+static uint64_t allocations = 0;
+static int64_t heap_bytes = 0;
+
+void * operator new( size_t size )
+{
+    void * ret = malloc( size );
+    if ( not ret ) {
+        throw bad_alloc();
+    }
+    allocations++;
+    heap_bytes += malloc_usable_size( ret );
+    return ret;
+}
+
+/* not inlined, or g++ warns that free() releases memory from operator new */
+__attribute__(( noinline )) void operator delete( void * ptr ) noexcept
+{
+    if ( ptr ) {
+        heap_bytes -= malloc_usable_size( ptr );
+        free( ptr );
+    }
+}
+
+void operator delete( void * ptr, size_t ) noexcept
+{
+    operator delete( ptr );
+}
+
+struct Measurement
+{
+    double ns_per_pair;
+    uint64_t enqueue_p50, enqueue_p99, dequeue_p50, dequeue_p99; /* ns */
+    double allocations_per_pair;
+    double heap_bytes_per_packet;
+    unsigned int final_occupancy; /* below the target if the queue dropped or held back packets */
+    uint64_t empty_dequeues;
+};
+
+static string queue_args( const string & type, const unsigned int occupancy )
+{
+    /* roomy enough that only the AQMs ever drop */
+    const string limit = "packets=" + to_string( 2 * occupancy + 64 );
+
+    if ( type == "infinite" ) {
+        return "";
+    } else if ( type == "codel" ) {
+        return limit + ",target=5,interval=100";
+    } else if ( type == "pie" ) {
+        return limit + ",qdelay_ref=20,max_burst=100";
+    } else if ( type == "ecmp" ) {
+        return limit + ",queues=16";
+    } else if ( type == "akshayfq" ) {
+        return limit + ",queues=1024";
+    } else if ( type == "fq_codel" ) {
+        return limit + ",flows=1024,target=5,interval=100";
+    } else if ( type == "drr" ) {
+        return limit + ",flows=1024";
+    }
+
+    return limit;
+}
+
+/* one UDP-over-IPv4 TUN frame per flow; queued packets share them */
+static vector<PacketBuffer> make_flows( const unsigned int packet_size, const unsigned int flow_count )
+{
+    vector<PacketBuffer> flows;
+    for ( unsigned int i = 0; i < flow_count; i++ ) {
+        string contents( packet_size, 0 );
+        const uint16_t src_port = 1024 + i, dst_port = 443;
+        contents[ 2 ] = 0x08; /* ETH_P_IP */
+        contents[ 4 ] = 0x45; /* version 4, 20-byte header */
+        contents[ 13 ] = 17; /* UDP */
+        contents[ 24 ] = char( src_port >> 8 );
+        contents[ 25 ] = char( src_port & 0xff );
+        contents[ 26 ] = char( dst_port >> 8 );
+        contents[ 27 ] = char( dst_port & 0xff );
+        flows.emplace_back( contents );
+    }
+
+    return flows;
+}
+
+static uint64_t percentile( vector<uint64_t> & samples, const double q )
+{
+    const size_t i = min( samples.size() - 1, size_t( q * samples.size() ) );
+    nth_element( samples.begin(), samples.begin() + i, samples.end() );
+    return samples[ i ];
+}
+
+static Measurement measure( const string & type, const unsigned int packet_size,
+                            const unsigned int flow_count, const unsigned int occupancy,
+                            const unsigned int iterations )
+{
+    Measurement ret {};
+
+    const vector<PacketBuffer> flows = make_flows( packet_size, flow_count );
+    vector<uint64_t> enqueue_ns( iterations ), dequeue_ns( iterations );
+
+    uint64_t now = 0; /* us */
+    set_virtual_clock( 0 );
+
+    const string args = queue_args( type, occupancy );
+    unique_ptr<AbstractPacketQueue> queue = make_packet_queue( type, args );
+    if ( not queue ) {
+        throw runtime_error( "queue-bench: unknown queue type " + type );
+    }
+
+    unsigned int next_flow = 0;
+    const auto enqueue_one = [&] () {
+        queue->enqueue( QueuedPacket( flows[ next_flow ], now ) );
+        next_flow = ( next_flow + 1 ) % flow_count;
+    };
+
+    const auto tick = [&] () {
+        now++;
+        set_virtual_clock( now * 1000 );
+    };
+
+    /* fill */
+    const int64_t heap_before_fill = heap_bytes;
+    for ( unsigned int i = 0; i < occupancy; i++ ) {
+        enqueue_one();
+        tick();
+    }
+    ret.heap_bytes_per_packet = double( heap_bytes - heap_before_fill ) / occupancy;
+
+    /* warm up, then throughput */
+    for ( unsigned int i = 0; i < iterations / 10; i++ ) {
+        enqueue_one();
+        queue->dequeue();
+        tick();
+    }
+
+    const uint64_t allocations_before = allocations;
+    const auto start = chrono::steady_clock::now();
+    for ( unsigned int i = 0; i < iterations; i++ ) {
+        enqueue_one();
+        if ( queue->dequeue().contents.empty() ) {
+            ret.empty_dequeues++;
+        }
+        tick();
+    }
+    const auto elapsed = chrono::steady_clock::now() - start;
+
+    ret.ns_per_pair = chrono::duration_cast<chrono::nanoseconds>( elapsed ).count() / double( iterations );
+    ret.allocations_per_pair = double( allocations - allocations_before ) / iterations;
+
+    /* latency of each operation, including the cost of reading the clock */
+    for ( unsigned int i = 0; i < iterations; i++ ) {
+        const auto t0 = chrono::steady_clock::now();
+        enqueue_one();
+        const auto t1 = chrono::steady_clock::now();
+        queue->dequeue();
+        const auto t2 = chrono::steady_clock::now();
+        tick();
+
+        enqueue_ns[ i ] = chrono::duration_cast<chrono::nanoseconds>( t1 - t0 ).count();
+        dequeue_ns[ i ] = chrono::duration_cast<chrono::nanoseconds>( t2 - t1 ).count();
+    }
+
+    ret.enqueue_p50 = percentile( enqueue_ns, 0.5 );
+    ret.enqueue_p99 = percentile( enqueue_ns, 0.99 );
+    ret.dequeue_p50 = percentile( dequeue_ns, 0.5 );
+    ret.dequeue_p99 = percentile( dequeue_ns, 0.99 );
+    ret.final_occupancy = queue->size_packets();
+
+    return ret;
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        unsigned int iterations = 100000;
+        vector<string> types;
+        for ( int i = 1; i < argc; i++ ) {
+            const string arg = argv[ i ];
+            if ( arg.substr( 0, 8 ) == "--queue=" ) {
+                types.push_back( arg.substr( 8 ) );
+            } else if ( argv[ i ][ 0 ] != '-' ) {
+                iterations = myatoi( arg );
+            } else {
+                throw runtime_error( "Usage: " + string( argv[ 0 ] ) + " [--queue=TYPE]... [iterations]" );
+            }
+        }
+
+        if ( iterations == 0 ) {
+            throw runtime_error( "queue-bench: iterations must be positive" );
+        }
+
+        if ( types.empty() ) {
+            types = { "infinite", "droptail", "drophead", "codel", "pie", "ecmp", "akshayfq", "drr", "fq_codel", "dualpi2" };
+        }
+
+        /* tab-separated, one line per measurement */
+        cout << "queue\tpacket_size\tflows\toccupancy\tns_per_pair"
+             << "\tenqueue_p50_ns\tenqueue_p99_ns\tdequeue_p50_ns\tdequeue_p99_ns"
+             << "\tallocations_per_pair\theap_bytes_per_packet\tfinal_occupancy\tempty_dequeues" << endl;
+
+        for ( const auto & type : types ) {
+            for ( const unsigned int packet_size : { 64, 576, 1500 } ) {
+                for ( const unsigned int flow_count : { 1, 16, 256 } ) {
+                    for ( const unsigned int occupancy : { 1, 100, 1000 } ) {
+                        const Measurement m = measure( type, packet_size, flow_count, occupancy, iterations );
+                        cout << type << "\t" << packet_size << "\t" << flow_count << "\t" << occupancy
+                             << "\t" << m.ns_per_pair
+                             << "\t" << m.enqueue_p50 << "\t" << m.enqueue_p99
+                             << "\t" << m.dequeue_p50 << "\t" << m.dequeue_p99
+                             << "\t" << m.allocations_per_pair << "\t" << m.heap_bytes_per_packet
+                             << "\t" << m.final_occupancy << "\t" << m.empty_dequeues << endl;
+                    }
+                }
+            }
+        }
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,359 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* summarize an mm-link log (text or binary) in one pass, as CSV and SVG */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <thread>
+#include <functional>
+#include <getopt.h>
+
+#include "log_analysis.hh"
+#include "exception.hh"
+#include "ezio.hh"
+
+using namespace std;
+
+void usage_error( const string & program_name )
+{
+    cerr << "Usage: " << program_name << " [OPTION]... LOGFILE" << endl;
+    cerr << endl;
+    cerr << "Options = --bin=MS (default 500)" << endl;
+    cerr << "          --csv=FILENAME (throughput, capacity and delay per bin)" << endl;
+    cerr << "          --flows=FILENAME (statistics per src:dst flow)" << endl;
+    cerr << "          --svg=FILENAME (graphs of throughput and delay)" << endl;
+    cerr << "          --threads=N (default: one per core)" << endl;
+
+    throw runtime_error( "invalid arguments" );
+}
+
+static void write_file( const string & filename, const function<void(ostream &)> & writer )
+{
+    ofstream out( filename );
+    if ( not out.good() ) {
+        throw runtime_error( filename + ": error opening for writing" );
+    }
+
+    writer( out );
+
+    out.close();
+    if ( out.fail() ) {
+        throw runtime_error( filename + ": error writing" );
+    }
+}
+
+static double bin_seconds( const LogAnalysis & analysis, const int64_t bin )
+{
+    return bin * int64_t( analysis.ms_per_bin() ) / 1000.0;
+}
+
+static double bin_mbps( const LogAnalysis & analysis, const uint64_t bits )
+{
+    return bits / ( analysis.ms_per_bin() / 1000.0 ) / 1000000.0;
+}
+
+static void write_bins( const LogAnalysis & analysis, ostream & out )
+{
+    const auto & bins = analysis.bins();
+
+    /* buffer occupancy is accumulated as in mm-throughput-graph */
+    int64_t queue_bits = 0;
+
+    out << "time_s,capacity_mbps,ingress_mbps,egress_mbps,queue_bits,departures,mean_delay_ms,max_delay_ms\n";
+    for ( int64_t i = bins.first(); i <= bins.last(); i++ ) {
+        const LogAnalysis::Bin & bin = bins[ i ];
+        queue_bits += int64_t( bin.arrivals ) - int64_t( bin.departures );
+
+        out << fixed << setprecision( 3 ) << bin_seconds( analysis, i ) << ","
+            << setprecision( 6 ) << bin_mbps( analysis, bin.capacity ) << ","
+            << bin_mbps( analysis, bin.arrivals ) << ","
+            << bin_mbps( analysis, bin.departures ) << ","
+            << queue_bits << ","
+            << bin.departed_packets << ",";
+        if ( bin.departed_packets ) {
+            out << setprecision( 3 ) << double( bin.delay_sum ) / bin.departed_packets << "," << bin.delay_max;
+        } else {
+            out << ",";
+        }
+        out << "\n";
+    }
+}
+
+static void write_flows( const LogAnalysis & analysis, ostream & out )
+{
+    /* busiest flows first */
+    vector< pair<uint32_t, const LogAnalysis::Flow *> > flows;
+    for ( const auto & x : analysis.flows() ) {
+        flows.emplace_back( x.first, &x.second );
+    }
+    sort( flows.begin(), flows.end(), [] ( const pair<uint32_t, const LogAnalysis::Flow *> & a,
+                                           const pair<uint32_t, const LogAnalysis::Flow *> & b ) {
+              return a.second->departed_bytes != b.second->departed_bytes
+                  ? a.second->departed_bytes > b.second->departed_bytes : a.first < b.first; } );
+
+    out << "flow,arrived_packets,arrived_bytes,departed_packets,departed_bytes,duration_s,throughput_mbps,"
+        << "delay_p50_ms,delay_p95_ms,delay_p99_ms,delay_max_ms\n";
+    for ( const auto & x : flows ) {
+        const LogAnalysis::Flow & flow = *x.second;
+        const int64_t duration = flow.last_event - flow.first_event;
+
+        out << ( x.first >> 16 ) << ":" << ( x.first & 0xffff ) << ","
+            << flow.arrived_packets << "," << flow.arrived_bytes << ","
+            << flow.departed_packets << "," << flow.departed_bytes << ","
+            << fixed << setprecision( 3 ) << duration / 1000.0 << ","
+            << setprecision( 6 ) << ( duration > 0 ? flow.departed_bytes * 8.0 / duration / 1000.0 : 0 ) << ",";
+        if ( flow.delays.count() ) {
+            out << flow.delays.quantile( 0.5 ) << "," << flow.delays.quantile( 0.95 ) << ","
+                << flow.delays.quantile( 0.99 ) << "," << flow.delays.max();
+        } else {
+            out << ",,,";
+        }
+        out << "\n";
+    }
+}
+
+/* SVG graphs, styled after mm-throughput-graph and mm-delay-graph */
+
+static const double WIDTH = 1024, PANEL_HEIGHT = 280, MARGIN_LEFT = 70, MARGIN_RIGHT = 20,
+    MARGIN_TOP = 40, MARGIN_BOTTOM = 40;
+
+/* round tick spacing for an axis that spans range */
+static double tick_spacing( const double range )
+{
+    const double raw = range / 8;
+    const double magnitude = pow( 10, floor( log10( raw ) ) );
+    for ( const double step : { 1.0, 2.0, 5.0 } ) {
+        if ( step * magnitude >= raw ) {
+            return step * magnitude;
+        }
+    }
+    return 10 * magnitude;
+}
+
+class Panel
+{
+private:
+    ostream & out_;
+    double top_, x_min_, x_max_, y_max_;
+
+public:
+    Panel( ostream & out, const double top, const double x_min, const double x_max, const double y_max,
+           const string & y_label )
+        : out_( out ), top_( top ), x_min_( x_min ), x_max_( x_max > x_min ? x_max : x_min + 1 ),
+          y_max_( y_max > 0 ? y_max : 1 )
+    {
+        const double bottom = top_ + PANEL_HEIGHT;
+
+        out_ << "<rect x='" << MARGIN_LEFT << "' y='" << top_ << "' width='" << WIDTH - MARGIN_LEFT - MARGIN_RIGHT
+             << "' height='" << PANEL_HEIGHT << "' fill='none' stroke='#000'/>\n";
+
+        const double x_step = tick_spacing( x_max_ - x_min_ );
+        for ( double t = ceil( x_min_ / x_step ) * x_step; t <= x_max_; t += x_step ) {
+            out_ << "<text x='" << x( t ) << "' y='" << bottom + 16 << "' text-anchor='middle'>" << t << "</text>\n";
+        }
+        out_ << "<text x='" << ( MARGIN_LEFT + WIDTH - MARGIN_RIGHT ) / 2 << "' y='" << bottom + 34
+             << "' text-anchor='middle'>time (s)</text>\n";
+
+        const double y_step = tick_spacing( y_max_ );
+        for ( double v = 0; v <= y_max_; v += y_step ) {
+            out_ << "<text x='" << MARGIN_LEFT - 6 << "' y='" << y( v ) + 4 << "' text-anchor='end'>" << v << "</text>\n";
+            out_ << "<line x1='" << MARGIN_LEFT << "' x2='" << WIDTH - MARGIN_RIGHT << "' y1='" << y( v ) << "' y2='"
+                 << y( v ) << "' stroke='#ddd'/>\n";
+        }
+        out_ << "<text transform='translate(16," << top_ + PANEL_HEIGHT / 2 << ") rotate(-90)' text-anchor='middle'>"
+             << y_label << "</text>\n";
+    }
+
+    double x( const double t ) const
+    {
+        return MARGIN_LEFT + ( t - x_min_ ) / ( x_max_ - x_min_ ) * ( WIDTH - MARGIN_LEFT - MARGIN_RIGHT );
+    }
+
+    double y( const double v ) const
+    {
+        return top_ + PANEL_HEIGHT - min( v, y_max_ ) / y_max_ * PANEL_HEIGHT;
+    }
+
+    void legend( const unsigned int index, const string & color, const string & text )
+    {
+        const double left = MARGIN_LEFT + index * 320;
+        out_ << "<rect x='" << left << "' y='" << top_ - 24 << "' width='20' height='10' fill='" << color << "'/>\n";
+        out_ << "<text x='" << left + 26 << "' y='" << top_ - 15 << "'>" << text << "</text>\n";
+    }
+
+    /* a line (or, if filled, an area down to zero) through points */
+    void plot( const vector< pair<double, double> > & points, const string & color, const double width,
+               const bool filled )
+    {
+        if ( points.empty() ) {
+            return;
+        }
+
+        out_ << "<polyline fill='" << ( filled ? color : "none" ) << "' fill-opacity='0.2' stroke='" << color
+             << "' stroke-width='" << width << "' points='";
+        if ( filled ) {
+            out_ << x( points.front().first ) << "," << y( 0 ) << " ";
+        }
+        for ( const auto & p : points ) {
+            out_ << x( p.first ) << "," << y( p.second ) << " ";
+        }
+        if ( filled ) {
+            out_ << x( points.back().first ) << "," << y( 0 );
+        }
+        out_ << "'/>\n";
+    }
+};
+
+static string two_decimals( const double value )
+{
+    ostringstream ret;
+    ret << fixed << setprecision( 2 ) << value;
+    return ret.str();
+}
+
+static void write_svg( const LogAnalysis & analysis, ostream & out )
+{
+    const auto & bins = analysis.bins();
+    const double start = analysis.first_timestamp() / 1000.0, end = analysis.last_timestamp() / 1000.0;
+
+    vector< pair<double, double> > capacity, ingress, egress, mean_delay, max_delay;
+    double max_rate = 0, highest_delay = 0;
+    for ( int64_t i = bins.first(); i <= bins.last(); i++ ) {
+        const LogAnalysis::Bin & bin = bins[ i ];
+        const double t = bin_seconds( analysis, i );
+        capacity.emplace_back( t, bin_mbps( analysis, bin.capacity ) );
+        ingress.emplace_back( t, bin_mbps( analysis, bin.arrivals ) );
+        egress.emplace_back( t, bin_mbps( analysis, bin.departures ) );
+        max_rate = max( { max_rate, capacity.back().second, ingress.back().second, egress.back().second } );
+
+        if ( bin.departed_packets ) {
+            mean_delay.emplace_back( t, double( bin.delay_sum ) / bin.departed_packets );
+            max_delay.emplace_back( t, bin.delay_max );
+            highest_delay = max( highest_delay, double( bin.delay_max ) );
+        }
+    }
+
+    const double height = MARGIN_TOP + 2 * ( PANEL_HEIGHT + MARGIN_TOP + MARGIN_BOTTOM );
+    out << "<?xml version='1.0' encoding='UTF-8'?>\n"
+        << "<svg xmlns='http://www.w3.org/2000/svg' width='" << WIDTH << "' height='" << height
+        << "' font-family='Arial' font-size='12'>\n"
+        << "<rect width='100%' height='100%' fill='#fff'/>\n";
+
+    Panel throughput( out, MARGIN_TOP, start, end, max_rate * 1.1, "throughput (Mbits/s)" );
+    throughput.plot( capacity, "#808080", 0.5, true );
+    throughput.plot( ingress, "#0020a0", 2, false );
+    throughput.plot( egress, "#ff6040", 1.5, false );
+    throughput.legend( 0, "#808080", "Capacity (mean " + two_decimals( analysis.average_capacity() ) + " Mbits/s)" );
+    throughput.legend( 1, "#0020a0", "Traffic ingress (mean " + two_decimals( analysis.average_ingress() ) + " Mbits/s)" );
+    throughput.legend( 2, "#ff6040", "Traffic egress (mean " + two_decimals( analysis.average_throughput() ) + " Mbits/s)" );
+
+    Panel delay( out, 2 * MARGIN_TOP + PANEL_HEIGHT + MARGIN_BOTTOM, start, end, highest_delay * 1.1,
+                 "queueing delay (ms)" );
+    delay.plot( max_delay, "#ff0000", 1, false );
+    delay.plot( mean_delay, "#0000ff", 1.5, false );
+    if ( analysis.delays().count() ) {
+        const double p95 = analysis.delays().quantile( 0.95 );
+        delay.plot( { { start, p95 }, { end, p95 } }, "#800000", 2, false );
+        delay.legend( 2, "#800000", "95th percentile per-packet delay (" + to_string( uint64_t( p95 ) ) + " ms)" );
+    }
+    delay.legend( 0, "#ff0000", "Maximum per-packet delay" );
+    delay.legend( 1, "#0000ff", "Mean per-packet delay" );
+
+    out << "</svg>\n";
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        if ( argc < 1 ) {
+            throw runtime_error( "missing argv[ 0 ]" );
+        }
+
+        const option command_line_options[] = {
+            { "bin",     required_argument, nullptr, 'b' },
+            { "csv",     required_argument, nullptr, 'c' },
+            { "flows",   required_argument, nullptr, 'f' },
+            { "svg",     required_argument, nullptr, 's' },
+            { "threads", required_argument, nullptr, 't' },
+            { 0,                         0, nullptr, 0 }
+        };
+
+        uint64_t ms_per_bin = 500;
+        string csv_filename, flows_filename, svg_filename;
+        unsigned int threads = max( 1u, thread::hardware_concurrency() );
+
+        while ( true ) {
+            const int opt = getopt_long( argc, argv, "", command_line_options, nullptr );
+            if ( opt == -1 ) { /* end of options */
+                break;
+            }
+
+            switch ( opt ) {
+            case 'b':
+                ms_per_bin = myatoi( optarg );
+                break;
+            case 'c':
+                csv_filename = optarg;
+                break;
+            case 'f':
+                flows_filename = optarg;
+                break;
+            case 's':
+                svg_filename = optarg;
+                break;
+            case 't':
+                threads = myatoi( optarg );
+                break;
+            default:
+                usage_error( argv[ 0 ] );
+            }
+        }
+
+        if ( optind + 1 != argc or threads == 0 ) {
+            usage_error( argv[ 0 ] );
+        }
+
+        const LogAnalysis analysis = analyze_log( argv[ optind ], ms_per_bin, threads );
+
+        if ( not analysis.have_events() ) {
+            throw runtime_error( "Must have at least one event" );
+        }
+
+        const DelaySketch signal_delays = analysis.signal_delays();
+
+        cerr << fixed << setprecision( 2 );
+        cerr << "Average capacity: " << analysis.average_capacity() << " Mbits/s" << endl;
+        cerr << "Average throughput: " << analysis.average_throughput() << " Mbits/s ("
+             << setprecision( 1 ) << 100.0 * analysis.average_throughput() / analysis.average_capacity()
+             << "% utilization)" << endl;
+        if ( analysis.delays().count() ) {
+            cerr << "50th percentile per-packet queueing delay: " << analysis.delays().quantile( 0.5 ) << " ms" << endl;
+            cerr << "95th percentile per-packet queueing delay: " << analysis.delays().quantile( 0.95 ) << " ms" << endl;
+            cerr << "95th percentile signal delay: " << signal_delays.quantile( 0.95 ) << " ms" << endl;
+        }
+        if ( analysis.have_summary() ) {
+            cerr << "Queue drops: " << analysis.drops() << ", CE marks: " << analysis.marks() << endl;
+        }
+        cerr << "Flows: " << analysis.flows().size() << endl;
+
+        if ( not csv_filename.empty() ) {
+            write_file( csv_filename, [&] ( ostream & out ) { write_bins( analysis, out ); } );
+        }
+
+        if ( not flows_filename.empty() ) {
+            write_file( flows_filename, [&] ( ostream & out ) { write_flows( analysis, out ); } );
+        }
+
+        if ( not svg_filename.empty() ) {
+            write_file( svg_filename, [&] ( ostream & out ) { write_svg( analysis, out ); } );
+        }
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,589 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* forwarding rate, CPU cost and added delay of a chain of mahimahi shells */
+
+/* mm-bench runs the chain with a copy of itself (the source) as the
+   innermost command. The source sends to a sink in mm-bench, outside
+   the chain at MAHIMAHI_BASE: first a paced phase, to measure delay,
+   then a flood, to measure the most packets per second the chain
+   forwards, then a few Done records with what it sent. The source and
+   sink are on one machine and stamp packets with CLOCK_MONOTONIC, so
+   one-way delay needs no clock synchronization. */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <cstring>
+#include <ctime>
+#include <getopt.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/tcp.h>
+
+#include "socket.hh"
+#include "child_process.hh"
+#include "socketpair.hh"
+#include "system_runner.hh"
+#include "perf_counters.hh"
+#include "timestamp.hh"
+#include "exception.hh"
+#include "ezio.hh"
+#include "util.hh"
+
+using namespace std;
+
+void usage_error( const string & program_name )
+{
+    cerr << "Usage: " << program_name << " [OPTION]... COMMAND..." << endl;
+    cerr << endl;
+    cerr << "Options = --tcp" << endl;
+    cerr << "          --size=BYTES (default 1000)" << endl;
+    cerr << "          --rate=PACKETS-PER-SECOND (paced phase, default 1000)" << endl;
+    cerr << "          --duration=SECONDS (of each phase, default 2)" << endl;
+    cerr << "          --delay=MS (one-way delay of the chain as configured, default 0)" << endl;
+    cerr << "          --runs=N (default 3)" << endl;
+    cerr << "          --perf" << endl;
+    cerr << endl;
+    cerr << "          COMMAND is a chain of shells, e.g. \"mm-delay 10 mm-loss uplink 0\"" << endl;
+
+    throw runtime_error( "invalid arguments" );
+}
+
+enum class Phase : uint8_t { Paced, Flood, Done };
+
+/* the start of every datagram (or TCP message) from the source */
+struct BenchRecord
+{
+    static const uint32_t MAGIC = 0x6d6d626e;
+
+    uint32_t magic;
+    uint32_t source_pid;
+    uint64_t seq; /* within the phase */
+    uint64_t send_ns; /* CLOCK_MONOTONIC */
+    uint64_t paced_sent, flood_sent; /* in Done records */
+    Phase phase;
+    uint8_t hops; /* shells between the source and the sink */
+    uint8_t padding[ 6 ];
+};
+
+struct BenchParameters
+{
+    bool tcp = false;
+    unsigned int size = 1000;
+    unsigned int rate = 1000;
+    uint64_t duration_ns = 2000000000;
+};
+
+static uint64_t monotonic_now_ns( void )
+{
+    return monotonic_time_ns( timestamp_ns() );
+}
+
+static void sleep_until( const uint64_t deadline_ns ) /* CLOCK_MONOTONIC */
+{
+    const timespec deadline { time_t( deadline_ns / 1000000000 ), long( deadline_ns % 1000000000 ) };
+
+    int result;
+    while ( ( result = clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr ) ) == EINTR ) {}
+
+    if ( result ) {
+        throw unix_error( "clock_nanosleep", result );
+    }
+}
+
+/* each shell adds "[name] " to the prompt prefix */
+static unsigned int count_hops( void )
+{
+    const char * const prefix = getenv( "MAHIMAHI_SHELL_PREFIX" );
+    return prefix ? count( prefix, prefix + strlen( prefix ), '[' ) : 0;
+}
+
+/* inside the chain: send the paced phase, the flood and the Done records */
+static void run_source( const uint16_t port, const BenchParameters & parameters )
+{
+    const char * const mahimahi_base = getenv( "MAHIMAHI_BASE" );
+    if ( not mahimahi_base ) {
+        throw runtime_error( "mm-bench: the source must run inside a mahimahi shell" );
+    }
+
+    const Address sink( mahimahi_base, port );
+
+    unique_ptr<Socket> socket;
+    if ( parameters.tcp ) {
+        socket.reset( new TCPSocket );
+    } else {
+        socket.reset( new UDPSocket );
+    }
+    socket->connect( sink );
+
+    if ( parameters.tcp ) {
+        /* send each paced message at once */
+        const int nodelay = true;
+        SystemCall( "setsockopt", setsockopt( socket->fd_num(), IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof( nodelay ) ) );
+    }
+
+    string packet( parameters.size, 0 );
+    BenchRecord record;
+    memset( &record, 0, sizeof( record ) );
+    record.magic = BenchRecord::MAGIC;
+    record.source_pid = getpid();
+    record.hops = count_hops();
+
+    /* true if the packet left (a full device queue may drop a datagram) */
+    const auto send = [&] () {
+        record.send_ns = monotonic_now_ns();
+        memcpy( &packet[ 0 ], &record, sizeof( record ) );
+
+        if ( parameters.tcp ) {
+            socket->write( packet );
+            return true;
+        }
+
+        const ssize_t bytes_sent = ::send( socket->fd_num(), packet.data(), packet.size(), 0 );
+        if ( bytes_sent < 0 and ( errno == ENOBUFS or errno == EAGAIN ) ) {
+            return false;
+        }
+        SystemCall( "send", bytes_sent );
+        return true;
+    };
+
+    /* paced */
+    const uint64_t gap_ns = 1000000000 / parameters.rate;
+    const uint64_t paced_start = monotonic_now_ns();
+    record.phase = Phase::Paced;
+    for ( uint64_t i = 0; i * gap_ns < parameters.duration_ns; i++ ) {
+        sleep_until( paced_start + i * gap_ns );
+        if ( send() ) {
+            record.seq++;
+        }
+    }
+    const uint64_t paced_sent = record.seq;
+
+    /* let the paced packets drain before the flood */
+    sleep_until( monotonic_now_ns() + 200000000 );
+
+    /* flood */
+    const uint64_t flood_end = monotonic_now_ns() + parameters.duration_ns;
+    record.phase = Phase::Flood;
+    record.seq = 0;
+    while ( monotonic_now_ns() < flood_end ) {
+        if ( send() ) {
+            record.seq++;
+        }
+    }
+
+    /* done: repeated in case the flood left the queues full */
+    record.phase = Phase::Done;
+    record.paced_sent = paced_sent;
+    record.flood_sent = record.seq;
+    for ( unsigned int i = 0; i < ( parameters.tcp ? 1 : 10 ); i++ ) {
+        sleep_until( monotonic_now_ns() + 20000000 );
+        send();
+    }
+}
+
+/* CPU time (ns) of a process tree, less the source and the DNS caches */
+static uint64_t chain_cpu_ns( const pid_t root, const pid_t source )
+{
+    static const uint64_t ns_per_tick = 1000000000 / sysconf( _SC_CLK_TCK );
+
+    struct ProcessInfo
+    {
+        pid_t parent;
+        string name;
+        uint64_t cpu_ticks;
+    };
+
+    map<pid_t, ProcessInfo> processes;
+    for ( const auto & path : list_directory_contents( "/proc/" ) ) {
+        const string entry = path.substr( strlen( "/proc/" ) );
+        if ( entry.empty() or entry.find_first_not_of( "0123456789" ) != string::npos ) {
+            continue;
+        }
+
+        ifstream stat_file( path + "/stat" );
+        string stat;
+        if ( not getline( stat_file, stat ) ) {
+            continue; /* exited meanwhile */
+        }
+
+        /* pid (name) state ppid ... utime stime: fields 1, 2, 3, 4, 14 and 15 */
+        const auto name_start = stat.find( '(' ), name_end = stat.rfind( ')' );
+        if ( name_start == string::npos or name_end == string::npos ) {
+            continue;
+        }
+
+        istringstream fields( stat.substr( name_end + 2 ) );
+        vector<string> values { istream_iterator<string>( fields ), istream_iterator<string>() };
+        if ( values.size() < 13 ) {
+            continue;
+        }
+
+        processes.emplace( myatoi( entry ),
+                           ProcessInfo { pid_t( myatoi( values.at( 1 ) ) ),
+                                         stat.substr( name_start + 1, name_end - name_start - 1 ),
+                                         uint64_t( myatoi( values.at( 11 ) ) + myatoi( values.at( 12 ) ) ) } );
+    }
+
+    uint64_t total_ticks = 0;
+    for ( const auto & process : processes ) {
+        if ( process.first == source or process.second.name == "dnsmasq" ) {
+            continue;
+        }
+
+        /* is it in the tree? */
+        pid_t ancestor = process.first;
+        while ( ancestor != root and processes.count( ancestor ) and ancestor > 1 ) {
+            ancestor = processes.at( ancestor ).parent;
+        }
+
+        if ( ancestor == root ) {
+            total_ticks += process.second.cpu_ticks;
+        }
+    }
+
+    return total_ticks * ns_per_tick;
+}
+
+struct RunResult
+{
+    unsigned int hops = 0;
+    uint64_t paced_sent = 0, flood_sent = 0;
+    uint64_t paced_received = 0, flood_received = 0;
+    vector<uint64_t> delays_ns {};
+    uint64_t flood_first_ns = 0, flood_last_ns = 0;
+    bool done = false;
+
+    /* CPU of the chain from the first flood packet to the last sample */
+    uint64_t cpu_start_ns = 0, cpu_last_ns = 0, cpu_sample_time_ns = 0;
+    uint64_t cpu_start_received = 0, cpu_last_received = 0;
+
+    vector<pair<string, uint64_t>> perf_counts {};
+
+    double max_pps( void ) const
+    {
+        return flood_last_ns > flood_first_ns
+            ? ( flood_received - 1 ) * 1e9 / ( flood_last_ns - flood_first_ns ) : 0;
+    }
+
+    double offered_pps( const BenchParameters & parameters ) const
+    {
+        return flood_sent * 1e9 / parameters.duration_ns;
+    }
+
+    /* added CPU per packet, per shell, during the flood */
+    double cpu_ns_per_packet_per_hop( void ) const
+    {
+        const uint64_t packets = cpu_last_received - cpu_start_received;
+        return packets and hops ? double( cpu_last_ns - cpu_start_ns ) / packets / hops : 0;
+    }
+
+    uint64_t delay_percentile( const double q )
+    {
+        if ( delays_ns.empty() ) {
+            return 0;
+        }
+        const size_t i = min( delays_ns.size() - 1, size_t( q * delays_ns.size() ) );
+        nth_element( delays_ns.begin(), delays_ns.begin() + i, delays_ns.end() );
+        return delays_ns[ i ];
+    }
+
+    double paced_loss( void ) const
+    {
+        return paced_sent ? 1 - double( paced_received ) / paced_sent : 0;
+    }
+};
+
+/* outside the chain: account for each record as it arrives */
+static void receive_record( const char * data, const size_t size, RunResult & result, const pid_t chain_pid )
+{
+    const uint64_t now = monotonic_now_ns();
+
+    BenchRecord record;
+    if ( size < sizeof( record ) ) {
+        return;
+    }
+    memcpy( &record, data, sizeof( record ) );
+    if ( record.magic != BenchRecord::MAGIC ) {
+        return;
+    }
+
+    result.hops = record.hops;
+
+    switch ( record.phase ) {
+    case Phase::Paced:
+        result.paced_received++;
+        result.delays_ns.push_back( now - record.send_ns );
+        break;
+
+    case Phase::Flood:
+        if ( result.flood_received == 0 ) {
+            result.flood_first_ns = now;
+            result.cpu_start_ns = result.cpu_last_ns = chain_cpu_ns( chain_pid, record.source_pid );
+            result.cpu_sample_time_ns = now;
+            result.cpu_start_received = result.cpu_last_received = 1;
+        } else if ( now - result.cpu_sample_time_ns > 100000000 and not result.done ) {
+            /* sample every 100 ms; /proc counts in clock ticks */
+            result.cpu_last_ns = chain_cpu_ns( chain_pid, record.source_pid );
+            result.cpu_sample_time_ns = now;
+            result.cpu_last_received = result.flood_received + 1;
+        }
+        result.flood_received++;
+        result.flood_last_ns = now;
+        break;
+
+    case Phase::Done:
+        result.done = true;
+        result.paced_sent = record.paced_sent;
+        result.flood_sent = record.flood_sent;
+        break;
+    }
+}
+
+static bool readable( const FileDescriptor & fd, const int timeout_ms )
+{
+    pollfd pfd { fd.fd_num(), POLLIN, 0 };
+    return SystemCall( "poll", ::poll( &pfd, 1, timeout_ms ) ) > 0;
+}
+
+static RunResult run_chain( const vector<string> & chain, const BenchParameters & parameters,
+                            const bool use_perf )
+{
+    UDPSocket udp_sink;
+    TCPSocket tcp_sink;
+    Socket & sink = parameters.tcp ? static_cast<Socket &>( tcp_sink ) : static_cast<Socket &>( udp_sink );
+    sink.bind( Address( "0", 0 ) );
+    if ( parameters.tcp ) {
+        tcp_sink.listen();
+    } else {
+        /* room for bursts while the sink is descheduled (the kernel caps this at net.core.rmem_max) */
+        const int receive_buffer = 8 << 20;
+        SystemCall( "setsockopt", setsockopt( udp_sink.fd_num(), SOL_SOCKET, SO_RCVBUF,
+                                              &receive_buffer, sizeof( receive_buffer ) ) );
+        udp_sink.set_blocking( false );
+    }
+
+    /* the chain, with the source inside it */
+    char self[ 4096 ];
+    const ssize_t self_length = SystemCall( "readlink", readlink( "/proc/self/exe", self, sizeof( self ) - 1 ) );
+    vector<string> command = chain;
+    command.insert( command.end(), {
+            string( self, self_length ),
+            "--source=" + to_string( sink.local_address().port() ),
+            "--size=" + to_string( parameters.size ),
+            "--rate=" + to_string( parameters.rate ),
+            "--duration-ns=" + to_string( parameters.duration_ns ) } );
+    if ( parameters.tcp ) {
+        command.push_back( "--tcp" );
+    }
+
+    /* the child waits to run the chain until the perf counters are attached */
+    auto barrier = UnixDomainSocket::make_pair();
+    ChildProcess chain_process( join( command ), [&] () {
+            barrier.second.read( 1 );
+            return ezexec( command, true );
+        } );
+
+    unique_ptr<PerfCounters> counters;
+    if ( use_perf ) {
+        counters.reset( new PerfCounters( chain_process.pid() ) );
+        if ( counters->empty() ) {
+            cerr << "mm-bench: no perf counters available (see /proc/sys/kernel/perf_event_paranoid)" << endl;
+        } else if ( not counters->counts_kernel() ) {
+            cerr << "mm-bench: perf counters exclude the kernel (see /proc/sys/kernel/perf_event_paranoid)" << endl;
+        }
+    }
+    barrier.first.write( "x" );
+
+    RunResult result;
+    unique_ptr<TCPSocket> connection;
+    string stream;
+
+    /* until the chain exits */
+    while ( not chain_process.terminated() ) {
+        if ( not readable( parameters.tcp and connection ? *connection : static_cast<FileDescriptor &>( sink ), 100 ) ) {
+            if ( chain_process.waitable() ) {
+                chain_process.wait();
+            }
+            continue;
+        }
+
+        if ( not parameters.tcp ) {
+            /* everything waiting, so the sink keeps up with the flood */
+            while ( true ) {
+                const PacketBuffer packet = udp_sink.read_buffer();
+                if ( packet.empty() ) {
+                    break;
+                }
+                receive_record( packet.data(), packet.size(), result, chain_process.pid() );
+            }
+        } else if ( not connection ) {
+            connection.reset( new TCPSocket( tcp_sink.accept() ) );
+        } else {
+            stream.append( connection->read() );
+            size_t consumed = 0;
+            for ( ; stream.size() - consumed >= parameters.size; consumed += parameters.size ) {
+                receive_record( stream.data() + consumed, parameters.size, result, chain_process.pid() );
+            }
+            stream.erase( 0, consumed );
+
+            if ( connection->eof() ) {
+                connection.reset();
+            }
+        }
+    }
+
+    if ( chain_process.exit_status() != 0 ) {
+        chain_process.throw_exception();
+    }
+
+    if ( not result.done ) {
+        throw runtime_error( "mm-bench: no Done record arrived (is the chain dropping every packet?)" );
+    }
+
+    if ( counters ) {
+        result.perf_counts = counters->read();
+    }
+
+    return result;
+}
+
+static double median( vector<double> values )
+{
+    sort( values.begin(), values.end() );
+    return values.empty() ? 0 : values.at( values.size() / 2 );
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        if ( argc < 1 ) {
+            throw runtime_error( "missing argv[ 0 ]" );
+        }
+
+        const option command_line_options[] = {
+            { "tcp",               no_argument, nullptr, 't' },
+            { "size",        required_argument, nullptr, 's' },
+            { "rate",        required_argument, nullptr, 'r' },
+            { "duration",    required_argument, nullptr, 'd' },
+            { "delay",       required_argument, nullptr, 'D' },
+            { "runs",        required_argument, nullptr, 'n' },
+            { "perf",              no_argument, nullptr, 'p' },
+            /* for the copy of mm-bench inside the chain */
+            { "source",      required_argument, nullptr, 'S' },
+            { "duration-ns", required_argument, nullptr, 'N' },
+            { 0,                             0, nullptr, 0 }
+        };
+
+        BenchParameters parameters;
+        double delay_ms = 0;
+        unsigned int runs = 3;
+        bool use_perf = false;
+        int source_port = -1;
+
+        while ( true ) {
+            /* "+": options end at the chain's first word */
+            const int opt = getopt_long( argc, argv, "+", command_line_options, nullptr );
+            if ( opt == -1 ) { /* end of options */
+                break;
+            }
+
+            switch ( opt ) {
+            case 't': parameters.tcp = true; break;
+            case 's': parameters.size = myatoi( optarg ); break;
+            case 'r': parameters.rate = myatoi( optarg ); break;
+            case 'd': parameters.duration_ns = myatof( optarg ) * 1e9; break;
+            case 'D': delay_ms = myatof( optarg ); break;
+            case 'n': runs = myatoi( optarg ); break;
+            case 'p': use_perf = true; break;
+            case 'S': source_port = myatoi( optarg ); break;
+            case 'N': parameters.duration_ns = myatoi( optarg ); break;
+            default: usage_error( argv[ 0 ] );
+            }
+        }
+
+        const unsigned int max_size = parameters.tcp ? 65536 : 1472; /* one datagram per 1500-byte MTU */
+        if ( parameters.size < sizeof( BenchRecord ) or parameters.size > max_size ) {
+            throw runtime_error( "size must be between " + to_string( sizeof( BenchRecord ) )
+                                 + " and " + to_string( max_size ) );
+        }
+
+        if ( parameters.rate == 0 or parameters.duration_ns == 0 or runs == 0 ) {
+            throw runtime_error( "rate, duration and runs must be positive" );
+        }
+
+        if ( source_port >= 0 ) {
+            run_source( source_port, parameters );
+            return EXIT_SUCCESS;
+        }
+
+        if ( optind == argc ) {
+            usage_error( argv[ 0 ] );
+        }
+
+        const vector<string> chain( argv + optind, argv + argc );
+
+        vector<RunResult> results;
+        for ( unsigned int run = 0; run < runs; run++ ) {
+            results.push_back( run_chain( chain, parameters, use_perf ) );
+            RunResult & result = results.back();
+
+            /* tab-separated, one line per run and then the medians */
+            if ( run == 0 ) {
+                cout << "run\thops\tmax_pps\toffered_pps\tcpu_ns_per_packet_per_hop"
+                     << "\tdelay_p50_ms\tdelay_p99_ms\tinflation_p50_ms\tpaced_loss";
+                for ( const auto & count : result.perf_counts ) {
+                    cout << "\t" << count.first << "_per_packet";
+                }
+                cout << endl;
+            }
+
+            cout << run << "\t" << result.hops << "\t" << result.max_pps() << "\t" << result.offered_pps( parameters )
+                 << "\t" << result.cpu_ns_per_packet_per_hop()
+                 << "\t" << result.delay_percentile( 0.5 ) / 1e6 << "\t" << result.delay_percentile( 0.99 ) / 1e6
+                 << "\t" << result.delay_percentile( 0.5 ) / 1e6 - delay_ms
+                 << "\t" << result.paced_loss();
+
+            /* over everything the chain forwarded, setup included */
+            const uint64_t packets = max( uint64_t( 1 ), result.paced_received + result.flood_received );
+            for ( const auto & count : result.perf_counts ) {
+                cout << "\t" << double( count.second ) / packets;
+            }
+            cout << endl;
+        }
+
+        const auto median_of = [&] ( const function<double(RunResult &)> & f ) {
+            vector<double> values;
+            for ( auto & result : results ) {
+                values.push_back( f( result ) );
+            }
+            return median( values );
+        };
+
+        cout << "median\t" << results.front().hops
+             << "\t" << median_of( [] ( RunResult & r ) { return r.max_pps(); } )
+             << "\t" << median_of( [&] ( RunResult & r ) { return r.offered_pps( parameters ); } )
+             << "\t" << median_of( [] ( RunResult & r ) { return r.cpu_ns_per_packet_per_hop(); } )
+             << "\t" << median_of( [] ( RunResult & r ) { return r.delay_percentile( 0.5 ) / 1e6; } )
+             << "\t" << median_of( [] ( RunResult & r ) { return r.delay_percentile( 0.99 ) / 1e6; } )
+             << "\t" << median_of( [&] ( RunResult & r ) { return r.delay_percentile( 0.5 ) / 1e6 - delay_ms; } )
+             << "\t" << median_of( [] ( RunResult & r ) { return r.paced_loss(); } );
+        for ( unsigned int i = 0; i < results.front().perf_counts.size(); i++ ) {
+            cout << "\t" << median_of( [&] ( RunResult & r ) {
+                    return double( r.perf_counts.at( i ).second )
+                        / max( uint64_t( 1 ), r.paced_received + r.flood_received ); } );
+        }
+        cout << endl;
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,37 +1,205 @@
 /* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
-#include <limits>
+#include <fstream>
+#include <sstream>
+#include <cmath>
 
 #include "delay_queue.hh"
+#include "link_schedule.hh"
 #include "timestamp.hh"
+#include "util.hh"
+#include "ezio.hh"
 
 using namespace std;
 
-void DelayQueue::read_packet( const string & contents )
+DelayTrace::DelayTrace( const string & filename )
+    : points_(),
+      period_( 0 ),
+      cursor_( 0 )
 {
-    packet_queue_.emplace( timestamp() + delay_ms_, contents );
+    ifstream trace_file( filename );
+
+    if ( not trace_file.good() ) {
+        throw runtime_error( filename + ": error opening for reading" );
+    }
+
+    string line;
+    while ( trace_file.good() and getline( trace_file, line ) ) {
+        line = line.substr( 0, line.find( '#' ) );
+
+        istringstream fields( line );
+        string time, delay, extra;
+        if ( not ( fields >> time ) ) {
+            continue; /* blank or comment */
+        }
+
+        if ( not ( fields >> delay ) or ( fields >> extra ) ) {
+            throw runtime_error( filename + ": expected \"TIME-MS DELAY-MS\", got \"" + line + "\"" );
+        }
+
+        points_.emplace_back( parse_trace_timestamp( time ), parse_trace_timestamp( delay ) );
+
+        if ( points_.size() > 1 and points_.back().first < points_[ points_.size() - 2 ].first ) {
+            throw runtime_error( filename + ": times must not decrease (at \"" + line + "\")" );
+        }
+    }
+
+    if ( points_.empty() ) {
+        throw runtime_error( filename + ": no delays" );
+    }
+
+    period_ = points_.back().first;
 }
 
-void DelayQueue::write_packets( FileDescriptor & fd )
+uint64_t DelayTrace::delay_at( uint64_t t )
 {
-    while ( (!packet_queue_.empty())
-            && (packet_queue_.front().first <= timestamp()) ) {
-        fd.write( packet_queue_.front().second );
-        packet_queue_.pop();
+    if ( period_ ) {
+        t %= period_;
+    }
+
+    if ( t < points_[ cursor_ ].first ) {
+        cursor_ = 0; /* the trace has started over */
+    }
+
+    while ( cursor_ + 1 < points_.size() and points_[ cursor_ + 1 ].first <= t ) {
+        cursor_++;
+    }
+
+    const auto & before = points_[ cursor_ ];
+    if ( t <= before.first or cursor_ + 1 == points_.size() ) {
+        return before.second;
     }
+
+    const auto & after = points_[ cursor_ + 1 ];
+    return before.second + ( int64_t( after.second ) - int64_t( before.second ) )
+        * int64_t( t - before.first ) / int64_t( after.first - before.first );
 }
 
-unsigned int DelayQueue::wait_time( void ) const
+DelayJitter::DelayJitter( const string & spec, const uint64_t seed )
+    : distribution_( Distribution::Uniform ),
+      scale_( 0 ),
+      shape_( 3 ),
+      prng_( seed )
 {
-    if ( packet_queue_.empty() ) {
-        return numeric_limits<uint16_t>::max();
+    const size_t colon = spec.find( ':' );
+    const string name = spec.substr( 0, colon );
+    if ( colon == string::npos ) {
+        throw runtime_error( "jitter \"" + spec + "\": expected DISTRIBUTION:MS" );
     }
 
-    const auto now = timestamp();
+    const string parameters = spec.substr( colon + 1 );
+    const size_t comma = parameters.find( ',' );
+    scale_ = myatof( parameters.substr( 0, comma ) ) * 1000;
+    if ( comma != string::npos ) {
+        if ( name != "pareto" ) {
+            throw runtime_error( "jitter \"" + spec + "\": only pareto takes a shape" );
+        }
+        shape_ = myatof( parameters.substr( comma + 1 ) );
+    }
 
-    if ( packet_queue_.front().first <= now ) {
-        return 0;
+    if ( name == "uniform" ) {
+        distribution_ = Distribution::Uniform;
+    } else if ( name == "normal" ) {
+        distribution_ = Distribution::Normal;
+    } else if ( name == "exponential" ) {
+        distribution_ = Distribution::Exponential;
+    } else if ( name == "pareto" ) {
+        distribution_ = Distribution::Pareto;
+        if ( not ( shape_ > 1 ) ) {
+            throw runtime_error( "jitter \"" + spec + "\": pareto shape must be more than 1" );
+        }
+        scale_ *= ( shape_ - 1 ) / shape_; /* the minimum, for the mean asked for */
     } else {
-        return packet_queue_.front().first - now;
+        throw runtime_error( "jitter \"" + spec + "\": unknown distribution (uniform, normal, exponential or pareto)" );
+    }
+
+    if ( not ( scale_ >= 0 ) ) {
+        throw runtime_error( "jitter \"" + spec + "\": must not be negative" );
+    }
+}
+
+int64_t DelayJitter::sample( void )
+{
+    switch ( distribution_ ) {
+    case Distribution::Uniform:
+        return llround( scale_ * ( 2 * prng_.uniform() - 1 ) );
+    case Distribution::Normal:
+        return llround( scale_ * prng_.normal() );
+    case Distribution::Exponential:
+        return llround( scale_ * prng_.exponential() );
+    case Distribution::Pareto:
+        return llround( scale_ / pow( 1 - prng_.uniform(), 1 / shape_ ) );
+    }
+
+    return 0;
+}
+
+DelayQueue::DelayQueue( const uint64_t & s_delay_ms )
+    : DelayQueue( s_delay_ms, "", "", false, 0 )
+{}
+
+DelayQueue::DelayQueue( const uint64_t & s_delay_ms, const string & trace_filename,
+                        const string & jitter, const bool in_order, const uint64_t seed )
+    : delay_us_( s_delay_ms * 1000 ),
+      trace_( nullptr ),
+      jitter_( nullptr ),
+      in_order_( in_order ),
+      base_timestamp_( timestamp_us() ),
+      last_release_( 0 ),
+      packets_(),
+      last_timestamp_( 0 )
+{
+    if ( not trace_filename.empty() ) {
+        /* trace files are only opened once privileges are dropped */
+        assert_not_root();
+        trace_.reset( new DelayTrace( trace_filename ) );
+    }
+
+    if ( not jitter.empty() ) {
+        jitter_.reset( new DelayJitter( jitter, seed ) );
+    }
+}
+
+uint64_t DelayQueue::release_time( const uint64_t now )
+{
+    int64_t delay = delay_us_;
+
+    if ( trace_ ) {
+        delay += trace_->delay_at( now - base_timestamp_ );
+    }
+
+    if ( jitter_ ) {
+        delay += jitter_->sample();
+    }
+
+    uint64_t ret = now + max( delay, int64_t( 0 ) );
+
+    if ( in_order_ ) {
+        ret = max( ret, last_release_ );
+        last_release_ = ret;
     }
+
+    return ret;
+}
+
+void DelayQueue::read_packet( const PacketBuffer & contents )
+{
+    last_timestamp_ = timestamp_us();
+    packets_.insert( release_time( last_timestamp_ ), PacketBuffer( contents ) );
+}
+
+void DelayQueue::write_packets( PacketSink & sink )
+{
+    last_timestamp_ = timestamp_us();
+    packets_.advance( last_timestamp_, [&] ( PacketBuffer && packet ) { sink.send( packet ); } );
+}
+
+uint64_t DelayQueue::next_event_time( void ) const
+{
+    return packets_.next_time();
+}
+
+bool DelayQueue::pending_output( void ) const
+{
+    return next_event_time() <= last_timestamp_;
 }
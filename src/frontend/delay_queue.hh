@@ -3,31 +3,99 @@
 #ifndef DELAY_QUEUE_HH
 #define DELAY_QUEUE_HH
 
-#include <queue>
 #include <cstdint>
 #include <string>
+#include <vector>
+#include <memory>
 
-#include "file_descriptor.hh"
+#include "packet_sink.hh"
+#include "timing_wheel.hh"
+#include "prng.hh"
+
+class ControlSocket;
+
+/* One-way delay over time, from a file of "TIME-MS DELAY-MS" lines
+   (up to three decimal places, times in order). The delay changes
+   linearly from one line to the next (two lines at the same time make
+   a step), and the file repeats after its last time, as a link trace
+   does. */
+class DelayTrace
+{
+private:
+    std::vector<std::pair<uint64_t, uint64_t>> points_; /* time, delay (us) */
+    uint64_t period_;
+    size_t cursor_; /* the point at or before the last time asked about */
+
+public:
+    DelayTrace( const std::string & filename );
+
+    /* delay (us) at a time (us) since the start; times asked about
+       should mostly increase, as each costs O(1) when they do */
+    uint64_t delay_at( uint64_t t );
+};
+
+/* A random extra delay for each packet, in milliseconds:
+     uniform:W          anywhere from -W to +W
+     normal:SIGMA       normally distributed about 0
+     exponential:MEAN   never negative, like time spent queueing
+     pareto:MEAN[,SHAPE]  never negative, heavy-tailed (shape > 1, default 3) */
+class DelayJitter
+{
+private:
+    enum class Distribution { Uniform, Normal, Exponential, Pareto } distribution_;
+    double scale_, shape_; /* us */
+
+    Prng prng_;
+
+public:
+    /* a seed of 0 picks one at random */
+    DelayJitter( const std::string & spec, const uint64_t seed );
+
+    /* us, perhaps negative */
+    int64_t sample( void );
+};
 
 class DelayQueue
 {
 private:
-    uint64_t delay_ms_;
-    std::queue< std::pair<uint64_t, std::string> > packet_queue_;
-    /* release timestamp, contents */
+    uint64_t delay_us_;
+    std::unique_ptr<DelayTrace> trace_;
+    std::unique_ptr<DelayJitter> jitter_;
+    bool in_order_;
+    uint64_t base_timestamp_; /* the trace starts here */
+    uint64_t last_release_;
+
+    TimingWheel<PacketBuffer> packets_; /* by release timestamp (us) */
+    uint64_t last_timestamp_; /* the clock as last read */
+
+    uint64_t release_time( const uint64_t now );
 
 public:
-    DelayQueue( const uint64_t & s_delay_ms ) : delay_ms_( s_delay_ms ), packet_queue_() {}
+    DelayQueue( const uint64_t & s_delay_ms );
 
-    void read_packet( const std::string & contents );
+    /* The delay is s_delay_ms, plus the trace's delay at the time if
+       trace_filename isn't empty, plus jitter if that isn't empty. With
+       in_order, no packet leaves before one that arrived earlier. */
+    DelayQueue( const uint64_t & s_delay_ms, const std::string & trace_filename,
+                const std::string & jitter, const bool in_order, const uint64_t seed );
 
-    void write_packets( FileDescriptor & fd );
+    void read_packet( const PacketBuffer & contents );
 
-    unsigned int wait_time( void ) const;
+    /* everything due, with one reading of the clock */
+    void write_packets( PacketSink & sink );
 
-    bool pending_output( void ) const { return wait_time() <= 0; }
+    /* release time of the first packet (us), or -1 if empty; may be
+       early for a packet due more than 256 us from the last release */
+    uint64_t next_event_time( void ) const;
+
+    /* by the clock as last read, as a packet due since is the timer's job */
+    bool pending_output( void ) const;
 
     static bool finished( void ) { return false; }
+
+    /* takes no commands (see LinkQueue) */
+    static ControlSocket * control_socket( void ) { return nullptr; }
+    static std::string control( const std::string & ) { return ""; }
 };
 
 #endif /* DELAY_QUEUE_HH */
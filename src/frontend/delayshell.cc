@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <string>
+#include <getopt.h>
 
 #include "delay_queue.hh"
 #include "util.hh"
@@ -10,6 +11,12 @@
 
 using namespace std;
 
+void usage_error( const string & program_name )
+{
+    throw runtime_error( "Usage: " + program_name + " [--trace=FILENAME] [--jitter=DISTRIBUTION:MS]"
+                         " [--in-order] [--seed=N] delay-milliseconds [command...]" );
+}
+
 int main( int argc, char *argv[] )
 {
     try {
@@ -19,28 +26,78 @@ int main( int argc, char *argv[] )
 
         check_requirements( argc, argv );
 
-        if ( argc < 2 ) {
-            throw runtime_error( "Usage: " + string( argv[ 0 ] ) + " delay-milliseconds [command...]" );
+        const option command_line_options[] = {
+            { "trace",    required_argument, nullptr, 't' },
+            { "jitter",   required_argument, nullptr, 'j' },
+            { "in-order",       no_argument, nullptr, 'o' },
+            { "seed",     required_argument, nullptr, 's' },
+            { 0,                          0, nullptr, 0 }
+        };
+
+        string trace_filename, jitter;
+        bool in_order = false;
+        uint64_t seed = 0;
+
+        while ( true ) {
+            const int opt = getopt_long( argc, argv, "+", command_line_options, nullptr );
+            if ( opt == -1 ) { /* end of options */
+                break;
+            }
+
+            switch ( opt ) {
+            case 't':
+                trace_filename = optarg;
+                break;
+            case 'j':
+                jitter = optarg;
+                DelayJitter( jitter, 0 ); /* check it now, not in the ferries */
+                break;
+            case 'o':
+                in_order = true;
+                break;
+            case 's':
+                seed = myatoi( optarg );
+                break;
+            case '?':
+                usage_error( argv[ 0 ] );
+                break;
+            default:
+                throw runtime_error( "getopt_long: unexpected return value " + to_string( opt ) );
+            }
+        }
+
+        if ( optind >= argc ) {
+            usage_error( argv[ 0 ] );
         }
 
-        const uint64_t delay_ms = myatoi( argv[ 1 ] );
+        const uint64_t delay_ms = myatoi( argv[ optind ] );
 
         vector< string > command;
 
-        if ( argc == 2 ) {
+        if ( optind + 1 == argc ) {
             command.push_back( shell_path() );
         } else {
-            for ( int i = 2; i < argc; i++ ) {
+            for ( int i = optind + 1; i < argc; i++ ) {
                 command.push_back( argv[ i ] );
             }
         }
 
+        string shell_prefix = "[delay " + to_string( delay_ms ) + " ms";
+        if ( not trace_filename.empty() ) {
+            shell_prefix += " + " + trace_filename;
+        }
+        if ( not jitter.empty() ) {
+            shell_prefix += " + " + jitter;
+        }
+        shell_prefix += "] ";
+
         PacketShell<DelayQueue> delay_shell_app( "delay", user_environment );
 
-        delay_shell_app.start_uplink( "[delay " + to_string( delay_ms ) + " ms] ",
+        /* each direction gets its own draws from the same seed */
+        delay_shell_app.start_uplink( shell_prefix,
                                       command,
-                                      delay_ms );
-        delay_shell_app.start_downlink( delay_ms );
+                                      delay_ms, trace_filename, jitter, in_order, seed );
+        delay_shell_app.start_downlink( delay_ms, trace_filename, jitter, in_order, seed ? seed + 1 : 0 );
         return delay_shell_app.wait_for_exit();
     } catch ( const exception & e ) {
         print_exception( e );
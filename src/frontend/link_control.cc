@@ -0,0 +1,51 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* send a command to a running mm-link's control socket (--uplink-control
+   or --downlink-control) and print the reply */
+
+#include <iostream>
+
+#include "control_socket.hh"
+#include "exception.hh"
+
+using namespace std;
+
+void usage_error( const string & program_name )
+{
+    cerr << "Usage: " << program_name << " SOCKET COMMAND [ARGUMENT]..." << endl;
+    cerr << endl;
+    cerr << "Commands = rate RATE" << endl;
+    cerr << "           trace FILENAME" << endl;
+    cerr << "           queue QUEUE_TYPE [QUEUE_ARGS]" << endl;
+    cerr << "           bdp BYTES" << endl;
+    cerr << "           pause | resume" << endl;
+    cerr << "           stats" << endl;
+
+    throw runtime_error( "invalid arguments" );
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        if ( argc < 1 ) {
+            throw runtime_error( "missing argv[ 0 ]" );
+        }
+
+        if ( argc < 3 ) {
+            usage_error( argv[ 0 ] );
+        }
+
+        string command = argv[ 2 ];
+        for ( int i = 3; i < argc; i++ ) {
+            command += string( " " ) + argv[ i ];
+        }
+
+        const string reply = ControlSocket::request( argv[ 1 ], command );
+        cout << reply << endl;
+
+        return reply.compare( 0, 5, "error" ) == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+}
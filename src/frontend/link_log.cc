@@ -0,0 +1,193 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+
+#include "link_log.hh"
+#include "exception.hh"
+
+using namespace std;
+
+/* on-disk layout: BinaryLogHeader, the header text padded with NULs to
+   a multiple of 8 bytes, then LinkLogRecords (all in host byte order) */
+static const char BINARY_LOG_MAGIC[ 8 ] = { 'M', 'M', 'L', 'I', 'N', 'K', 'L', 'G' };
+static const uint32_t BINARY_LOG_VERSION = 1;
+
+struct BinaryLogHeader
+{
+    char magic[ 8 ];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t text_size; /* including padding */
+};
+
+static_assert( sizeof( LinkLogRecord ) == 32, "LinkLogRecord must have a fixed layout" );
+
+TextLinkLog::TextLinkLog( const string & filename, const string & header )
+    : file_( new ofstream( filename ) ),
+      out_( *file_ ),
+      flush_every_line_( true )
+{
+    if ( not file_->good() ) {
+        throw runtime_error( filename + ": error opening for writing" );
+    }
+
+    out_ << header << flush;
+}
+
+TextLinkLog::TextLinkLog( ostream & out, const string & header, const bool flush_every_line )
+    : file_(),
+      out_( out ),
+      flush_every_line_( flush_every_line )
+{
+    out_ << header;
+}
+
+void TextLinkLog::record( const LinkLogRecord & event )
+{
+    /* a comment line, so the graphing scripts skip it */
+    if ( event.type == LinkLogRecord::Summary ) {
+        out_ << "# drops: " << event.time << " marks: " << event.delay << "\n";
+        if ( flush_every_line_ ) {
+            out_ << flush;
+        }
+        return;
+    }
+
+    out_ << event.time / 1000 << " " << event.type << " " << event.bytes;
+
+    if ( event.type != LinkLogRecord::Opportunity ) {
+        out_ << " " << event.src_port << ":" << event.dst_port;
+    }
+
+    if ( event.type == LinkLogRecord::Departure ) {
+        out_ << " " << event.delay / 1000;
+    }
+
+    out_ << "\n";
+
+    if ( flush_every_line_ ) {
+        out_ << flush;
+    }
+}
+
+BinaryLinkLog::BinaryLinkLog( const string & filename, const string & header )
+    : fd_( SystemCall( "open " + filename,
+                       open( filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 ) ) ),
+      ring_( RING_SIZE ),
+      head_( 0 ),
+      tail_( 0 ),
+      closing_( false ),
+      writer_()
+{
+    BinaryLogHeader file_header;
+    memset( &file_header, 0, sizeof( file_header ) );
+    memcpy( file_header.magic, BINARY_LOG_MAGIC, sizeof( file_header.magic ) );
+    file_header.version = BINARY_LOG_VERSION;
+    file_header.record_size = sizeof( LinkLogRecord );
+    file_header.text_size = ( header.size() + 7 ) / 8 * 8;
+
+    fd_.write( string( reinterpret_cast<const char *>( &file_header ), sizeof( file_header ) )
+               + header + string( file_header.text_size - header.size(), '\0' ) );
+
+    writer_ = thread( [this] () { write_records(); } );
+}
+
+BinaryLinkLog::~BinaryLinkLog()
+{
+    closing_.store( true, memory_order_release );
+    writer_.join();
+}
+
+void BinaryLinkLog::record( const LinkLogRecord & event )
+{
+    const uint64_t head = head_.load( memory_order_relaxed );
+
+    /* a full ring means the disk is behind; wait rather than lose events */
+    while ( head - tail_.load( memory_order_acquire ) == RING_SIZE ) {
+        this_thread::yield();
+    }
+
+    ring_[ head % RING_SIZE ] = event;
+    head_.store( head + 1, memory_order_release );
+}
+
+void BinaryLinkLog::write_records( void )
+{
+    bool failed = false;
+
+    while ( true ) {
+        const bool closing = closing_.load( memory_order_acquire );
+        const uint64_t tail = tail_.load( memory_order_relaxed );
+        const uint64_t head = head_.load( memory_order_acquire );
+
+        if ( head == tail ) {
+            if ( closing ) {
+                return;
+            }
+
+            /* batch up a millisecond's worth of events */
+            this_thread::sleep_for( chrono::milliseconds( 1 ) );
+            continue;
+        }
+
+        /* everything up to the head, or to the end of the ring */
+        const uint64_t count = min( head - tail, RING_SIZE - tail % RING_SIZE );
+
+        if ( not failed ) {
+            try {
+                fd_.write( string( reinterpret_cast<const char *>( &ring_[ tail % RING_SIZE ] ),
+                                   count * sizeof( LinkLogRecord ) ) );
+            } catch ( const exception & e ) {
+                /* keep draining the ring so the ferry never waits on us */
+                print_exception( e );
+                failed = true;
+            }
+        }
+
+        tail_.store( tail + count, memory_order_release );
+    }
+}
+
+bool BinaryLinkLogReader::recognizes( const MappedFile & file )
+{
+    return file.size() >= sizeof( BINARY_LOG_MAGIC )
+        and memcmp( file.data(), BINARY_LOG_MAGIC, sizeof( BINARY_LOG_MAGIC ) ) == 0;
+}
+
+BinaryLinkLogReader::BinaryLinkLogReader( const string & filename )
+    : file_( filename ),
+      header_(),
+      records_( nullptr ),
+      size_( 0 )
+{
+    BinaryLogHeader file_header;
+    if ( file_.size() < sizeof( file_header ) ) {
+        throw runtime_error( filename + ": not a binary mm-link log" );
+    }
+    memcpy( &file_header, file_.data(), sizeof( file_header ) );
+
+    if ( not recognizes( file_ ) ) {
+        throw runtime_error( filename + ": not a binary mm-link log" );
+    }
+
+    if ( file_header.version != BINARY_LOG_VERSION
+         or file_header.record_size != sizeof( LinkLogRecord )
+         or file_header.text_size % 8
+         or file_header.text_size > file_.size() - sizeof( file_header ) ) {
+        throw runtime_error( filename + ": unsupported binary log (written by another version or architecture?)" );
+    }
+
+    const char * const text = file_.data() + sizeof( file_header );
+    header_ = string( text, strnlen( text, file_header.text_size ) );
+
+    const uint64_t records_offset = sizeof( file_header ) + file_header.text_size;
+    records_ = reinterpret_cast<const LinkLogRecord *>( file_.data() + records_offset );
+    size_ = ( file_.size() - records_offset ) / sizeof( LinkLogRecord );
+
+    if ( ( file_.size() - records_offset ) % sizeof( LinkLogRecord ) ) {
+        cerr << filename << ": ignoring incomplete last record" << endl;
+    }
+}
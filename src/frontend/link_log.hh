@@ -0,0 +1,126 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef LINK_LOG_HH
+#define LINK_LOG_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <atomic>
+#include <thread>
+
+#include "file_descriptor.hh"
+#include "mapped_file.hh"
+
+/* one event on an emulated link, as written by --uplink-log and
+   --downlink-log; the log ends with a summary of the queue's drops
+   and marks when the link closes it */
+struct LinkLogRecord
+{
+    enum Type : uint8_t { Arrival = '+', Opportunity = '#', Departure = '-', Summary = '=' };
+
+    uint64_t time;      /* us (summary: packets dropped) */
+    uint64_t delay;     /* departures: us since the packet arrived (summary: packets marked CE) */
+    uint32_t bytes;     /* packet size, or capacity of the opportunities */
+    uint16_t src_port, dst_port;
+    uint8_t type;
+    uint8_t padding[ 7 ];
+
+    LinkLogRecord( const Type s_type, const uint64_t s_time, const uint32_t s_bytes,
+                   const uint16_t s_src_port = 0, const uint16_t s_dst_port = 0,
+                   const uint64_t s_delay = 0 )
+        : time( s_time ), delay( s_delay ), bytes( s_bytes ),
+          src_port( s_src_port ), dst_port( s_dst_port ), type( s_type ), padding() {}
+
+    LinkLogRecord() : LinkLogRecord( Arrival, 0, 0 ) {}
+
+    static LinkLogRecord summary( const uint64_t drops, const uint64_t marks )
+    {
+        return LinkLogRecord( Summary, drops, 0, 0, 0, marks );
+    }
+};
+
+class LinkLog
+{
+public:
+    virtual ~LinkLog() {}
+
+    virtual void record( const LinkLogRecord & event ) = 0;
+};
+
+/* the text format read by mm-throughput-graph and mm-delay-graph */
+class TextLinkLog : public LinkLog
+{
+private:
+    std::unique_ptr<std::ofstream> file_;
+    std::ostream & out_;
+    bool flush_every_line_;
+
+public:
+    TextLinkLog( const std::string & filename, const std::string & header );
+
+    /* write to an existing stream (used by mm-log-convert) */
+    TextLinkLog( std::ostream & out, const std::string & header, const bool flush_every_line );
+
+    void record( const LinkLogRecord & event ) override;
+};
+
+/* Fixed-size records in a file that starts with the text header. The
+   ferry only copies each record into a lock-free ring; a writer thread
+   empties the ring into the file in large writes. mm-log-convert turns
+   the file back into text. */
+class BinaryLinkLog : public LinkLog
+{
+private:
+    static const uint64_t RING_SIZE = 1 << 16; /* records (2 MiB) */
+
+    FileDescriptor fd_;
+    std::vector<LinkLogRecord> ring_;
+
+    /* head_ is only written by the ferry, tail_ only by the writer */
+    std::atomic<uint64_t> head_, tail_;
+    std::atomic<bool> closing_;
+
+    std::thread writer_;
+
+    void write_records( void );
+
+public:
+    BinaryLinkLog( const std::string & filename, const std::string & header );
+    ~BinaryLinkLog();
+
+    void record( const LinkLogRecord & event ) override;
+
+    /* forbid copying */
+    BinaryLinkLog( const BinaryLinkLog & other ) = delete;
+    BinaryLinkLog & operator=( const BinaryLinkLog & other ) = delete;
+};
+
+/* a binary log mapped into memory */
+class BinaryLinkLogReader
+{
+private:
+    MappedFile file_;
+    std::string header_;
+    const LinkLogRecord * records_;
+    uint64_t size_;
+
+public:
+    BinaryLinkLogReader( const std::string & filename );
+
+    /* does the file start like a binary log? */
+    static bool recognizes( const MappedFile & file );
+
+    const std::string & header( void ) const { return header_; }
+    const LinkLogRecord * begin( void ) const { return records_; }
+    const LinkLogRecord * end( void ) const { return records_ + size_; }
+    uint64_t size( void ) const { return size_; }
+
+    /* forbid copying */
+    BinaryLinkLogReader( const BinaryLinkLogReader & other ) = delete;
+    BinaryLinkLogReader & operator=( const BinaryLinkLogReader & other ) = delete;
+};
+
+#endif /* LINK_LOG_HH */
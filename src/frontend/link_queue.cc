@@ -2,82 +2,80 @@
 
 #include <limits>
 #include <cassert>
+#include <sstream>
+#include <iostream>
 
 #include "link_queue.hh"
 #include "timestamp.hh"
 #include "util.hh"
-#include "ezio.hh"
 #include "abstract_packet_queue.hh"
+#include "packet_queue_factory.hh"
 
 using namespace std;
 
+/* schedule files are only opened once privileges are dropped */
+static unique_ptr<LinkSchedule> load_schedule( const string & filename, const bool constant_bitrate )
+{
+    assert_not_root();
+
+    if ( constant_bitrate ) {
+        return RateSchedule::constant( filename );
+    }
+
+    return load_link_schedule( filename );
+}
+
 LinkQueue::LinkQueue( const string & link_name, const string & filename, const string & logfile,
                       const bool repeat, const bool graph_throughput, const bool graph_delay,
                       unique_ptr<AbstractPacketQueue> && packet_queue,
-                      const string & command_line )
-    : next_delivery_( 0 ),
-      schedule_(),
-      base_timestamp_( timestamp() ),
+                      const string & command_line,
+                      const bool constant_bitrate,
+                      const bool binary_log,
+                      const string & control_path )
+    : link_name_( link_name ),
+      schedule_( load_schedule( filename, constant_bitrate ) ),
+      next_delivery_( 0 ),
+      next_delivery_time_( 0 ),
+      base_timestamp_( timestamp_us() ),
       packet_queue_( move( packet_queue ) ),
-      packet_in_transit_( "", 0 ),
+      packet_in_transit_( PacketBuffer(), 0 ),
       packet_in_transit_bytes_left_( 0 ),
       output_queue_(),
       log_(),
       throughput_graph_( nullptr ),
       delay_graph_( nullptr ),
       repeat_( repeat ),
-      finished_( false )
+      finished_( false ),
+      paused_( false ),
+      paused_at_( 0 ),
+      arrivals_( 0 ),
+      departures_( 0 ),
+      departed_bytes_( 0 ),
+      replaced_drops_( 0 ),
+      replaced_marks_( 0 ),
+      control_( control_path.empty() ? nullptr : new ControlSocket( control_path ) )
 {
     assert_not_root();
 
-    /* open filename and load schedule */
-    ifstream trace_file( filename );
-
-    if ( not trace_file.good() ) {
-        throw runtime_error( filename + ": error opening for reading" );
-    }
-
-    string line;
-
-    while ( trace_file.good() and getline( trace_file, line ) ) {
-        if ( line.empty() ) {
-            throw runtime_error( filename + ": invalid empty line" );
-        }
-
-        const uint64_t ms = myatoi( line );
-
-        if ( not schedule_.empty() ) {
-            if ( ms < schedule_.back() ) {
-                throw runtime_error( filename + ": timestamps must be monotonically nondecreasing" );
-            }
-        }
-
-        schedule_.emplace_back( ms );
-    }
-
-    if ( schedule_.empty() ) {
-        throw runtime_error( filename + ": no valid timestamps found" );
-    }
-
-    if ( schedule_.back() == 0 ) {
-        throw runtime_error( filename + ": trace must last for a nonzero amount of time" );
-    }
+    next_delivery_time_ = base_timestamp_ + schedule_->time_of( next_delivery_ );
 
     /* open logfile if called for */
     if ( not logfile.empty() ) {
-        log_.reset( new ofstream( logfile ) );
-        if ( not log_->good() ) {
-            throw runtime_error( logfile + ": error opening for writing" );
-        }
-
-        *log_ << "# mahimahi mm-link (" << link_name << ") [" << filename << "] > " << logfile << endl;
-        *log_ << "# command line: " << command_line << endl;
-        *log_ << "# queue: " << packet_queue_->to_string() << endl;
-        *log_ << "# init timestamp: " << initial_timestamp() << endl;
-        *log_ << "# base timestamp: " << base_timestamp_ << endl;
+        ostringstream header;
+        header << "# mahimahi mm-link (" << link_name << ") [" << filename << "] > " << logfile << endl;
+        header << "# command line: " << command_line << endl;
+        header << "# queue: " << packet_queue_->to_string() << endl;
+        header << "# init timestamp: " << initial_timestamp() << endl;
+        header << "# base timestamp: " << base_timestamp_ / 1000 << endl;
         const char * prefix = getenv( "MAHIMAHI_SHELL_PREFIX" );
         if ( prefix ) {
-            *log_ << "# mahimahi config: " << prefix << endl;
+            header << "# mahimahi config: " << prefix << endl;
+        }
+
+        if ( binary_log ) {
+            log_.reset( new BinaryLinkLog( logfile, header.str() ) );
+        } else {
+            log_.reset( new TextLinkLog( logfile, header.str() ) );
         }
     }
 
@@ -103,68 +101,72 @@ LinkQueue::LinkQueue( const string & link_name, const string & filename, const s
     }
 }
 
-void LinkQueue::record_arrival( const uint64_t arrival_time, const size_t pkt_size,
-		                            uint16_t src, uint16_t dst, 
-																unsigned int queue_bytes __attribute((unused)),
-																unsigned int queue_packets __attribute((unused)))
+LinkQueue::~LinkQueue()
+{
+    if ( log_ and packet_queue_ ) {
+        log_->record( LinkLogRecord::summary( drops(), marks() ) );
+    }
+
+    if ( packet_queue_ and ( drops() or marks() ) ) {
+        cerr << "mahimahi mm-link (" << link_name_ << ") queue " << packet_queue_->to_string() << ": "
+             << drops() << " dropped, " << marks() << " marked CE" << endl;
+    }
+}
+
+void LinkQueue::record_arrival( const QueuedPacket & packet )
 {
+    arrivals_++;
+
     /* log it */
     if ( log_ ) {
-        *log_ << arrival_time << " + " << pkt_size << " " << src << ":" << dst << endl;
-					    // << " " << queue_bytes << " " << queue_packets << endl;
+        log_->record( LinkLogRecord( LinkLogRecord::Arrival, packet.arrival_time, packet.metadata.size,
+                                     packet.metadata.key.src_port, packet.metadata.key.dst_port ) );
     }
 
     /* meter it */
     if ( throughput_graph_ ) {
-        throughput_graph_->add_value_now( 1, pkt_size );
+        throughput_graph_->add_value_now( 1, packet.metadata.size );
     }
 }
 
-void LinkQueue::record_departure_opportunity( void )
+void LinkQueue::record_departure_opportunities( const uint64_t count )
 {
-    /* log the delivery opportunity */ 
+    /* log the delivery opportunities (all in the same millisecond) */
     if ( log_ ) {
-				// unsigned int queue_bytes   = packet_queue_->size_bytes();
-				// unsigned int queue_packets = packet_queue_->size_packets();
-        *log_ << next_delivery_time() << " # " << PACKET_SIZE << endl;
-					    // << " " << queue_bytes << " " << queue_packets << endl;
+        log_->record( LinkLogRecord( LinkLogRecord::Opportunity, next_delivery_time(), count * PACKET_SIZE ) );
     }
 
-    /* meter the delivery opportunity */
+    /* meter the delivery opportunities */
     if ( throughput_graph_ ) {
-        throughput_graph_->add_value_now( 0, PACKET_SIZE );
+        throughput_graph_->add_value_now( 0, count * PACKET_SIZE );
     }    
 }
 
 void LinkQueue::record_departure( const uint64_t departure_time, const QueuedPacket & packet )
 {
+    departures_++;
+    departed_bytes_ += packet.metadata.size;
+
     /* log the delivery */
     if ( log_ ) {
-			uint16_t src=0, dst=0;
-			// unsigned int queue_bytes   = packet_queue_->size_bytes();
-			// unsigned int queue_packets = packet_queue_->size_packets();
-            if (packet.contents.size() >= 28) {
-                _parse_ports((const unsigned char *) packet.contents.substr(24,4).c_str(), &src, &dst);
-            }
-			*log_ << departure_time << " - " << packet.contents.size()
-						<< " " << src << ":" << dst
-						<< " " << departure_time - packet.arrival_time << endl;
-						// << " " << queue_bytes << " " << queue_packets << endl;
+        log_->record( LinkLogRecord( LinkLogRecord::Departure, departure_time, packet.metadata.size,
+                                     packet.metadata.key.src_port, packet.metadata.key.dst_port,
+                                     departure_time - packet.arrival_time ) );
     }
 
     /* meter the delivery */
     if ( throughput_graph_ ) {
-        throughput_graph_->add_value_now( 2, packet.contents.size() );
+        throughput_graph_->add_value_now( 2, packet.metadata.size );
     }
 
     if ( delay_graph_ ) {
-        delay_graph_->set_max_value_now( 0, departure_time - packet.arrival_time );
+        delay_graph_->set_max_value_now( 0, ( departure_time - packet.arrival_time ) / 1000 );
     }    
 }
 
-void LinkQueue::read_packet( const string & contents )
+void LinkQueue::read_packet( const PacketBuffer & contents )
 {
-    const uint64_t now = timestamp();
+    const uint64_t now = timestamp_us();
 
     if ( contents.size() > PACKET_SIZE ) {
         throw runtime_error( "packet size is greater than maximum" );
@@ -172,56 +174,72 @@ void LinkQueue::read_packet( const string & contents )
 
     rationalize( now );
 
-		uint16_t src = 0,
-						 dst = 0;
-		unsigned int queue_bytes = 0,
-								 queue_packets = 0;
-		if ( log_ ) {
-			_parse_ports((const unsigned char *) contents.substr(24,4).c_str(), &src, &dst);
-			//queue_bytes = packet_queue_->size_bytes();
-			//queue_packets = packet_queue_->size_packets();
-		}
-    record_arrival( now, contents.size(), src, dst, queue_bytes, queue_packets );
-
-    packet_queue_->enqueue( QueuedPacket( contents, now ) );
+    QueuedPacket packet( contents, now );
+    record_arrival( packet );
+
+    packet_queue_->enqueue( move( packet ) );
 }
 
 uint64_t LinkQueue::next_delivery_time( void ) const
 {
-    if ( finished_ ) {
+    if ( finished_ or paused_ ) {
         return -1;
     } else {
-        return schedule_.at( next_delivery_ ) + base_timestamp_;
+        return next_delivery_time_;
     }
 }
 
-void LinkQueue::use_a_delivery_opportunity( void )
+void LinkQueue::use_delivery_opportunities( const uint64_t count )
 {
-    record_departure_opportunity();
+    record_departure_opportunities( count );
 
-    next_delivery_ = (next_delivery_ + 1) % schedule_.size();
+    next_delivery_ += count;
 
-    /* wraparound */
-    if ( next_delivery_ == 0 ) {
-        if ( repeat_ ) {
-            base_timestamp_ += schedule_.back();
-        } else {
-            finished_ = true;
+    /* the schedule repeats by itself; without repeat_, stop after one pass */
+    if ( not repeat_ and next_delivery_ >= schedule_->size() ) {
+        finished_ = true;
+    } else {
+        next_delivery_time_ = base_timestamp_ + schedule_->time_of( next_delivery_ );
+    }
+}
+
+/* with nothing to send, burn every opportunity up to now without
+   visiting each one; the log gets one line per millisecond, which
+   the analysis scripts add up the same way */
+void LinkQueue::skip_idle_opportunities( const uint64_t now )
+{
+    uint64_t last = schedule_->count_until( now - base_timestamp_ );
+    if ( not repeat_ ) {
+        last = min( last, schedule_->size() );
+    }
+
+    while ( not finished_ and next_delivery_ < last ) {
+        uint64_t until = last;
+        if ( log_ ) {
+            const uint64_t end_of_millisecond = next_delivery_time_ - next_delivery_time_ % 1000 + 999;
+            until = min( until, schedule_->count_until( end_of_millisecond - base_timestamp_ ) );
         }
+
+        use_delivery_opportunities( until - next_delivery_ );
     }
 }
 
 /* emulate the link up to the given timestamp */
 /* this function should be called before enqueueing any packets and before
-   calculating the wait_time until the next event */
+   calculating the next_event_time */
 void LinkQueue::rationalize( const uint64_t now )
 {
     while ( next_delivery_time() <= now ) {
+        if ( packet_queue_->empty() and packet_in_transit_bytes_left_ == 0 ) {
+            skip_idle_opportunities( now );
+            break;
+        }
+
         const uint64_t this_delivery_time = next_delivery_time();
 
         /* burn a delivery opportunity */
         unsigned int bytes_left_in_this_delivery = PACKET_SIZE;
-        use_a_delivery_opportunity();
+        use_delivery_opportunities( 1 );
 
         while ( bytes_left_in_this_delivery > 0 ) {
             if ( not packet_in_transit_bytes_left_ ) {
@@ -229,7 +247,7 @@ void LinkQueue::rationalize( const uint64_t now )
                     break;
                 }
                 packet_in_transit_ = packet_queue_->dequeue();
-                packet_in_transit_bytes_left_ = packet_in_transit_.contents.size();
+                packet_in_transit_bytes_left_ = packet_in_transit_.metadata.size;
                 if (packet_in_transit_bytes_left_ == 0) {
                     break;
                 }
@@ -238,7 +256,7 @@ void LinkQueue::rationalize( const uint64_t now )
             assert( packet_in_transit_.arrival_time <= this_delivery_time );
             assert( packet_in_transit_bytes_left_ <= PACKET_SIZE );
             assert( packet_in_transit_bytes_left_ > 0 );
-            assert( packet_in_transit_bytes_left_ <= packet_in_transit_.contents.size() );
+            assert( packet_in_transit_bytes_left_ <= packet_in_transit_.metadata.size );
 
             /* how many bytes of the delivery opportunity can we use? */
             const unsigned int amount_to_send = min( bytes_left_in_this_delivery,
@@ -259,28 +277,130 @@ void LinkQueue::rationalize( const uint64_t now )
     }
 }
 
-void LinkQueue::write_packets( FileDescriptor & fd )
+void LinkQueue::write_packets( PacketSink & sink )
 {
+    rationalize( timestamp_us() );
+
     while ( not output_queue_.empty() ) {
-        fd.write( output_queue_.front() );
+        sink.send( output_queue_.front() );
         output_queue_.pop();
     }
 }
 
-unsigned int LinkQueue::wait_time( void )
+uint64_t LinkQueue::next_event_time( void ) const
 {
-    const auto now = timestamp();
-
-    rationalize( now );
-
-    if ( next_delivery_time() <= now ) {
-        return 0;
-    } else {
-        return next_delivery_time() - now;
+    /* with nothing to send, the opportunities can be burned by the next
+       arrival's rationalize(), unless someone is watching them go by */
+    if ( packet_queue_->empty() and packet_in_transit_bytes_left_ == 0
+         and repeat_ and not log_ and not throughput_graph_ ) {
+        return -1;
     }
+
+    return next_delivery_time();
 }
 
 bool LinkQueue::pending_output( void ) const
 {
     return not output_queue_.empty();
 }
+
+bool LinkQueue::idle( void ) const
+{
+    return packet_queue_->empty() and packet_in_transit_bytes_left_ == 0 and output_queue_.empty();
+}
+
+/* the new schedule starts now, as if the link had just come up */
+void LinkQueue::replace_schedule( unique_ptr<LinkSchedule> && schedule, const uint64_t now )
+{
+    schedule_ = move( schedule );
+    base_timestamp_ = now;
+    next_delivery_ = 0;
+    next_delivery_time_ = base_timestamp_ + schedule_->time_of( next_delivery_ );
+    finished_ = false;
+
+    if ( paused_ ) {
+        paused_at_ = now;
+    }
+}
+
+/* the packets waiting move to the new queue, which may drop some */
+void LinkQueue::replace_packet_queue( unique_ptr<AbstractPacketQueue> && packet_queue )
+{
+    /* move the packets as they are: the old queue's AQM has no say now */
+    while ( not packet_queue_->empty() ) {
+        QueuedPacket packet = packet_queue_->pop();
+        if ( packet.contents.empty() ) {
+            continue; /* a placeholder, not a packet */
+        }
+        packet_queue->enqueue( move( packet ) );
+    }
+
+    replaced_drops_ += packet_queue_->drops();
+    replaced_marks_ += packet_queue_->marks();
+    packet_queue_ = move( packet_queue );
+}
+
+string LinkQueue::control( const string & command )
+{
+    istringstream words( command );
+    string verb, argument;
+    words >> verb;
+    getline( words >> ws, argument );
+
+    const uint64_t now = timestamp_us();
+
+    try {
+        /* deliver everything due under the old settings first */
+        rationalize( now );
+
+        if ( verb == "rate" or verb == "trace" ) {
+            if ( argument.empty() ) {
+                return "error: " + verb + " needs an argument";
+            }
+            replace_schedule( load_schedule( argument, verb == "rate" ), now );
+        } else if ( verb == "queue" ) {
+            istringstream queue_words( argument );
+            string type, args;
+            queue_words >> type;
+            getline( queue_words >> ws, args );
+
+            unique_ptr<AbstractPacketQueue> packet_queue = make_packet_queue( type, args );
+            if ( not packet_queue ) {
+                return "error: unknown queue type \"" + type + "\" (" + packet_queue_types() + ")";
+            }
+            replace_packet_queue( move( packet_queue ) );
+        } else if ( verb == "bdp" ) {
+            packet_queue_->set_bdp( stoi( argument ) );
+        } else if ( verb == "pause" ) {
+            if ( not paused_ ) {
+                paused_ = true;
+                paused_at_ = now;
+            }
+        } else if ( verb == "resume" ) {
+            if ( paused_ ) {
+                /* pick up the schedule where it stopped */
+                paused_ = false;
+                base_timestamp_ += now - paused_at_;
+                next_delivery_time_ += now - paused_at_;
+            }
+        } else if ( verb == "stats" ) {
+            ostringstream stats;
+            stats << "arrivals=" << arrivals_
+                  << " departures=" << departures_
+                  << " departed_bytes=" << departed_bytes_
+                  << " queued_packets=" << packet_queue_->size_packets()
+                  << " drops=" << drops()
+                  << " marks=" << marks()
+                  << " paused=" << paused_ << "\n"
+                  << "schedule: " << schedule_->to_string() << "\n"
+                  << "queue: " << packet_queue_->to_string();
+            return stats.str();
+        } else {
+            return "error: unknown command \"" + verb + "\" (rate, trace, queue, bdp, pause, resume, stats)";
+        }
+    } catch ( const exception & e ) {
+        return string( "error: " ) + e.what();
+    }
+
+    return "ok";
+}
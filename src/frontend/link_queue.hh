@@ -6,67 +6,109 @@
 #include <queue>
 #include <cstdint>
 #include <string>
-#include <fstream>
 #include <memory>
 
-#include "file_descriptor.hh"
+#include "packet_sink.hh"
+#include "link_schedule.hh"
+#include "link_log.hh"
 #include "binned_livegraph.hh"
 #include "abstract_packet_queue.hh"
-
-inline void _parse_ports( const unsigned char *s, uint16_t *src, uint16_t *dst ) {
-	*src = (s[0] << 8) | s[1];
-	*dst = (s[2] << 8) | s[3];
-}
+#include "control_socket.hh"
 
 class LinkQueue
 {
 private:
     const static unsigned int PACKET_SIZE = 1504; /* default max TUN payload size */
 
-    unsigned int next_delivery_;
-    std::vector<uint64_t> schedule_;
+    std::string link_name_;
+
+    std::unique_ptr<LinkSchedule> schedule_;
+    uint64_t next_delivery_; /* opportunity number, counting every pass */
+    uint64_t next_delivery_time_;
     uint64_t base_timestamp_;
 
     std::unique_ptr<AbstractPacketQueue> packet_queue_;
     QueuedPacket packet_in_transit_;
     unsigned int packet_in_transit_bytes_left_;
-    std::queue<std::string> output_queue_;
+    std::queue<PacketBuffer> output_queue_;
 
-    std::unique_ptr<std::ofstream> log_;
+    std::unique_ptr<LinkLog> log_;
     std::unique_ptr<BinnedLiveGraph> throughput_graph_;
     std::unique_ptr<BinnedLiveGraph> delay_graph_;
 
     bool repeat_;
     bool finished_;
 
+    bool paused_;
+    uint64_t paused_at_;
+
+    uint64_t arrivals_, departures_, departed_bytes_;
+    uint64_t replaced_drops_, replaced_marks_; /* by the queues a "queue" command replaced */
+
+    /* commands from --uplink-control or --downlink-control, if given */
+    std::unique_ptr<ControlSocket> control_;
+
     uint64_t next_delivery_time( void ) const;
 
-    void use_a_delivery_opportunity( void );
+    void use_delivery_opportunities( const uint64_t count );
+    void skip_idle_opportunities( const uint64_t now );
 
-    void record_arrival( const uint64_t arrival_time, const size_t pkt_size, 
-				                 uint16_t src, uint16_t dst, unsigned int queue_bytes, 
-												 unsigned int queue_packets );
-    void record_departure_opportunity( void );
+    void record_arrival( const QueuedPacket & packet );
+    void record_departure_opportunities( const uint64_t count );
     void record_departure( const uint64_t departure_time, const QueuedPacket & packet );
 
     void rationalize( const uint64_t now );
     void dequeue_packet( void );
 
+    void replace_schedule( std::unique_ptr<LinkSchedule> && schedule, const uint64_t now );
+    void replace_packet_queue( std::unique_ptr<AbstractPacketQueue> && packet_queue );
+
+    /* every queue's drops and marks, including those replaced */
+    uint64_t drops( void ) const { return replaced_drops_ + packet_queue_->drops(); }
+    uint64_t marks( void ) const { return replaced_marks_ + packet_queue_->marks(); }
+
 public:
     LinkQueue( const std::string & link_name, const std::string & filename, const std::string & logfile,
                const bool repeat, const bool graph_throughput, const bool graph_delay,
                std::unique_ptr<AbstractPacketQueue> && packet_queue,
-               const std::string & command_line );
+               const std::string & command_line,
+               const bool constant_bitrate = false, /* filename is then a rate, e.g. "12M" */
+               const bool binary_log = false,
+               const std::string & control_path = "" );
+
+    /* reports what the queue dropped or marked, if anything */
+    ~LinkQueue();
 
-    void read_packet( const std::string & contents );
+    LinkQueue( LinkQueue && other ) = default;
 
-    void write_packets( FileDescriptor & fd );
+    void read_packet( const PacketBuffer & contents );
 
-    unsigned int wait_time( void );
+    void write_packets( PacketSink & sink );
+
+    /* time of the next delivery opportunity the ferry must wake for (us), or -1 */
+    uint64_t next_event_time( void ) const;
 
     bool pending_output( void ) const;
 
     bool finished( void ) const { return finished_; }
+
+    /* nothing queued, in transit or waiting to be written */
+    bool idle( void ) const;
+
+    /* Carry out a command from the control socket, returning the reply.
+       The ferry runs one at a time between packets, and the link is
+       first brought up to date, so a change takes effect from the next
+       delivery opportunity on:
+         rate RATE            deliver at a constant rate from now (e.g. 12M)
+         trace FILENAME       follow a new trace, starting from now
+         queue TYPE [ARGS]    replace the queue (keeping its packets, if it will)
+         bdp BYTES            set_bdp() on the queue (again after queue, if
+                              its ARGS use bdp=)
+         pause, resume        stop and restart deliveries
+         stats                counters so far */
+    std::string control( const std::string & command );
+
+    ControlSocket * control_socket( void ) { return control_.get(); }
 };
 
 #endif /* LINK_QUEUE_HH */
@@ -0,0 +1,474 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "link_schedule.hh"
+#include "exception.hh"
+#include "ezio.hh"
+
+using namespace std;
+
+/* on-disk layout: BinaryTraceHeader, block_count BlockIndexEntry
+   records, then data_size bytes of deltas (all in host byte order) */
+static const char BINARY_TRACE_MAGIC[ 8 ] = { 'M', 'M', 'T', 'R', 'A', 'C', 'E', '\0' };
+static const uint32_t BINARY_TRACE_VERSION = 1;
+
+struct BinaryTraceHeader
+{
+    char magic[ 8 ];
+    uint32_t version;
+    uint32_t block_size;
+    uint64_t size;
+    uint64_t duration;
+    uint64_t block_count;
+    uint64_t data_size;
+};
+
+static uint64_t block_count( const uint64_t size, const uint32_t block_size )
+{
+    return ( size + block_size - 1 ) / block_size;
+}
+
+/* LEB128: seven bits at a time, low bits first */
+static void append_varint( vector<uint8_t> & out, uint64_t value )
+{
+    while ( value >= 0x80 ) {
+        out.push_back( ( value & 0x7f ) | 0x80 );
+        value >>= 7;
+    }
+    out.push_back( value );
+}
+
+static uint64_t read_varint( const uint8_t * & in, const uint8_t * const end )
+{
+    uint64_t value = 0;
+    for ( unsigned int shift = 0; shift < 64; shift += 7 ) {
+        if ( in == end ) {
+            break;
+        }
+        const uint8_t byte = *in++;
+        value |= uint64_t( byte & 0x7f ) << shift;
+        if ( not ( byte & 0x80 ) ) {
+            return value;
+        }
+    }
+
+    throw runtime_error( "link schedule: corrupt delta encoding" );
+}
+
+uint64_t parse_trace_timestamp( const string & str )
+{
+    const auto point = str.find( '.' );
+    const uint64_t ms = myatoi( str.substr( 0, point ) );
+
+    if ( point == string::npos ) {
+        return ms * 1000;
+    }
+
+    const string fraction = str.substr( point + 1 );
+    if ( fraction.empty() or fraction.size() > 3
+         or fraction.find_first_not_of( "0123456789" ) != string::npos ) {
+        throw runtime_error( "Invalid timestamp (at most microsecond precision): " + str );
+    }
+
+    return ms * 1000 + myatoi( fraction + string( 3 - fraction.size(), '0' ) );
+}
+
+uint64_t parse_rate( const string & rate )
+{
+    if ( rate.empty() ) {
+        throw runtime_error( "Invalid rate: empty" );
+    }
+
+    double multiplier = 1;
+    string number = rate;
+    switch ( rate.back() ) {
+    case 'K': multiplier = 1e3; number.pop_back(); break;
+    case 'M': multiplier = 1e6; number.pop_back(); break;
+    case 'G': multiplier = 1e9; number.pop_back(); break;
+    }
+
+    const double value = myatof( number ) * multiplier;
+    if ( value < 0 ) {
+        throw runtime_error( "Invalid rate: " + rate );
+    }
+
+    return value + 0.5;
+}
+
+TraceSchedule::TraceSchedule( const string & filename )
+    : mapping_(),
+      owned_index_(),
+      owned_data_(),
+      index_( nullptr ),
+      data_( nullptr ),
+      data_size_( 0 ),
+      size_( 0 ),
+      duration_( 0 ),
+      block_size_( DEFAULT_BLOCK_SIZE ),
+      cursor_index_( -1 ),
+      cursor_time_( 0 ),
+      cursor_next_( nullptr )
+{
+    ifstream trace_file( filename );
+
+    if ( not trace_file.good() ) {
+        throw runtime_error( filename + ": error opening for reading" );
+    }
+
+    char magic[ sizeof( BINARY_TRACE_MAGIC ) ] = {};
+    trace_file.read( magic, sizeof( magic ) );
+    trace_file.close();
+
+    if ( memcmp( magic, BINARY_TRACE_MAGIC, sizeof( magic ) ) == 0 ) {
+        load_binary( filename );
+    } else {
+        load_text( filename );
+    }
+
+    validate( filename );
+}
+
+void TraceSchedule::load_text( const string & filename )
+{
+    ifstream trace_file( filename );
+
+    string line;
+    uint64_t last = 0;
+
+    while ( trace_file.good() and getline( trace_file, line ) ) {
+        if ( line.empty() ) {
+            throw runtime_error( filename + ": invalid empty line" );
+        }
+
+        const uint64_t us = parse_trace_timestamp( line );
+
+        if ( size_ > 0 and us < last ) {
+            throw runtime_error( filename + ": timestamps must be monotonically nondecreasing" );
+        }
+
+        if ( size_ % block_size_ == 0 ) {
+            owned_index_.push_back( { us, owned_data_.size() } );
+        } else {
+            append_varint( owned_data_, us - last );
+        }
+
+        last = us;
+        size_++;
+    }
+
+    if ( size_ == 0 ) {
+        throw runtime_error( filename + ": no valid timestamps found" );
+    }
+
+    index_ = owned_index_.data();
+    data_ = owned_data_.data();
+    data_size_ = owned_data_.size();
+    duration_ = last;
+}
+
+void TraceSchedule::load_binary( const string & filename )
+{
+    mapping_.reset( new MappedFile( filename ) );
+
+    BinaryTraceHeader header;
+    if ( mapping_->size() < sizeof( header ) ) {
+        throw runtime_error( filename + ": truncated binary trace header" );
+    }
+    memcpy( &header, mapping_->data(), sizeof( header ) );
+
+    if ( header.version != BINARY_TRACE_VERSION ) {
+        throw runtime_error( filename + ": unsupported binary trace version " + std::to_string( header.version ) );
+    }
+
+    if ( header.size == 0 ) {
+        throw runtime_error( filename + ": no valid timestamps found" );
+    }
+
+    if ( header.block_size == 0 or header.block_count != block_count( header.size, header.block_size ) ) {
+        throw runtime_error( filename + ": inconsistent binary trace header (written on another architecture?)" );
+    }
+
+    const uint64_t index_bytes = header.block_count * sizeof( BlockIndexEntry );
+    if ( mapping_->size() != sizeof( header ) + index_bytes + header.data_size ) {
+        throw runtime_error( filename + ": binary trace size does not match its header" );
+    }
+
+    index_ = reinterpret_cast<const BlockIndexEntry *>( mapping_->data() + sizeof( header ) );
+    data_ = reinterpret_cast<const uint8_t *>( mapping_->data() + sizeof( header ) + index_bytes );
+    data_size_ = header.data_size;
+    size_ = header.size;
+    duration_ = header.duration;
+    block_size_ = header.block_size;
+
+    /* the blocks must be in order; the deltas keep each block in order */
+    for ( uint64_t i = 0; i < header.block_count; i++ ) {
+        if ( index_[ i ].offset > data_size_
+             or ( i > 0 and ( index_[ i ].first_time < index_[ i - 1 ].first_time
+                              or index_[ i ].offset < index_[ i - 1 ].offset ) ) ) {
+            throw runtime_error( filename + ": timestamps must be monotonically nondecreasing" );
+        }
+    }
+}
+
+void TraceSchedule::validate( const string & filename ) const
+{
+    /* decoding the last timestamp checks that the last block ends where the header says */
+    if ( timestamp( size_ - 1 ) != duration_ ) {
+        throw runtime_error( filename + ": binary trace duration does not match its last timestamp" );
+    }
+
+    if ( duration_ == 0 ) {
+        throw runtime_error( filename + ": trace must last for a nonzero amount of time" );
+    }
+}
+
+/* timestamp of entry i of the trace */
+uint64_t TraceSchedule::timestamp( const uint64_t i ) const
+{
+    if ( i == cursor_index_ ) {
+        return cursor_time_;
+    }
+
+    if ( i != cursor_index_ + 1 or i % block_size_ == 0 ) {
+        /* start over from the beginning of i's block */
+        const uint64_t block = i / block_size_;
+        cursor_index_ = block * block_size_;
+        cursor_time_ = index_[ block ].first_time;
+        cursor_next_ = data_ + index_[ block ].offset;
+    }
+
+    while ( cursor_index_ != i ) {
+        cursor_time_ += read_varint( cursor_next_, data_ + data_size_ );
+        cursor_index_++;
+    }
+
+    return cursor_time_;
+}
+
+uint64_t TraceSchedule::time_of( const uint64_t k ) const
+{
+    return ( k / size_ ) * duration_ + timestamp( k % size_ );
+}
+
+uint64_t TraceSchedule::count_in_pass( const uint64_t t ) const
+{
+    /* the last block starting at or before t holds the last timestamp at or before t */
+    const BlockIndexEntry * const index_end = index_ + block_count( size_, block_size_ );
+    const BlockIndexEntry * const after = upper_bound( index_, index_end, t,
+                                                       [] ( const uint64_t x, const BlockIndexEntry & e ) {
+                                                           return x < e.first_time; } );
+    if ( after == index_ ) {
+        return 0;
+    }
+
+    uint64_t i = ( after - index_ - 1 ) * uint64_t( block_size_ );
+    const uint64_t block_end = min( size_, i + block_size_ );
+
+    /* resume from the last timestamp decoded, if it is in the way */
+    if ( cursor_index_ >= i and cursor_index_ < block_end and cursor_time_ <= t ) {
+        i = cursor_index_ + 1;
+    }
+    while ( i < block_end and timestamp( i ) <= t ) {
+        i++;
+    }
+
+    return i;
+}
+
+uint64_t TraceSchedule::count_until( const uint64_t t ) const
+{
+    /* every pass before t's own is complete (timestamps never exceed duration_) */
+    const uint64_t pass = t / duration_;
+    return pass * size_ + count_in_pass( t - pass * duration_ );
+}
+
+string TraceSchedule::to_string( void ) const
+{
+    return std::to_string( size_ ) + " opportunities over " + std::to_string( duration_ / 1000.0 ) + " ms";
+}
+
+void TraceSchedule::write_binary( const string & filename ) const
+{
+    ofstream out( filename, ios::binary | ios::trunc );
+    if ( not out.good() ) {
+        throw runtime_error( filename + ": error opening for writing" );
+    }
+
+    BinaryTraceHeader header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.magic, BINARY_TRACE_MAGIC, sizeof( header.magic ) );
+    header.version = BINARY_TRACE_VERSION;
+    header.block_size = block_size_;
+    header.size = size_;
+    header.duration = duration_;
+    header.block_count = block_count( size_, block_size_ );
+    header.data_size = data_size_;
+
+    out.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+    out.write( reinterpret_cast<const char *>( index_ ), header.block_count * sizeof( BlockIndexEntry ) );
+    out.write( reinterpret_cast<const char *>( data_ ), data_size_ );
+
+    if ( not out.good() ) {
+        throw runtime_error( filename + ": error writing" );
+    }
+}
+
+void TraceSchedule::write_text( ostream & out ) const
+{
+    for ( uint64_t i = 0; i < size_; i++ ) {
+        const uint64_t us = timestamp( i );
+        out << us / 1000;
+        if ( us % 1000 ) {
+            out << "." << setw( 3 ) << setfill( '0' ) << us % 1000 << setfill( ' ' );
+        }
+        out << "\n";
+    }
+}
+
+static const RateSchedule::Capacity OPPORTUNITY_CAPACITY
+    = RateSchedule::Capacity( LinkSchedule::OPPORTUNITY_BYTES * 8 ) * 1000000;
+
+RateSchedule::RateSchedule()
+    : segments_(),
+      duration_( 0 ),
+      capacity_per_pass_( 0 ),
+      description_()
+{}
+
+RateSchedule::RateSchedule( const string & filename )
+    : RateSchedule()
+{
+    ifstream segment_file( filename );
+
+    if ( not segment_file.good() ) {
+        throw runtime_error( filename + ": error opening for reading" );
+    }
+
+    string line;
+    while ( segment_file.good() and getline( segment_file, line ) ) {
+        line = line.substr( 0, line.find( '#' ) );
+
+        istringstream fields( line );
+        string duration, rate, extra;
+        if ( not ( fields >> duration ) ) {
+            continue; /* blank or comment */
+        }
+
+        if ( not ( fields >> rate ) or ( fields >> extra ) ) {
+            throw runtime_error( filename + ": expected \"DURATION-MS RATE\", got \"" + line + "\"" );
+        }
+
+        add_segment( parse_trace_timestamp( duration ), parse_rate( rate ) );
+    }
+
+    finish( filename );
+}
+
+unique_ptr<RateSchedule> RateSchedule::constant( const string & rate )
+{
+    unique_ptr<RateSchedule> schedule( new RateSchedule );
+    schedule->add_segment( 1000000, parse_rate( rate ) ); /* one second, repeated */
+    schedule->finish( rate );
+    return schedule;
+}
+
+void RateSchedule::add_segment( const uint64_t duration, const uint64_t rate )
+{
+    if ( duration == 0 ) {
+        throw runtime_error( "rate segments must last for a nonzero amount of time" );
+    }
+
+    segments_.push_back( { duration_, duration, rate, capacity_per_pass_ } );
+    duration_ += duration;
+    capacity_per_pass_ += Capacity( rate ) * duration;
+}
+
+void RateSchedule::finish( const string & name )
+{
+    if ( segments_.empty() ) {
+        throw runtime_error( name + ": no rate segments found" );
+    }
+
+    if ( capacity_per_pass_ == 0 ) {
+        throw runtime_error( name + ": link never delivers (every rate is zero)" );
+    }
+
+    description_ = std::to_string( segments_.size() ) + " rate segments over "
+        + std::to_string( duration_ / 1000.0 ) + " ms";
+}
+
+uint64_t RateSchedule::time_of( const uint64_t k ) const
+{
+    /* the capacity that must have been delivered, and which pass that falls in */
+    const Capacity needed = OPPORTUNITY_CAPACITY * ( Capacity( k ) + 1 );
+    const Capacity pass = ( needed - 1 ) / capacity_per_pass_;
+    const Capacity needed_this_pass = needed - pass * capacity_per_pass_;
+
+    /* the segment that delivers it (never one with zero rate) */
+    const auto segment = upper_bound( segments_.begin(), segments_.end(), needed_this_pass - 1,
+                                      [] ( const Capacity & c, const Segment & s ) {
+                                          return c < s.capacity_before; } ) - 1;
+
+    const Capacity into_segment = needed_this_pass - segment->capacity_before;
+    const uint64_t elapsed = ( into_segment + segment->rate - 1 ) / segment->rate;
+
+    return uint64_t( pass ) * duration_ + segment->start + elapsed;
+}
+
+uint64_t RateSchedule::count_until( const uint64_t t ) const
+{
+    const uint64_t pass = t / duration_, into_pass = t - pass * duration_;
+
+    const auto segment = upper_bound( segments_.begin(), segments_.end(), into_pass,
+                                      [] ( const uint64_t x, const Segment & s ) {
+                                          return x < s.start; } ) - 1;
+
+    const Capacity capacity = Capacity( pass ) * capacity_per_pass_ + segment->capacity_before
+        + Capacity( segment->rate ) * ( into_pass - segment->start );
+
+    return capacity / OPPORTUNITY_CAPACITY;
+}
+
+uint64_t RateSchedule::size( void ) const
+{
+    return capacity_per_pass_ / OPPORTUNITY_CAPACITY;
+}
+
+unique_ptr<LinkSchedule> load_link_schedule( const string & filename )
+{
+    ifstream file( filename );
+    if ( not file.good() ) {
+        throw runtime_error( filename + ": error opening for reading" );
+    }
+
+    char magic[ sizeof( BINARY_TRACE_MAGIC ) ] = {};
+    file.read( magic, sizeof( magic ) );
+    if ( memcmp( magic, BINARY_TRACE_MAGIC, sizeof( magic ) ) == 0 ) {
+        return unique_ptr<LinkSchedule>( new TraceSchedule( filename ) );
+    }
+
+    /* rate segments have two fields on a line; trace timestamps have one */
+    file.clear();
+    file.seekg( 0 );
+
+    string line;
+    while ( file.good() and getline( file, line ) ) {
+        istringstream fields( line.substr( 0, line.find( '#' ) ) );
+        string first, second;
+        if ( not ( fields >> first ) ) {
+            continue;
+        }
+
+        if ( fields >> second ) {
+            return unique_ptr<LinkSchedule>( new RateSchedule( filename ) );
+        }
+        break;
+    }
+
+    return unique_ptr<LinkSchedule>( new TraceSchedule( filename ) );
+}
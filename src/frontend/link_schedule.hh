@@ -0,0 +1,149 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef LINK_SCHEDULE_HH
+#define LINK_SCHEDULE_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <ostream>
+
+#include "mapped_file.hh"
+
+/* When a link can deliver each MTU-sized (1504-byte) chunk. Delivery
+   opportunities are numbered from 0 over the whole emulation: after
+   the last one of a pass through the schedule, the next pass begins
+   duration() later. Times are in microseconds from the start. */
+
+class LinkSchedule
+{
+public:
+    static const unsigned int OPPORTUNITY_BYTES = 1504; /* default max TUN payload size */
+
+    virtual ~LinkSchedule() {}
+
+    /* time of opportunity k (fastest when called with consecutive k) */
+    virtual uint64_t time_of( const uint64_t k ) const = 0;
+
+    /* how many opportunities come at or before time t (in O(log n)) */
+    virtual uint64_t count_until( const uint64_t t ) const = 0;
+
+    /* opportunities in the first pass, and how long a pass lasts */
+    virtual uint64_t size( void ) const = 0;
+    virtual uint64_t duration( void ) const = 0;
+
+    virtual std::string to_string( void ) const = 0;
+};
+
+/* a list of opportunity timestamps (the text trace format, or the
+   binary form written by mm-trace-convert) */
+class TraceSchedule : public LinkSchedule
+{
+public:
+    static const uint32_t DEFAULT_BLOCK_SIZE = 4096;
+
+    /* Kept as varint-encoded deltas in blocks, with an index holding
+       the first timestamp and byte offset of each block. A text trace
+       is encoded in memory when loaded; a binary trace is the same
+       encoding on disk, and is mapped rather than read. */
+    struct BlockIndexEntry
+    {
+        uint64_t first_time;
+        uint64_t offset; /* of the block's deltas in the data */
+    };
+
+private:
+    std::unique_ptr<MappedFile> mapping_;
+    std::vector<BlockIndexEntry> owned_index_;
+    std::vector<uint8_t> owned_data_;
+
+    const BlockIndexEntry * index_;
+    const uint8_t * data_;
+    uint64_t data_size_;
+    uint64_t size_, duration_;
+    uint32_t block_size_;
+
+    /* the last timestamp decoded, and where the next delta starts */
+    mutable uint64_t cursor_index_, cursor_time_;
+    mutable const uint8_t * cursor_next_;
+
+    uint64_t timestamp( const uint64_t i ) const;
+
+    /* how many timestamps of one pass are at or before t */
+    uint64_t count_in_pass( const uint64_t t ) const;
+
+    void load_text( const std::string & filename );
+    void load_binary( const std::string & filename );
+    void validate( const std::string & filename ) const;
+
+public:
+    /* text (one timestamp in ms per line) or binary, told apart by the binary header */
+    TraceSchedule( const std::string & filename );
+
+    uint64_t time_of( const uint64_t k ) const override;
+    uint64_t count_until( const uint64_t t ) const override;
+    uint64_t size( void ) const override { return size_; }
+    uint64_t duration( void ) const override { return duration_; } /* time of the last opportunity */
+    std::string to_string( void ) const override;
+
+    void write_binary( const std::string & filename ) const;
+    void write_text( std::ostream & out ) const;
+
+    /* forbid copying */
+    TraceSchedule( const TraceSchedule & other ) = delete;
+    TraceSchedule & operator=( const TraceSchedule & other ) = delete;
+};
+
+/* piecewise-constant rates: each opportunity comes when the capacity
+   delivered since the start reaches another 1504 bytes */
+class RateSchedule : public LinkSchedule
+{
+public:
+    /* capacity in bit-microseconds (bits times 10^6), exact for integer rates */
+    __extension__ typedef unsigned __int128 Capacity;
+
+    struct Segment
+    {
+        uint64_t start, duration; /* us */
+        uint64_t rate;            /* bits per second */
+        Capacity capacity_before; /* delivered by the start of the segment */
+    };
+
+private:
+    std::vector<Segment> segments_;
+    uint64_t duration_;
+    Capacity capacity_per_pass_;
+    std::string description_;
+
+    RateSchedule();
+
+    void add_segment( const uint64_t duration, const uint64_t rate );
+    void finish( const std::string & name );
+
+public:
+    /* one "DURATION-MS RATE" pair per line ('#' starts a comment) */
+    RateSchedule( const std::string & filename );
+
+    /* a constant rate, such as "12M" */
+    static std::unique_ptr<RateSchedule> constant( const std::string & rate );
+
+    uint64_t time_of( const uint64_t k ) const override;
+    uint64_t count_until( const uint64_t t ) const override;
+    uint64_t size( void ) const override;
+    uint64_t duration( void ) const override { return duration_; }
+    std::string to_string( void ) const override { return description_; }
+
+    const std::vector<Segment> & segments( void ) const { return segments_; }
+};
+
+/* "12M", "500K", "1.5G" or a plain number, in bits per second */
+uint64_t parse_rate( const std::string & rate );
+
+/* a trace timestamp is in milliseconds, with up to three decimal places */
+uint64_t parse_trace_timestamp( const std::string & str );
+
+/* TraceSchedule or RateSchedule, whichever the file holds */
+std::unique_ptr<LinkSchedule> load_link_schedule( const std::string & filename );
+
+#endif /* LINK_SCHEDULE_HH */
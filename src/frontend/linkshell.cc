@@ -1,14 +1,9 @@
 /* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
+#include <cmath>
 #include <getopt.h>
 
-#include "infinite_packet_queue.hh"
-#include "drop_tail_packet_queue.hh"
-#include "drop_head_packet_queue.hh"
-#include "codel_packet_queue.hh"
-#include "pie_packet_queue.hh"
-#include "ecmp_packet_queue.hh"
-#include "fair_packet_queue.hh"
+#include "packet_queue_factory.hh"
 #include "link_queue.hh"
 #include "packetshell.cc"
 #include "util.hh"
@@ -21,17 +16,21 @@ void usage_error( const string & program_name )
     cerr << endl;
     cerr << "Options = --once" << endl;
     cerr << "          --uplink-log=FILENAME --downlink-log=FILENAME" << endl;
+    cerr << "          --binary-log (write the logs in binary; see mm-log-convert)" << endl;
     cerr << "          --meter-uplink --meter-uplink-delay" << endl;
     cerr << "          --meter-downlink --meter-downlink-delay" << endl;
     cerr << "          --meter-all" << endl;
     cerr << "          --uplink-queue=QUEUE_TYPE --downlink-queue=QUEUE_TYPE" << endl;
     cerr << "          --uplink-queue-args=QUEUE_ARGS --downlink-queue-args=QUEUE_ARGS" << endl;
     cerr << "          --q=QUEUE_TYPE,QUEUE_ARGS" << endl;
+    cerr << "          --uplink-control=SOCKET --downlink-control=SOCKET" << endl;
+    cerr << "                (change the link while it runs, with mm-link-control SOCKET COMMAND)" << endl;
     cerr << "          --cbr" << endl;
     cerr << "                (if --cbr is used, UPLINK-TRACE and DOWNLINK-TRACE should be desired bitrate" << endl;
-    cerr << "                 rather than filename, expressed as \"XK\" for X Kbps or \"XM\" for X Mbps)" << endl;
+    cerr << "                 rather than filename, expressed as \"XK\" for X Kbps or \"XM\" for X Mbps;" << endl;
+    cerr << "                 the link then delivers at exactly that rate, without a trace file)" << endl;
     cerr << endl;
-    cerr << "          QUEUE_TYPE = infinite | droptail | drophead | codel | pie | ecmp | akshayfq" << endl;
+    cerr << "          QUEUE_TYPE = " << packet_queue_types() << endl;
     cerr << "          QUEUE_ARGS = \"NAME=NUMBER[, NAME2=NUMBER2, ...]\"" << endl;
     cerr << "              (with NAME = bytes | packets | target | interval | qdelay_ref | max_burst)" << endl;
     cerr << "                  target, interval, qdelay_ref, max_burst are in milli-second" << endl << endl;
@@ -46,40 +45,12 @@ void usage_error( const string & program_name )
 
 unique_ptr<AbstractPacketQueue> get_packet_queue( const string & type, const string & args, const string & program_name )
 {
-    if ( type == "infinite" ) {
-        return unique_ptr<AbstractPacketQueue>( new InfinitePacketQueue( args ) );
-    } else if ( type == "droptail" ) {
-        return unique_ptr<AbstractPacketQueue>( new DropTailPacketQueue( args ) );
-    } else if ( type == "drophead" ) {
-        return unique_ptr<AbstractPacketQueue>( new DropHeadPacketQueue( args ) );
-    } else if ( type == "codel" ) {
-        return unique_ptr<AbstractPacketQueue>( new CODELPacketQueue( args ) );
-    } else if ( type == "pie" ) {
-        return unique_ptr<AbstractPacketQueue>( new PIEPacketQueue( args ) );
-    } else if ( type == "ecmp" ) {
-        return unique_ptr<AbstractPacketQueue>( new ECMPPacketQueue( args ) );
-    } else if ( type == "akshayfq" ) {
-        return unique_ptr<AbstractPacketQueue>( new FairPacketQueue( args ) );
-    } else {
-        cerr << "Unknown queue type: " << type << endl;
-    }
-
-    usage_error( program_name );
-
-    return nullptr;
-}
+    unique_ptr<AbstractPacketQueue> ret = make_packet_queue( type, args );
 
-string shell_quote( const string & arg )
-{
-    string ret = "'";
-    for ( const auto & ch : arg ) {
-        if ( ch != '\'' ) {
-            ret.push_back( ch );
-        } else {
-            ret += "'\\''";
-        }
+    if ( not ret ) {
+        cerr << "Unknown queue type: " << type << endl;
+        usage_error( program_name );
     }
-    ret += "'";
 
     return ret;
 }
@@ -105,6 +76,7 @@ int main( int argc, char *argv[] )
         const option command_line_options[] = {
             { "uplink-log",           required_argument, nullptr, 'u' },
             { "downlink-log",         required_argument, nullptr, 'd' },
+            { "binary-log",                 no_argument, nullptr, 'l' },
             { "once",                       no_argument, nullptr, 'o' },
             { "meter-uplink",               no_argument, nullptr, 'm' },
             { "meter-downlink",             no_argument, nullptr, 'n' },
@@ -116,15 +88,19 @@ int main( int argc, char *argv[] )
             { "uplink-queue-args",    required_argument, nullptr, 'a' },
             { "downlink-queue-args",  required_argument, nullptr, 'b' },
             { "both",                 optional_argument, nullptr, 'e' },     
+            { "uplink-control",       required_argument, nullptr, 'U' },
+            { "downlink-control",     required_argument, nullptr, 'D' },
             { "cbr",                        no_argument, nullptr, 'c' },
             { 0,                                      0, nullptr, 0 }
         };
 
         string uplink_logfile, downlink_logfile;
+        string uplink_control, downlink_control;
         bool repeat = true;
         bool meter_uplink = false, meter_downlink = false;
         bool meter_uplink_delay = false, meter_downlink_delay = false;
         bool constant_bitrate_trace = false;
+        bool binary_log = false;
         string uplink_queue_type = "infinite", downlink_queue_type = "infinite",
                uplink_queue_args, downlink_queue_args;
 
@@ -141,6 +117,9 @@ int main( int argc, char *argv[] )
             case 'd':
                 downlink_logfile = optarg;
                 break;
+            case 'l':
+                binary_log = true;
+                break;
             case 'o':
                 repeat = false;
                 break;
@@ -180,6 +159,12 @@ int main( int argc, char *argv[] )
                 uplink_queue_type = downlink_queue_type = optarg;
                 uplink_queue_args = downlink_queue_args = (p+1);
                 break; }
+            case 'U':
+                uplink_control = optarg;
+                break;
+            case 'D':
+                downlink_control = optarg;
+                break;
             case 'c':
                 constant_bitrate_trace = true;
                 break;
@@ -196,6 +181,10 @@ int main( int argc, char *argv[] )
             usage_error( argv[ 0 ] );
         }
 
+        if ( not uplink_control.empty() and uplink_control == downlink_control ) {
+            throw runtime_error( "--uplink-control and --downlink-control must be different sockets" );
+        }
+
         string uplink_filename = argv[ optind ];
         string downlink_filename = argv[ optind + 1 ];
 
@@ -221,9 +210,6 @@ int main( int argc, char *argv[] )
                 uplink_packet_queue->set_bdp( round( uplink_bdp ) );
                 downlink_packet_queue->set_bdp( round( downlink_bdp ) );
             }
-
-            uplink_filename = get_cbr_trace( uplink_filename );
-            downlink_filename = get_cbr_trace( downlink_filename );
         }
 
         vector<string> command;
@@ -241,11 +227,11 @@ int main( int argc, char *argv[] )
         link_shell_app.start_uplink( "[link] ", command,
                                      "Uplink", uplink_filename, uplink_logfile, repeat, meter_uplink, meter_uplink_delay,
                                      uplink_packet_queue,
-                                     command_line );
+                                     command_line, constant_bitrate_trace, binary_log, uplink_control );
 
         link_shell_app.start_downlink( "Downlink", downlink_filename, downlink_logfile, repeat, meter_downlink, meter_downlink_delay,
                                        downlink_packet_queue,
-                                       command_line );
+                                       command_line, constant_bitrate_trace, binary_log, downlink_control );
 
         return link_shell_app.wait_for_exit();
     } catch ( const exception & e ) {
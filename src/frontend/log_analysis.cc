@@ -0,0 +1,568 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <exception>
+
+#include "log_analysis.hh"
+#include "link_log.hh"
+#include "mapped_file.hh"
+#include "exception.hh"
+
+using namespace std;
+
+DelaySketch::DelaySketch()
+    : counts_(),
+      count_( 0 ),
+      sum_( 0 ),
+      max_( 0 )
+{}
+
+/* below EXACT_LIMIT, one counter per ms; above, keep the top ten bits */
+unsigned int DelaySketch::bucket( const uint64_t delay )
+{
+    if ( delay < EXACT_LIMIT ) {
+        return delay;
+    }
+
+    const unsigned int exponent = 63 - __builtin_clzll( delay ); /* at least 10 */
+    const unsigned int shift = exponent - 9;
+    return EXACT_LIMIT + ( exponent - 10 ) * 512 + ( ( delay >> shift ) - 512 );
+}
+
+uint64_t DelaySketch::bucket_value( const unsigned int bucket )
+{
+    if ( bucket < EXACT_LIMIT ) {
+        return bucket;
+    }
+
+    const unsigned int exponent = 10 + ( bucket - EXACT_LIMIT ) / 512;
+    const uint64_t mantissa = 512 + ( bucket - EXACT_LIMIT ) % 512;
+    return mantissa << ( exponent - 9 );
+}
+
+void DelaySketch::add( const uint64_t delay, const uint64_t count )
+{
+    const unsigned int i = bucket( delay );
+    if ( i >= counts_.size() ) {
+        counts_.resize( i + 1 );
+    }
+
+    counts_[ i ] += count;
+    count_ += count;
+    sum_ += delay * count;
+    max_ = std::max( max_, delay );
+}
+
+void DelaySketch::merge( const DelaySketch & other )
+{
+    if ( other.counts_.size() > counts_.size() ) {
+        counts_.resize( other.counts_.size() );
+    }
+
+    for ( unsigned int i = 0; i < other.counts_.size(); i++ ) {
+        counts_[ i ] += other.counts_[ i ];
+    }
+
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max( max_, other.max_ );
+}
+
+uint64_t DelaySketch::quantile( const double q ) const
+{
+    if ( count_ == 0 ) {
+        throw runtime_error( "no delays to take a percentile of" );
+    }
+
+    const uint64_t position = std::min( uint64_t( q * count_ ), count_ - 1 );
+
+    uint64_t seen = 0;
+    for ( unsigned int i = 0; i < counts_.size(); i++ ) {
+        seen += counts_[ i ];
+        if ( seen > position ) {
+            return std::min( bucket_value( i ), max_ );
+        }
+    }
+
+    return max_;
+}
+
+LogAnalysis::Flow::Flow()
+    : arrived_packets( 0 ),
+      arrived_bytes( 0 ),
+      departed_packets( 0 ),
+      departed_bytes( 0 ),
+      first_event( numeric_limits<int64_t>::max() ),
+      last_event( numeric_limits<int64_t>::min() ),
+      delays()
+{}
+
+LogAnalysis::LogAnalysis( const uint64_t ms_per_bin )
+    : ms_per_bin_( ms_per_bin ),
+      have_events_( false ),
+      first_timestamp_( 0 ),
+      last_timestamp_( 0 ),
+      capacity_sum_( 0 ),
+      arrival_sum_( 0 ),
+      departure_sum_( 0 ),
+      bins_( Bin() ),
+      signal_delay_( numeric_limits<uint64_t>::max() ),
+      delays_(),
+      flows_(),
+      have_summary_( false ),
+      drops_( 0 ),
+      marks_( 0 )
+{
+    if ( ms_per_bin_ == 0 ) {
+        throw runtime_error( "bins must be at least 1 ms wide" );
+    }
+}
+
+void LogAnalysis::saw_event( const int64_t timestamp )
+{
+    if ( not have_events_ ) {
+        have_events_ = true;
+        first_timestamp_ = last_timestamp_ = timestamp;
+    }
+
+    /* like the graphing scripts, the first event in the log starts the clock */
+    last_timestamp_ = std::max( last_timestamp_, timestamp );
+}
+
+LogAnalysis::Bin & LogAnalysis::bin( const int64_t timestamp )
+{
+    /* round toward minus infinity */
+    const int64_t width = ms_per_bin_;
+    return bins_.at( timestamp >= 0 ? timestamp / width : -( ( width - 1 - timestamp ) / width ) );
+}
+
+LogAnalysis::Flow & LogAnalysis::flow( const uint16_t src_port, const uint16_t dst_port )
+{
+    return flows_[ uint32_t( src_port ) << 16 | dst_port ];
+}
+
+void LogAnalysis::arrival( const int64_t timestamp, const uint64_t bytes,
+                           const uint16_t src_port, const uint16_t dst_port )
+{
+    saw_event( timestamp );
+    bin( timestamp ).arrivals += bytes * 8;
+    arrival_sum_ += bytes * 8;
+
+    Flow & f = flow( src_port, dst_port );
+    f.arrived_packets++;
+    f.arrived_bytes += bytes;
+    f.first_event = std::min( f.first_event, timestamp );
+    f.last_event = std::max( f.last_event, timestamp );
+}
+
+void LogAnalysis::opportunity( const int64_t timestamp, const uint64_t bytes )
+{
+    saw_event( timestamp );
+    bin( timestamp ).capacity += bytes * 8;
+    capacity_sum_ += bytes * 8;
+}
+
+void LogAnalysis::departure( const int64_t timestamp, const uint64_t bytes,
+                             const uint16_t src_port, const uint16_t dst_port,
+                             const uint64_t delay )
+{
+    if ( timestamp < int64_t( delay ) ) {
+        throw runtime_error( "Invalid timestamp and delay: ts=" + to_string( timestamp )
+                             + ", delay=" + to_string( delay ) );
+    }
+
+    saw_event( timestamp );
+
+    Bin & b = bin( timestamp );
+    b.departures += bytes * 8;
+    b.departed_packets++;
+    b.delay_sum += delay;
+    b.delay_max = std::max( b.delay_max, delay );
+    departure_sum_ += bytes * 8;
+
+    delays_.add( delay );
+
+    uint64_t & signal_delay = signal_delay_.at( timestamp - delay );
+    signal_delay = std::min( signal_delay, delay );
+
+    Flow & f = flow( src_port, dst_port );
+    f.departed_packets++;
+    f.departed_bytes += bytes;
+    f.first_event = std::min( f.first_event, timestamp );
+    f.last_event = std::max( f.last_event, timestamp );
+    f.delays.add( delay );
+}
+
+void LogAnalysis::summary( const uint64_t drops, const uint64_t marks )
+{
+    have_summary_ = true;
+    drops_ += drops;
+    marks_ += marks;
+}
+
+void LogAnalysis::merge( const LogAnalysis & other )
+{
+    if ( other.have_summary_ ) {
+        summary( other.drops_, other.marks_ );
+    }
+
+    if ( not other.have_events_ ) {
+        return;
+    }
+
+    if ( not have_events_ ) {
+        first_timestamp_ = other.first_timestamp_;
+        last_timestamp_ = other.last_timestamp_;
+        have_events_ = true;
+    }
+
+    /* other covers a later part of the log */
+    last_timestamp_ = std::max( last_timestamp_, other.last_timestamp_ );
+
+    capacity_sum_ += other.capacity_sum_;
+    arrival_sum_ += other.arrival_sum_;
+    departure_sum_ += other.departure_sum_;
+
+    if ( not other.bins_.empty() ) {
+        for ( int64_t i = other.bins_.first(); i <= other.bins_.last(); i++ ) {
+            const Bin & theirs = other.bins_[ i ];
+            Bin & ours = bins_.at( i );
+            ours.capacity += theirs.capacity;
+            ours.arrivals += theirs.arrivals;
+            ours.departures += theirs.departures;
+            ours.departed_packets += theirs.departed_packets;
+            ours.delay_sum += theirs.delay_sum;
+            ours.delay_max = std::max( ours.delay_max, theirs.delay_max );
+        }
+    }
+
+    if ( not other.signal_delay_.empty() ) {
+        for ( int64_t i = other.signal_delay_.first(); i <= other.signal_delay_.last(); i++ ) {
+            if ( other.signal_delay_[ i ] != numeric_limits<uint64_t>::max() ) {
+                uint64_t & ours = signal_delay_.at( i );
+                ours = std::min( ours, other.signal_delay_[ i ] );
+            }
+        }
+    }
+
+    delays_.merge( other.delays_ );
+
+    for ( const auto & x : other.flows_ ) {
+        Flow & ours = flows_[ x.first ];
+        ours.arrived_packets += x.second.arrived_packets;
+        ours.arrived_bytes += x.second.arrived_bytes;
+        ours.departed_packets += x.second.departed_packets;
+        ours.departed_bytes += x.second.departed_bytes;
+        ours.first_event = std::min( ours.first_event, x.second.first_event );
+        ours.last_event = std::max( ours.last_event, x.second.last_event );
+        ours.delays.merge( x.second.delays );
+    }
+}
+
+static double megabits_per_second( const uint64_t bits, const int64_t duration_ms )
+{
+    return duration_ms > 0 ? bits / ( duration_ms / 1000.0 ) / 1000000.0 : 0;
+}
+
+double LogAnalysis::average_capacity( void ) const
+{
+    return megabits_per_second( capacity_sum_, last_timestamp_ - first_timestamp_ );
+}
+
+double LogAnalysis::average_ingress( void ) const
+{
+    return megabits_per_second( arrival_sum_, last_timestamp_ - first_timestamp_ );
+}
+
+double LogAnalysis::average_throughput( void ) const
+{
+    return megabits_per_second( departure_sum_, last_timestamp_ - first_timestamp_ );
+}
+
+DelaySketch LogAnalysis::signal_delays( void ) const
+{
+    DelaySketch ret;
+
+    if ( signal_delay_.empty() ) {
+        return ret;
+    }
+
+    /* the last ms always has a packet sent in it */
+    uint64_t next = signal_delay_[ signal_delay_.last() ];
+    for ( int64_t i = signal_delay_.last(); i >= signal_delay_.first(); i-- ) {
+        const uint64_t delay = signal_delay_[ i ] != numeric_limits<uint64_t>::max()
+            ? signal_delay_[ i ] : next + 1;
+        ret.add( delay );
+        next = delay;
+    }
+
+    return ret;
+}
+
+/* parsing the text format */
+
+static bool is_space( const char c )
+{
+    return c == ' ' or c == '\t' or c == '\r';
+}
+
+/* the next whitespace-separated field of the line [p, end) */
+static bool next_field( const char * & p, const char * const end,
+                        const char * & field, size_t & length )
+{
+    while ( p < end and is_space( *p ) ) {
+        p++;
+    }
+
+    field = p;
+    while ( p < end and not is_space( *p ) ) {
+        p++;
+    }
+
+    length = p - field;
+    return length > 0;
+}
+
+static uint64_t parse_number( const char * field, const size_t length, const string & what )
+{
+    if ( length == 0 or length > 19 ) {
+        throw runtime_error( "Invalid " + what + ": " + string( field, length ) );
+    }
+
+    uint64_t ret = 0;
+    for ( size_t i = 0; i < length; i++ ) {
+        if ( field[ i ] < '0' or field[ i ] > '9' ) {
+            throw runtime_error( "Invalid " + what + ": " + string( field, length ) );
+        }
+        ret = ret * 10 + ( field[ i ] - '0' );
+    }
+
+    return ret;
+}
+
+static void parse_flow( const char * field, const size_t length, uint16_t & src, uint16_t & dst )
+{
+    const char * const colon = static_cast<const char *>( memchr( field, ':', length ) );
+    src = parse_number( field, colon - field, "flow" );
+    dst = parse_number( colon + 1, field + length - colon - 1, "flow" );
+}
+
+static const string BASE_TIMESTAMP = "# base timestamp: ";
+static const string SUMMARY = "# drops: ";
+
+/* "# drops: N marks: M", as LinkQueue ends the log */
+static void analyze_summary( const char * p, const char * const end, LogAnalysis & analysis )
+{
+    const char * fields[ 4 ];
+    size_t lengths[ 4 ];
+    unsigned int count = 0;
+    while ( count < 4 and next_field( p, end, fields[ count ], lengths[ count ] ) ) {
+        count++;
+    }
+
+    if ( count != 3 or string( fields[ 1 ], lengths[ 1 ] ) != "marks:" ) {
+        throw runtime_error( "Summary format: # drops: N marks: M" );
+    }
+
+    analysis.summary( parse_number( fields[ 0 ], lengths[ 0 ], "drop count" ),
+                      parse_number( fields[ 2 ], lengths[ 2 ], "mark count" ) );
+}
+
+/* the base timestamp from a log's header lines */
+static int64_t base_timestamp( const string & header )
+{
+    const auto pos = header.find( BASE_TIMESTAMP );
+    if ( pos == string::npos ) {
+        throw runtime_error( "logfile is missing base timestamp" );
+    }
+
+    if ( header.find( BASE_TIMESTAMP, pos + 1 ) != string::npos ) {
+        throw runtime_error( "base timestamp multiply defined" );
+    }
+
+    const auto end = header.find( '\n', pos );
+    const string number = header.substr( pos + BASE_TIMESTAMP.size(),
+                                         end == string::npos ? string::npos : end - pos - BASE_TIMESTAMP.size() );
+    return parse_number( number.data(), number.size(), "base timestamp" );
+}
+
+static void analyze_line( const char * p, const char * const end,
+                          const int64_t base, LogAnalysis & analysis )
+{
+    if ( p < end and *p == '#' ) {
+        if ( size_t( end - p ) >= BASE_TIMESTAMP.size()
+             and memcmp( p, BASE_TIMESTAMP.data(), BASE_TIMESTAMP.size() ) == 0 ) {
+            throw runtime_error( "base timestamp multiply defined" );
+        }
+        if ( size_t( end - p ) >= SUMMARY.size()
+             and memcmp( p, SUMMARY.data(), SUMMARY.size() ) == 0 ) {
+            analyze_summary( p + SUMMARY.size(), end, analysis );
+        }
+        return;
+    }
+
+    const char * fields[ 5 ];
+    size_t lengths[ 5 ];
+    unsigned int count = 0;
+    while ( count < 5 and next_field( p, end, fields[ count ], lengths[ count ] ) ) {
+        count++;
+    }
+
+    if ( count < 3 ) {
+        throw runtime_error( "Format: timestamp event_type num_bytes [flow] [delay]: " + string( fields[ 0 ], end - fields[ 0 ] ) );
+    }
+
+    const int64_t timestamp = int64_t( parse_number( fields[ 0 ], lengths[ 0 ], "timestamp" ) ) - base;
+    const uint64_t bytes = parse_number( fields[ 2 ], lengths[ 2 ], "byte count" );
+
+    /* arrivals and departures name their flow as src:dst (older logs do not) */
+    uint16_t src = 0, dst = 0;
+    unsigned int next = 3;
+    if ( count > next and memchr( fields[ next ], ':', lengths[ next ] ) ) {
+        parse_flow( fields[ next ], lengths[ next ], src, dst );
+        next++;
+    }
+
+    if ( lengths[ 1 ] != 1 ) {
+        throw runtime_error( "Unknown event type: " + string( fields[ 1 ], lengths[ 1 ] ) );
+    }
+
+    switch ( fields[ 1 ][ 0 ] ) {
+    case '+':
+        analysis.arrival( timestamp, bytes, src, dst );
+        break;
+    case '#':
+        analysis.opportunity( timestamp, bytes );
+        break;
+    case '-':
+        if ( count <= next ) {
+            throw runtime_error( "Departure format: timestamp - num_bytes [flow] delay" );
+        }
+        analysis.departure( timestamp, bytes, src, dst, parse_number( fields[ next ], lengths[ next ], "delay" ) );
+        break;
+    default:
+        throw runtime_error( "Unknown event type: " + string( fields[ 1 ], lengths[ 1 ] ) );
+    }
+}
+
+static void analyze_text( const char * p, const char * const end,
+                          const int64_t base, LogAnalysis & analysis )
+{
+    while ( p < end ) {
+        const char * newline = static_cast<const char *>( memchr( p, '\n', end - p ) );
+        if ( not newline ) {
+            newline = end;
+        }
+
+        analyze_line( p, newline, base, analysis );
+        p = newline + 1;
+    }
+}
+
+static void analyze_records( const LinkLogRecord * event, const LinkLogRecord * const end,
+                             const int64_t base, LogAnalysis & analysis )
+{
+    /* the same ms values mm-log-convert would print */
+    for ( ; event < end; event++ ) {
+        const int64_t timestamp = int64_t( event->time / 1000 ) - base;
+        switch ( event->type ) {
+        case LinkLogRecord::Arrival:
+            analysis.arrival( timestamp, event->bytes, event->src_port, event->dst_port );
+            break;
+        case LinkLogRecord::Opportunity:
+            analysis.opportunity( timestamp, event->bytes );
+            break;
+        case LinkLogRecord::Departure:
+            analysis.departure( timestamp, event->bytes, event->src_port, event->dst_port, event->delay / 1000 );
+            break;
+        case LinkLogRecord::Summary:
+            analysis.summary( event->time, event->delay );
+            break;
+        default:
+            throw runtime_error( "Unknown event type in binary log: " + to_string( event->type ) );
+        }
+    }
+}
+
+/* run job( i, analysis ) for each part on its own thread, then merge the parts in order */
+template <typename Job>
+static LogAnalysis analyze_in_parts( const unsigned int parts, const uint64_t ms_per_bin, const Job & job )
+{
+    vector<LogAnalysis> analyses( parts, LogAnalysis( ms_per_bin ) );
+    vector<exception_ptr> errors( parts );
+    vector<thread> threads;
+
+    for ( unsigned int i = 0; i < parts; i++ ) {
+        threads.emplace_back( [&, i] () {
+                try {
+                    job( i, analyses[ i ] );
+                } catch ( ... ) {
+                    errors[ i ] = current_exception();
+                }
+            } );
+    }
+
+    for ( auto & x : threads ) {
+        x.join();
+    }
+
+    for ( const auto & x : errors ) {
+        if ( x ) {
+            rethrow_exception( x );
+        }
+    }
+
+    for ( unsigned int i = 1; i < parts; i++ ) {
+        analyses.front().merge( analyses[ i ] );
+    }
+
+    return move( analyses.front() );
+}
+
+static const uint64_t MIN_BYTES_PER_THREAD = 1 << 20;
+
+LogAnalysis analyze_log( const string & filename, const uint64_t ms_per_bin,
+                         const unsigned int threads )
+{
+    const MappedFile file( filename );
+
+    if ( BinaryLinkLogReader::recognizes( file ) ) {
+        const BinaryLinkLogReader log( filename );
+        const int64_t base = base_timestamp( log.header() );
+
+        const uint64_t parts = max( uint64_t( 1 ), min( uint64_t( threads ),
+                                    log.size() * sizeof( LinkLogRecord ) / MIN_BYTES_PER_THREAD ) );
+
+        return analyze_in_parts( parts, ms_per_bin, [&] ( const unsigned int i, LogAnalysis & analysis ) {
+                analyze_records( log.begin() + log.size() * i / parts,
+                                 log.begin() + log.size() * ( i + 1 ) / parts,
+                                 base, analysis );
+            } );
+    }
+
+    /* the header is the run of '#' lines at the top */
+    const char * const begin = file.data(), * const end = file.data() + file.size();
+    const char * body = begin;
+    while ( body < end and *body == '#' ) {
+        const char * const newline = static_cast<const char *>( memchr( body, '\n', end - body ) );
+        body = newline ? newline + 1 : end;
+    }
+
+    const int64_t base = base_timestamp( string( begin, body ) );
+
+    /* split the rest at line boundaries */
+    const uint64_t parts = max( uint64_t( 1 ), min( uint64_t( threads ), uint64_t( end - body ) / MIN_BYTES_PER_THREAD ) );
+    vector<const char *> boundaries = { body };
+    for ( unsigned int i = 1; i < parts; i++ ) {
+        const char * p = max( boundaries.back(), body + ( end - body ) * i / parts );
+        const char * const newline = static_cast<const char *>( memchr( p, '\n', end - p ) );
+        boundaries.push_back( newline ? newline + 1 : end );
+    }
+    boundaries.push_back( end );
+
+    return analyze_in_parts( parts, ms_per_bin, [&] ( const unsigned int i, LogAnalysis & analysis ) {
+            analyze_text( boundaries[ i ], boundaries[ i + 1 ], base, analysis );
+        } );
+}
@@ -0,0 +1,171 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef LOG_ANALYSIS_HH
+#define LOG_ANALYSIS_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+/* distribution of delays in ms: exact below 1024 ms and within 0.2%
+   above, in at most a few thousand counters; sketches of parts of a
+   log merge into the sketch of the whole */
+class DelaySketch
+{
+private:
+    static const unsigned int EXACT_LIMIT = 1024;
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_, sum_, max_;
+
+    static unsigned int bucket( const uint64_t delay );
+    static uint64_t bucket_value( const unsigned int bucket );
+
+public:
+    DelaySketch();
+
+    void add( const uint64_t delay, const uint64_t count = 1 );
+    void merge( const DelaySketch & other );
+
+    uint64_t count( void ) const { return count_; }
+    uint64_t max( void ) const { return max_; }
+    double mean( void ) const { return count_ ? double( sum_ ) / count_ : 0; }
+
+    /* the delay at position floor( q * count ) in sorted order, as
+       mm-delay-graph picks its percentiles */
+    uint64_t quantile( const double q ) const;
+};
+
+/* values indexed by a signed position, growing as needed in both directions */
+template <typename T>
+class DenseSeries
+{
+private:
+    int64_t first_;
+    std::vector<T> values_;
+    T empty_;
+
+public:
+    DenseSeries( const T & empty ) : first_( 0 ), values_(), empty_( empty ) {}
+
+    T & at( const int64_t i );
+
+    bool empty( void ) const { return values_.empty(); }
+    int64_t first( void ) const { return first_; }
+    int64_t last( void ) const { return first_ + values_.size() - 1; }
+    const T & operator[]( const int64_t i ) const;
+};
+
+template <typename T>
+T & DenseSeries<T>::at( const int64_t i )
+{
+    if ( values_.empty() ) {
+        first_ = i;
+    }
+
+    if ( i < first_ ) {
+        /* grow at the front by at least the current size, so repeated growth stays cheap */
+        const uint64_t grow = std::max( uint64_t( first_ - i ), uint64_t( values_.size() ) );
+        values_.insert( values_.begin(), grow, empty_ );
+        first_ -= grow;
+    } else if ( i > last() ) {
+        values_.resize( i - first_ + 1, empty_ );
+    }
+
+    return values_[ i - first_ ];
+}
+
+template <typename T>
+const T & DenseSeries<T>::operator[]( const int64_t i ) const
+{
+    if ( i < first_ or i > last() ) {
+        return empty_;
+    }
+
+    return values_[ i - first_ ];
+}
+
+/* throughput, capacity, delay and per-flow statistics of an mm-link log */
+class LogAnalysis
+{
+public:
+    struct Bin
+    {
+        uint64_t capacity, arrivals, departures; /* bits */
+        uint64_t departed_packets, delay_sum, delay_max;
+    };
+
+    struct Flow
+    {
+        uint64_t arrived_packets, arrived_bytes, departed_packets, departed_bytes;
+        int64_t first_event, last_event; /* ms */
+        DelaySketch delays;
+
+        Flow();
+    };
+
+private:
+    uint64_t ms_per_bin_;
+
+    bool have_events_;
+    int64_t first_timestamp_, last_timestamp_; /* ms since the base timestamp */
+    uint64_t capacity_sum_, arrival_sum_, departure_sum_; /* bits */
+
+    DenseSeries<Bin> bins_;
+    DenseSeries<uint64_t> signal_delay_; /* least delay of a packet sent in each ms */
+    DelaySketch delays_;
+    std::unordered_map<uint32_t, Flow> flows_; /* by src port << 16 | dst port */
+
+    bool have_summary_;
+    uint64_t drops_, marks_;
+
+    void saw_event( const int64_t timestamp );
+    Bin & bin( const int64_t timestamp );
+    Flow & flow( const uint16_t src_port, const uint16_t dst_port );
+
+public:
+    LogAnalysis( const uint64_t ms_per_bin );
+
+    /* timestamps in ms since the log's base timestamp */
+    void arrival( const int64_t timestamp, const uint64_t bytes,
+                  const uint16_t src_port, const uint16_t dst_port );
+    void opportunity( const int64_t timestamp, const uint64_t bytes );
+    void departure( const int64_t timestamp, const uint64_t bytes,
+                    const uint16_t src_port, const uint16_t dst_port,
+                    const uint64_t delay );
+    void summary( const uint64_t drops, const uint64_t marks );
+
+    void merge( const LogAnalysis & other );
+
+    uint64_t ms_per_bin( void ) const { return ms_per_bin_; }
+    bool have_events( void ) const { return have_events_; }
+    int64_t first_timestamp( void ) const { return first_timestamp_; }
+    int64_t last_timestamp( void ) const { return last_timestamp_; }
+
+    /* averages over the whole log, in Mbits/s */
+    double average_capacity( void ) const;
+    double average_ingress( void ) const;
+    double average_throughput( void ) const;
+
+    const DenseSeries<Bin> & bins( void ) const { return bins_; }
+    const DelaySketch & delays( void ) const { return delays_; }
+    const std::unordered_map<uint32_t, Flow> & flows( void ) const { return flows_; }
+
+    /* the queue's drops and CE marks, from the summary at the end of the log */
+    bool have_summary( void ) const { return have_summary_; }
+    uint64_t drops( void ) const { return drops_; }
+    uint64_t marks( void ) const { return marks_; }
+
+    /* Signal delay at each ms: the least time for a message created
+       then to reach the receiver. An ms in which no departed packet
+       was sent waits for the next one that was. */
+    DelaySketch signal_delays( void ) const;
+};
+
+/* analyze a text or binary (--binary-log) log, splitting it among up to threads threads */
+LogAnalysis analyze_log( const std::string & filename, const uint64_t ms_per_bin,
+                         const unsigned int threads );
+
+#endif /* LOG_ANALYSIS_HH */
@@ -0,0 +1,65 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* convert a binary mm-link log (--binary-log) to the text format */
+
+#include <iostream>
+#include <fstream>
+
+#include "link_log.hh"
+#include "exception.hh"
+
+using namespace std;
+
+void usage_error( const string & program_name )
+{
+    cerr << "Usage: " << program_name << " BINARY-LOG [TEXT-LOG]" << endl;
+    cerr << endl;
+    cerr << "Writes BINARY-LOG in the text format read by mm-throughput-graph and" << endl;
+    cerr << "mm-delay-graph, to TEXT-LOG or standard output." << endl;
+
+    throw runtime_error( "invalid arguments" );
+}
+
+static void convert( const BinaryLinkLogReader & log, ostream & out )
+{
+    TextLinkLog text( out, log.header(), false );
+
+    for ( const auto & event : log ) {
+        text.record( event );
+    }
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        if ( argc < 1 ) {
+            throw runtime_error( "missing argv[ 0 ]" );
+        }
+
+        if ( argc != 2 and argc != 3 ) {
+            usage_error( argv[ 0 ] );
+        }
+
+        const BinaryLinkLogReader log( argv[ 1 ] );
+
+        if ( argc == 2 or string( argv[ 2 ] ) == "-" ) {
+            convert( log, cout );
+            cout << flush;
+        } else {
+            ofstream out( argv[ 2 ] );
+            if ( not out.good() ) {
+                throw runtime_error( string( argv[ 2 ] ) + ": error opening for writing" );
+            }
+            convert( log, out );
+            out.close();
+            if ( out.fail() ) {
+                throw runtime_error( string( argv[ 2 ] ) + ": error writing" );
+            }
+        }
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,47 +1,45 @@
 /* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 #include <limits>
+#include <sstream>
 
 #include "loss_queue.hh"
 #include "timestamp.hh"
+#include "util.hh"
+#include "ezio.hh"
 
 using namespace std;
 
-LossQueue::LossQueue()
-    : prng_( random_device()() )
+LossQueue::LossQueue( const uint64_t seed )
+    : prng_( seed )
 {}
 
-void LossQueue::read_packet( const string & contents )
+void LossQueue::read_packet( const PacketBuffer & contents )
 {
     if ( not drop_packet( contents ) ) {
         packet_queue_.emplace( contents );
     }
 }
 
-void LossQueue::write_packets( FileDescriptor & fd )
+void LossQueue::write_packets( PacketSink & sink )
 {
     while ( not packet_queue_.empty() ) {
-        fd.write( packet_queue_.front() );
+        sink.send( packet_queue_.front() );
         packet_queue_.pop();
     }
 }
 
-unsigned int LossQueue::wait_time( void )
+bool IIDLoss::drop_packet( const PacketBuffer & packet __attribute((unused)) )
 {
-    return packet_queue_.empty() ? numeric_limits<uint16_t>::max() : 0;
-}
-
-bool IIDLoss::drop_packet( const string & packet __attribute((unused)) )
-{
-    return drop_dist_( prng_ );
+    return prng_.uniform() < loss_rate_;
 }
 
 static const double MS_PER_SECOND = 1000.0;
 
 SwitchingLink::SwitchingLink( const double mean_on_time, const double mean_off_time )
     : link_is_on_( false ),
-      on_process_( 1.0 / (MS_PER_SECOND * mean_off_time) ),
-      off_process_( 1.0 / (MS_PER_SECOND * mean_on_time) ),
+      mean_on_time_( MS_PER_SECOND * mean_on_time ),
+      mean_off_time_( MS_PER_SECOND * mean_off_time ),
       next_switch_time_( timestamp() )
 {}
 
@@ -54,29 +52,140 @@ uint64_t bound( const double x )
     return x;
 }
 
-unsigned int SwitchingLink::wait_time( void )
+/* play the on/off process forward to the given time (only arrivals can observe it) */
+void SwitchingLink::catch_up( const uint64_t now )
 {
-    const uint64_t now = timestamp();
-
     while ( next_switch_time_ <= now ) {
         /* switch */
         link_is_on_ = !link_is_on_;
         /* worried about integer overflow when mean time = 0 */
-        next_switch_time_ += bound( (link_is_on_ ? off_process_ : on_process_)( prng_ ) );
+        next_switch_time_ += bound( (link_is_on_ ? mean_on_time_ : mean_off_time_) * prng_.exponential() );
     }
+}
+
+bool SwitchingLink::drop_packet( const PacketBuffer & packet __attribute((unused)) )
+{
+    catch_up( timestamp() );
 
-    if ( LossQueue::wait_time() == 0 ) {
-        return 0;
+    return !link_is_on_;
+}
+
+/* the comma-separated probabilities of a model, with defaults for those left off */
+static vector<double> probabilities( const string & spec, const string & list,
+                                     const size_t required, const vector<double> & defaults )
+{
+    vector<double> ret;
+    istringstream fields( list );
+    string field;
+    while ( getline( fields, field, ',' ) ) {
+        ret.push_back( myatof( field ) );
+        if ( not ( 0 <= ret.back() and ret.back() <= 1 ) ) {
+            throw runtime_error( "loss \"" + spec + "\": probabilities must be between 0 and 1" );
+        }
     }
 
-    if ( next_switch_time_ - now > numeric_limits<uint16_t>::max() ) {
-        return numeric_limits<uint16_t>::max();
+    if ( ret.size() < required or ret.size() > required + defaults.size() ) {
+        throw runtime_error( "loss \"" + spec + "\": expected " + ::to_string( required ) + " to "
+                             + ::to_string( required + defaults.size() ) + " probabilities" );
     }
 
-    return next_switch_time_ - now;
+    ret.insert( ret.end(), defaults.begin() + ( ret.size() - required ), defaults.end() );
+    return ret;
 }
 
-bool SwitchingLink::drop_packet( const string & packet __attribute((unused)) )
+void BurstLoss::parse( const string & spec, vector<State> & states,
+                       string & trace_filename, uint64_t & slot_us )
 {
-    return !link_is_on_;
+    states.clear();
+    trace_filename.clear();
+    slot_us = 0;
+
+    const size_t colon = spec.find( ':' );
+    const string model = spec.substr( 0, colon );
+    const string arguments = colon == string::npos ? "" : spec.substr( colon + 1 );
+
+    if ( colon == string::npos ) {
+        const double rate = probabilities( spec, spec, 1, {} ).at( 0 );
+        states = { { rate, {} } };
+    } else if ( model == "gilbert" ) {
+        const vector<double> p = probabilities( spec, arguments, 2, { 1, 0 } );
+        states = { { p[ 3 ], { { p[ 0 ], 1 } } },   /* good */
+                   { p[ 2 ], { { p[ 1 ], 0 } } } }; /* bad */
+    } else if ( model == "4state" ) {
+        const vector<double> p = probabilities( spec, arguments, 1, { -1, 0, 1, 0 } );
+        const double p13 = p[ 0 ], p31 = p[ 1 ] < 0 ? 1 - p13 : p[ 1 ], p32 = p[ 2 ], p23 = p[ 3 ], p14 = p[ 4 ];
+        if ( p13 + p14 > 1 or p31 + p32 > 1 ) {
+            throw runtime_error( "loss \"" + spec + "\": probabilities of leaving a state add up to more than 1" );
+        }
+        states = { { 0, { { p14, 3 }, { p14 + p13, 2 } } }, /* 1: good */
+                   { 0, { { p23, 2 } } },                   /* 2: good, within a burst */
+                   { 1, { { p32, 1 }, { p32 + p31, 0 } } }, /* 3: lost, within a burst */
+                   { 1, { { 1, 0 } } } };                   /* 4: isolated loss */
+    } else if ( model == "trace" ) {
+        const size_t comma = arguments.rfind( ',' );
+        trace_filename = arguments.substr( 0, comma );
+        if ( comma != string::npos ) {
+            const double slot_ms = myatof( arguments.substr( comma + 1 ) );
+            if ( not ( slot_ms > 0 ) ) {
+                throw runtime_error( "loss \"" + spec + "\": slot must be longer than 0 ms" );
+            }
+            slot_us = max( 1.0, slot_ms * 1000 );
+        }
+        if ( trace_filename.empty() ) {
+            throw runtime_error( "loss \"" + spec + "\": expected trace:FILE[,SLOT-MS]" );
+        }
+    } else {
+        throw runtime_error( "loss \"" + spec + "\": unknown model (RATE, gilbert:, 4state: or trace:)" );
+    }
+}
+
+void BurstLoss::check( const string & spec )
+{
+    vector<State> states;
+    string trace_filename;
+    uint64_t slot_us;
+    parse( spec, states, trace_filename, slot_us );
+}
+
+BurstLoss::BurstLoss( const string & spec, const uint64_t seed )
+    : LossQueue( seed ),
+      states_(),
+      state_( 0 ),
+      trace_( nullptr ),
+      slot_us_( 0 ),
+      base_timestamp_( timestamp_us() ),
+      packets_( 0 )
+{
+    string trace_filename;
+    parse( spec, states_, trace_filename, slot_us_ );
+
+    if ( not trace_filename.empty() ) {
+        /* trace files are only opened once privileges are dropped */
+        assert_not_root();
+        trace_.reset( new MappedFile( trace_filename ) );
+    }
+}
+
+bool BurstLoss::drop_packet( const PacketBuffer & packet __attribute((unused)) )
+{
+    if ( trace_ ) {
+        const uint64_t bit = ( slot_us_ ? ( timestamp_us() - base_timestamp_ ) / slot_us_ : packets_++ )
+            % ( trace_->size() * 8 );
+        return ( trace_->data()[ bit / 8 ] >> ( bit % 8 ) ) & 1;
+    }
+
+    const State & current = states_[ state_ ];
+    if ( not current.transitions.empty() ) {
+        const double draw = prng_.uniform();
+        for ( const auto & transition : current.transitions ) {
+            if ( draw < transition.first ) {
+                state_ = transition.second;
+                break;
+            }
+        }
+    }
+
+    /* the states of the four-state model lose all or nothing, without a draw */
+    const double loss = states_[ state_ ].loss;
+    return loss >= 1 or ( loss > 0 and prng_.uniform() < loss );
 }
@@ -6,63 +6,118 @@
 #include <queue>
 #include <cstdint>
 #include <string>
+#include <vector>
+#include <memory>
 #include <random>
 
-#include "file_descriptor.hh"
+#include "packet_sink.hh"
+#include "prng.hh"
+#include "mapped_file.hh"
+
+class ControlSocket;
 
 class LossQueue
 {
 private:
-    std::queue<std::string> packet_queue_ {};
+    std::queue<PacketBuffer> packet_queue_ {};
 
-    virtual bool drop_packet( const std::string & packet ) = 0;
+    virtual bool drop_packet( const PacketBuffer & packet ) = 0;
 
 protected:
-    std::default_random_engine prng_;
+    Prng prng_;
 
 public:
-    LossQueue();
+    /* a seed of 0 picks one at random */
+    LossQueue( const uint64_t seed = 0 );
     virtual ~LossQueue() {}
 
-    void read_packet( const std::string & contents );
+    void read_packet( const PacketBuffer & contents );
 
-    void write_packets( FileDescriptor & fd );
+    void write_packets( PacketSink & sink );
 
-    unsigned int wait_time( void );
+    static uint64_t next_event_time( void ) { return -1; }
 
     bool pending_output( void ) const { return not packet_queue_.empty(); }
 
     static bool finished( void ) { return false; }
+
+    /* takes no commands (see LinkQueue) */
+    static ControlSocket * control_socket( void ) { return nullptr; }
+    static std::string control( const std::string & ) { return ""; }
 };
 
 class IIDLoss : public LossQueue
 {
 private:
-    std::bernoulli_distribution drop_dist_;
+    double loss_rate_;
+
+    bool drop_packet( const PacketBuffer & packet ) override;
+
+public:
+    IIDLoss( const double loss_rate, const uint64_t seed = 0 ) : LossQueue( seed ), loss_rate_( loss_rate ) {}
+};
+
+/* Bursty loss, from a Markov model or replayed from a trace:
+     RATE                          each packet lost with probability RATE, as IIDLoss
+     gilbert:P,R[,LOSS-BAD[,LOSS-GOOD]]
+                                   Gilbert-Elliott: a good state that turns bad with
+                                   probability P at each packet, and a bad state that
+                                   turns good with probability R; packets are lost with
+                                   probability LOSS-BAD (default 1) in the bad state and
+                                   LOSS-GOOD (default 0) in the good one
+     4state:P13[,P31[,P32[,P23[,P14]]]]
+                                   the four-state model of netem (Salsano et al.), from
+                                   (1) good, to (3) a loss burst or (4) an isolated loss,
+                                   and from 3 back to 1 or to (2) good within a burst
+     trace:FILE[,SLOT-MS]          a bitmap, lowest bit first, where bit i set means
+                                   packet i is lost, or with SLOT-MS, every packet in
+                                   the i-th slot of SLOT-MS since the start; the file is
+                                   mapped into memory and starts over after its last bit
+   As in netem, each packet first moves the model to its next state, then
+   is lost or not by the state it is in. */
+class BurstLoss : public LossQueue
+{
+private:
+    struct State
+    {
+        double loss;
+        std::vector<std::pair<double, unsigned int>> transitions; /* cumulative probability, next state */
+    };
+
+    std::vector<State> states_;
+    unsigned int state_;
+
+    std::unique_ptr<MappedFile> trace_;
+    uint64_t slot_us_; /* 0 for a bit per packet */
+    uint64_t base_timestamp_;
+    uint64_t packets_;
 
-    bool drop_packet( const std::string & packet ) override;
+    static void parse( const std::string & spec, std::vector<State> & states,
+                       std::string & trace_filename, uint64_t & slot_us );
+
+    bool drop_packet( const PacketBuffer & packet ) override;
 
 public:
-    IIDLoss( const double loss_rate ) : drop_dist_( loss_rate ) {}
+    BurstLoss( const std::string & spec, const uint64_t seed );
+
+    /* throws if the spec is malformed, without opening a trace */
+    static void check( const std::string & spec );
 };
 
 class SwitchingLink : public LossQueue
 {
 private:
     bool link_is_on_;
-    std::exponential_distribution<> on_process_;
-    std::exponential_distribution<> off_process_;
+    double mean_on_time_, mean_off_time_; /* ms */
 
     uint64_t next_switch_time_;
 
-    void calculate_next_switch_time( void );
+    void catch_up( const uint64_t now );
 
-    bool drop_packet( const std::string & packet ) override;
+    bool drop_packet( const PacketBuffer & packet ) override;
 
 public:
     SwitchingLink( const double mean_on_time_, const double mean_off_time );
-
-    unsigned int wait_time( void );
 };
 
 #endif /* LOSS_QUEUE_HH */
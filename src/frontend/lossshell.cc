@@ -15,7 +15,9 @@ using namespace std;
 
 void usage( const string & program_name )
 {
-    throw runtime_error( "Usage: " + program_name + " uplink|downlink RATE [COMMAND...]" );
+    throw runtime_error( "Usage: " + program_name + " [--seed=N] uplink|downlink MODEL [COMMAND...]\n"
+                         "MODEL = RATE | gilbert:P,R[,LOSS-BAD[,LOSS-GOOD]]"
+                         " | 4state:P13[,P31[,P32[,P23[,P14]]]] | trace:FILENAME[,SLOT-MS]" );
 }
 
 int main( int argc, char *argv[] )
@@ -27,40 +29,60 @@ int main( int argc, char *argv[] )
 
         check_requirements( argc, argv );
 
-        if ( argc < 3 ) {
-            usage( argv[ 0 ] );
+        const option command_line_options[] = {
+            { "seed", required_argument, nullptr, 's' },
+            { 0,                      0, nullptr, 0 }
+        };
+
+        uint64_t seed = 0;
+
+        while ( true ) {
+            const int opt = getopt_long( argc, argv, "+", command_line_options, nullptr );
+            if ( opt == -1 ) { /* end of options */
+                break;
+            }
+
+            switch ( opt ) {
+            case 's':
+                seed = myatoi( optarg );
+                break;
+            case '?':
+                usage( argv[ 0 ] );
+                break;
+            default:
+                throw runtime_error( "getopt_long: unexpected return value " + to_string( opt ) );
+            }
         }
 
-        const double loss_rate = myatof( argv[ 2 ] );
-        if ( (0 <= loss_rate) and (loss_rate <= 1) ) {
-            /* do nothing */
-        } else {
-            cerr << "Error: loss rate must be between 0 and 1." << endl;
+        if ( optind + 2 > argc ) {
             usage( argv[ 0 ] );
         }
 
-        double uplink_loss = 0, downlink_loss = 0;
+        const string model = argv[ optind + 1 ];
+        BurstLoss::check( model ); /* now, not in the ferries */
+
+        string uplink_loss = "0", downlink_loss = "0";
 
-        const string link = argv[ 1 ];
+        const string link = argv[ optind ];
         if ( link == "uplink" ) {
-            uplink_loss = loss_rate;
+            uplink_loss = model;
         } else if ( link == "downlink" ) {
-            downlink_loss = loss_rate;
+            downlink_loss = model;
         } else {
             usage( argv[ 0 ] );
         }
 
         vector<string> command;
 
-        if ( argc == 3 ) {
+        if ( optind + 2 == argc ) {
             command.push_back( shell_path() );
         } else {
-            for ( int i = 3; i < argc; i++ ) {
+            for ( int i = optind + 2; i < argc; i++ ) {
                 command.push_back( argv[ i ] );
             }
         }
 
-        PacketShell<IIDLoss> loss_app( "loss", user_environment );
+        PacketShell<BurstLoss> loss_app( "loss", user_environment );
 
         string shell_prefix = "[loss ";
         if ( link == "uplink" ) {
@@ -68,13 +90,13 @@ int main( int argc, char *argv[] )
         } else {
             shell_prefix += "down=";
         }
-        shell_prefix += argv[ 2 ];
+        shell_prefix += model;
         shell_prefix += "] ";
 
         loss_app.start_uplink( shell_prefix,
                                command,
-                               uplink_loss );
-        loss_app.start_downlink( downlink_loss );
+                               uplink_loss, seed );
+        loss_app.start_downlink( downlink_loss, seed );
         return loss_app.wait_for_exit();
     } catch ( const exception & e ) {
         print_exception( e );
@@ -1,5 +1,7 @@
 /* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
+#include <limits>
+
 #include "meter_queue.hh"
 #include "util.hh"
 #include "timestamp.hh"
@@ -17,7 +19,7 @@ MeterQueue::MeterQueue( const string & name, const bool graph )
     }
 }
 
-void MeterQueue::read_packet( const string & contents )
+void MeterQueue::read_packet( const PacketBuffer & contents )
 {
     packet_queue_.emplace( contents );
 
@@ -27,15 +29,11 @@ void MeterQueue::read_packet( const string & contents )
     }
 }
 
-void MeterQueue::write_packets( FileDescriptor & fd )
+void MeterQueue::write_packets( PacketSink & sink )
 {
     while ( not packet_queue_.empty() ) {
-        fd.write( packet_queue_.front() );
+        sink.send( packet_queue_.front() );
         packet_queue_.pop();
     }
 }
 
-unsigned int MeterQueue::wait_time( void ) const
-{
-    return packet_queue_.empty() ? numeric_limits<uint16_t>::max() : 0;
-}
@@ -4,30 +4,37 @@
 #define METER_QUEUE_HH
 
 #include <queue>
+#include <cstdint>
 #include <string>
 #include <memory>
 
-#include "file_descriptor.hh"
+#include "packet_sink.hh"
 #include "binned_livegraph.hh"
 
+class ControlSocket;
+
 class MeterQueue
 {
 private:
-    std::queue<std::string> packet_queue_;
+    std::queue<PacketBuffer> packet_queue_;
     std::unique_ptr<BinnedLiveGraph> graph_;
 
 public:
     MeterQueue( const std::string & name, const bool graph );
 
-    void read_packet( const std::string & contents );
+    void read_packet( const PacketBuffer & contents );
 
-    void write_packets( FileDescriptor & fd );
+    void write_packets( PacketSink & sink );
 
-    unsigned int wait_time( void ) const;
+    static uint64_t next_event_time( void ) { return -1; }
 
     bool pending_output( void ) const { return not packet_queue_.empty(); }
 
     static bool finished( void ) { return false; }
+
+    /* takes no commands (see LinkQueue) */
+    static ControlSocket * control_socket( void ) { return nullptr; }
+    static std::string control( const std::string & ) { return ""; }
 };
 
 #endif /* METER_QUEUE_HH */
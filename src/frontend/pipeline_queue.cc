@@ -0,0 +1,271 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <sstream>
+#include <algorithm>
+
+#include "pipeline_queue.hh"
+#include "delay_queue.hh"
+#include "link_queue.hh"
+#include "loss_queue.hh"
+#include "reorder_queue.hh"
+#include "meter_queue.hh"
+#include "packet_queue_factory.hh"
+#include "ezio.hh"
+
+using namespace std;
+
+/* positional arguments each type of stage takes, and its options */
+static const map<string, unsigned int> stage_arguments = {
+    { "delay", 1 }, { "link", 1 }, { "loss", 1 }, { "onoff", 2 }, { "meter", 0 }, { "reorder", 1 }
+};
+
+static const map<string, map<string, bool>> stage_options = { /* takes a value? */
+    { "delay", { { "trace", true }, { "jitter", true }, { "in-order", false }, { "seed", true } } },
+    { "loss", { { "seed", true } } },
+    { "reorder", { { "reorder", true }, { "gap", true }, { "duplicate", true }, { "seed", true } } },
+    { "link", { { "queue", true }, { "queue-args", true }, { "bdp", true }, { "log", true }, { "control", true },
+                { "binary-log", false }, { "cbr", false }, { "once", false }, { "meter", false },
+                { "meter-delay", false } } }
+};
+
+static unique_ptr<AbstractPacketQueue> make_link_packet_queue( const PipelineStageSpec & spec );
+static string option_or( const PipelineStageSpec & spec, const string & name, const string & fallback );
+static ReorderQueue make_reorder_queue( const PipelineStageSpec & spec );
+
+PipelineStageSpec::PipelineStageSpec( const string & stage )
+    : type(),
+      arguments(),
+      options()
+{
+    istringstream words( stage );
+    if ( not ( words >> type ) ) {
+        throw runtime_error( "empty pipeline stage" );
+    }
+
+    const auto expected = stage_arguments.find( type );
+    if ( expected == stage_arguments.end() ) {
+        throw runtime_error( "unknown pipeline stage \"" + type + "\" (delay, link, loss, onoff, meter or reorder)" );
+    }
+
+    string word;
+    while ( arguments.size() < expected->second and words >> word ) {
+        arguments.push_back( word );
+    }
+
+    if ( arguments.size() < expected->second ) {
+        throw runtime_error( "\"" + stage + "\": " + type + " takes "
+                             + ::to_string( expected->second ) + " argument(s)" );
+    }
+
+    while ( words >> word ) {
+        const size_t equals = word.find( '=' );
+        const string name = word.substr( 0, equals );
+        const auto options_allowed = stage_options.find( type );
+        const auto option = options_allowed == stage_options.end()
+            ? map<string, bool>::const_iterator() : options_allowed->second.find( name );
+
+        if ( options_allowed == stage_options.end() or option == options_allowed->second.end() ) {
+            throw runtime_error( "\"" + stage + "\": unexpected \"" + word + "\"" );
+        }
+
+        if ( option->second != ( equals != string::npos ) ) {
+            throw runtime_error( "\"" + stage + "\": " + name
+                                 + ( option->second ? " needs a value" : " takes no value" ) );
+        }
+
+        options[ name ] = equals == string::npos ? "" : word.substr( equals + 1 );
+    }
+
+    /* check the numbers now, rather than once the ferries are running */
+    if ( type == "delay" ) {
+        myatoi( arguments.at( 0 ) );
+        if ( options.count( "jitter" ) ) {
+            DelayJitter( options.at( "jitter" ), 0 );
+        }
+        if ( options.count( "seed" ) ) {
+            myatoi( options.at( "seed" ) );
+        }
+    } else if ( type == "loss" ) {
+        BurstLoss::check( arguments.at( 0 ) );
+        if ( options.count( "seed" ) ) {
+            myatoi( options.at( "seed" ) );
+        }
+    } else if ( type == "onoff" ) {
+        const double on_time = myatof( arguments.at( 0 ) ), off_time = myatof( arguments.at( 1 ) );
+        if ( not ( 0 <= on_time and 0 <= off_time ) or ( on_time == 0 and off_time == 0 ) ) {
+            throw runtime_error( "\"" + stage + "\": mean on-time and off-time must be at least 0 seconds, and not both 0" );
+        }
+    } else if ( type == "reorder" ) {
+        if ( myatoi( option_or( *this, "gap", "1" ) ) < 1 ) {
+            throw runtime_error( "\"" + stage + "\": gap must be at least 1" );
+        }
+        make_reorder_queue( *this );
+        myatoi( option_or( *this, "seed", "0" ) );
+    } else if ( type == "link" ) {
+        make_link_packet_queue( *this );
+    }
+}
+
+static string option_or( const PipelineStageSpec & spec, const string & name, const string & fallback )
+{
+    const auto option = spec.options.find( name );
+    return option == spec.options.end() ? fallback : option->second;
+}
+
+static unique_ptr<AbstractPacketQueue> make_link_packet_queue( const PipelineStageSpec & spec )
+{
+    const string type = option_or( spec, "queue", "infinite" );
+
+    unique_ptr<AbstractPacketQueue> ret = make_packet_queue( type, option_or( spec, "queue-args", "" ) );
+    if ( not ret ) {
+        throw runtime_error( "unknown queue type \"" + type + "\" (" + packet_queue_types() + ")" );
+    }
+
+    if ( spec.options.count( "bdp" ) ) {
+        ret->set_bdp( myatoi( spec.options.at( "bdp" ) ) );
+    }
+
+    return ret;
+}
+
+static ReorderQueue make_reorder_queue( const PipelineStageSpec & spec )
+{
+    return ReorderQueue( myatoi( spec.arguments.at( 0 ) ),
+                         myatof( option_or( spec, "reorder", "0" ) ),
+                         myatoi( option_or( spec, "gap", "1" ) ),
+                         myatof( option_or( spec, "duplicate", "0" ) ),
+                         myatoi( option_or( spec, "seed", "0" ) ) );
+}
+
+template <class FerryQueueType>
+class FerryQueueStage : public PipelineStage
+{
+private:
+    FerryQueueType queue_;
+
+public:
+    template <typename... Targs>
+    FerryQueueStage( Targs&&... Fargs ) : queue_( std::forward<Targs>( Fargs )... ) {}
+
+    void read_packet( const PacketBuffer & contents ) override { queue_.read_packet( contents ); }
+    void write_packets( PacketSink & sink ) override { queue_.write_packets( sink ); }
+    uint64_t next_event_time( void ) const override { return queue_.next_event_time(); }
+    bool pending_output( void ) const override { return queue_.pending_output(); }
+    bool finished( void ) const override { return queue_.finished(); }
+    ControlSocket * control_socket( void ) override { return queue_.control_socket(); }
+    string control( const string & command ) override { return queue_.control( command ); }
+};
+
+/* hands a stage's output to the next stage */
+class StageSink : public PacketSink
+{
+private:
+    PipelineStage & next_;
+
+public:
+    StageSink( PipelineStage & next ) : next_( next ) {}
+
+    void send( const PacketBuffer & packet ) override { next_.read_packet( packet ); }
+};
+
+static unique_ptr<PipelineStage> make_stage( const string & direction, const PipelineStageSpec & spec,
+                                             const string & command_line )
+{
+    if ( spec.type == "delay" ) {
+        return unique_ptr<PipelineStage>( new FerryQueueStage<DelayQueue>( myatoi( spec.arguments.at( 0 ) ),
+                                                                           option_or( spec, "trace", "" ),
+                                                                           option_or( spec, "jitter", "" ),
+                                                                           spec.options.count( "in-order" ) > 0,
+                                                                           myatoi( option_or( spec, "seed", "0" ) ) ) );
+    } else if ( spec.type == "loss" ) {
+        return unique_ptr<PipelineStage>( new FerryQueueStage<BurstLoss>( spec.arguments.at( 0 ),
+                                                                          myatoi( option_or( spec, "seed", "0" ) ) ) );
+    } else if ( spec.type == "onoff" ) {
+        return unique_ptr<PipelineStage>( new FerryQueueStage<SwitchingLink>( myatof( spec.arguments.at( 0 ) ),
+                                                                              myatof( spec.arguments.at( 1 ) ) ) );
+    } else if ( spec.type == "reorder" ) {
+        return unique_ptr<PipelineStage>( new FerryQueueStage<ReorderQueue>( make_reorder_queue( spec ) ) );
+    } else if ( spec.type == "meter" ) {
+        return unique_ptr<PipelineStage>( new FerryQueueStage<MeterQueue>( direction, true ) );
+    }
+
+    return unique_ptr<PipelineStage>( new FerryQueueStage<LinkQueue>( direction, spec.arguments.at( 0 ),
+                                                                      option_or( spec, "log", "" ),
+                                                                      not spec.options.count( "once" ),
+                                                                      spec.options.count( "meter" ) > 0,
+                                                                      spec.options.count( "meter-delay" ) > 0,
+                                                                      make_link_packet_queue( spec ),
+                                                                      command_line,
+                                                                      spec.options.count( "cbr" ) > 0,
+                                                                      spec.options.count( "binary-log" ) > 0,
+                                                                      option_or( spec, "control", "" ) ) );
+}
+
+PipelineQueue::PipelineQueue( const string & direction, const vector<string> & stages,
+                              const string & command_line )
+    : stages_(),
+      controlled_( nullptr )
+{
+    for ( const auto & stage : stages ) {
+        stages_.push_back( make_stage( direction, PipelineStageSpec( stage ), command_line ) );
+
+        if ( stages_.back()->control_socket() ) {
+            if ( controlled_ ) {
+                throw runtime_error( direction + ": only one link stage may have a control socket" );
+            }
+            controlled_ = stages_.back().get();
+        }
+    }
+
+    if ( stages_.empty() ) {
+        /* pass packets straight through */
+        stages_.emplace_back( new FerryQueueStage<MeterQueue>( direction, false ) );
+    }
+}
+
+void PipelineQueue::read_packet( const PacketBuffer & contents )
+{
+    stages_.front()->read_packet( contents );
+}
+
+/* in order, so a packet can pass through several stages at once */
+void PipelineQueue::write_packets( PacketSink & sink )
+{
+    for ( size_t i = 0; i + 1 < stages_.size(); i++ ) {
+        StageSink next( *stages_.at( i + 1 ) );
+        stages_.at( i )->write_packets( next );
+    }
+
+    stages_.back()->write_packets( sink );
+}
+
+uint64_t PipelineQueue::next_event_time( void ) const
+{
+    uint64_t ret = -1;
+    for ( const auto & stage : stages_ ) {
+        ret = min( ret, stage->next_event_time() );
+    }
+    return ret;
+}
+
+bool PipelineQueue::pending_output( void ) const
+{
+    return any_of( stages_.begin(), stages_.end(),
+                   [] ( const unique_ptr<PipelineStage> & stage ) { return stage->pending_output(); } );
+}
+
+bool PipelineQueue::finished( void ) const
+{
+    return any_of( stages_.begin(), stages_.end(),
+                   [] ( const unique_ptr<PipelineStage> & stage ) { return stage->finished(); } );
+}
+
+ControlSocket * PipelineQueue::control_socket( void )
+{
+    return controlled_ ? controlled_->control_socket() : nullptr;
+}
+
+string PipelineQueue::control( const string & command )
+{
+    return controlled_ ? controlled_->control( command ) : "";
+}
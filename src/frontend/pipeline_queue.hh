@@ -0,0 +1,88 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef PIPELINE_QUEUE_HH
+#define PIPELINE_QUEUE_HH
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <string>
+
+#include "packet_sink.hh"
+
+class ControlSocket;
+
+/* one stage of a pipeline, as written on the mm-pipeline command line:
+     delay MS [trace=FILE] [jitter=DISTRIBUTION:MS] [in-order] [seed=N]
+     link TRACE [queue=TYPE] [queue-args=ARGS] [bdp=BYTES] [log=FILE]
+                [binary-log] [cbr] [once] [meter] [meter-delay] [control=SOCKET]
+     loss MODEL [seed=N]
+     onoff MEAN-ON-TIME MEAN-OFF-TIME
+     meter
+     reorder MS [reorder=PROBABILITY] [gap=N] [duplicate=PROBABILITY] [seed=N] */
+struct PipelineStageSpec
+{
+    std::string type;
+    std::vector<std::string> arguments;
+    std::map<std::string, std::string> options; /* NAME=VALUE, or NAME with an empty value */
+
+    /* throws if the stage is malformed, before anything is built */
+    PipelineStageSpec( const std::string & stage );
+};
+
+/* any of the ferry queues, behind a common interface */
+class PipelineStage
+{
+public:
+    virtual void read_packet( const PacketBuffer & contents ) = 0;
+    virtual void write_packets( PacketSink & sink ) = 0;
+    virtual uint64_t next_event_time( void ) const = 0;
+    virtual bool pending_output( void ) const = 0;
+    virtual bool finished( void ) const = 0;
+    virtual ControlSocket * control_socket( void ) = 0;
+    virtual std::string control( const std::string & command ) = 0;
+
+    virtual ~PipelineStage() {}
+};
+
+/* The stages of one direction of mm-pipeline, in the order packets
+   pass through them, run in one ferry: a stage's output goes straight
+   to the next stage's read_packet(), sharing the packet's buffer, as
+   it would arrive through the TUN devices between nested shells. */
+class PipelineQueue
+{
+private:
+    std::vector<std::unique_ptr<PipelineStage>> stages_;
+
+    /* the one stage with a control socket, if any */
+    PipelineStage * controlled_;
+
+public:
+    PipelineQueue( const std::string & direction, const std::vector<std::string> & stages,
+                   const std::string & command_line );
+
+    void read_packet( const PacketBuffer & contents );
+
+    void write_packets( PacketSink & sink );
+
+    /* earliest event of any stage (us), or -1 if none */
+    uint64_t next_event_time( void ) const;
+
+    bool pending_output( void ) const;
+
+    /* a link stage given "once" has reached the end of its trace */
+    bool finished( void ) const;
+
+    /* commands go to the link stage given control=, if any */
+    ControlSocket * control_socket( void );
+    std::string control( const std::string & command );
+
+    PipelineQueue( PipelineQueue && other ) = default;
+
+    /* forbid copying */
+    PipelineQueue( const PipelineQueue & other ) = delete;
+    PipelineQueue & operator=( const PipelineQueue & other ) = delete;
+};
+
+#endif /* PIPELINE_QUEUE_HH */
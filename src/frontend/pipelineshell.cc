@@ -0,0 +1,107 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <vector>
+#include <string>
+#include <getopt.h>
+
+#include "pipeline_queue.hh"
+#include "packet_queue_factory.hh"
+#include "util.hh"
+#include "packetshell.cc"
+
+using namespace std;
+
+void usage_error( const string & program_name )
+{
+    cerr << "Usage: " << program_name << " [--uplink=STAGE]... [--downlink=STAGE]... [COMMAND...]" << endl;
+    cerr << endl;
+    cerr << "Runs each direction's stages in order in one process, as the nested shells would:" << endl;
+    cerr << "uplink stages from COMMAND outward, downlink stages from outside toward COMMAND." << endl;
+    cerr << endl;
+    cerr << "STAGE = delay MS [trace=FILENAME] [jitter=DISTRIBUTION:MS] [in-order] [seed=N]" << endl;
+    cerr << "        link TRACE [queue=QUEUE_TYPE] [queue-args=QUEUE_ARGS] [bdp=BYTES]" << endl;
+    cerr << "                   [log=FILENAME] [binary-log] [cbr] [once] [meter] [meter-delay]" << endl;
+    cerr << "                   [control=SOCKET]" << endl;
+    cerr << "        loss MODEL [seed=N]" << endl;
+    cerr << "        onoff MEAN-ON-TIME MEAN-OFF-TIME" << endl;
+    cerr << "        meter" << endl;
+    cerr << "        reorder MS [reorder=PROBABILITY] [gap=N] [duplicate=PROBABILITY] [seed=N]" << endl;
+    cerr << endl;
+    cerr << "        QUEUE_TYPE = " << packet_queue_types() << endl;
+    cerr << "        QUEUE_ARGS = \"NAME=NUMBER[,NAME2=NUMBER2,...]\" (without spaces)" << endl;
+
+    throw runtime_error( "invalid arguments" );
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        /* clear environment while running as root */
+        char ** const user_environment = environ;
+        environ = nullptr;
+
+        check_requirements( argc, argv );
+
+        const option command_line_options[] = {
+            { "uplink",   required_argument, nullptr, 'u' },
+            { "downlink", required_argument, nullptr, 'd' },
+            { 0,          0,                 nullptr, 0 }
+        };
+
+        vector<string> uplink_stages, downlink_stages;
+
+        while ( true ) {
+            const int opt = getopt_long( argc, argv, "+u:d:", command_line_options, nullptr );
+            if ( opt == -1 ) { /* end of options */
+                break;
+            }
+
+            switch ( opt ) {
+            case 'u':
+                uplink_stages.push_back( optarg );
+                break;
+            case 'd':
+                downlink_stages.push_back( optarg );
+                break;
+            case '?':
+                usage_error( argv[ 0 ] );
+                break;
+            default:
+                throw runtime_error( "getopt_long: unexpected return value " + to_string( opt ) );
+            }
+        }
+
+        /* reject a malformed stage before starting anything */
+        for ( const auto & stage : uplink_stages ) {
+            PipelineStageSpec check( stage );
+        }
+        for ( const auto & stage : downlink_stages ) {
+            PipelineStageSpec check( stage );
+        }
+
+        string command_line { shell_quote( argv[ 0 ] ) }; /* for the log files */
+        for ( int i = 1; i < argc; i++ ) {
+            command_line += string( " " ) + shell_quote( argv[ i ] );
+        }
+
+        vector< string > command;
+
+        if ( optind == argc ) {
+            command.push_back( shell_path() );
+        } else {
+            for ( int i = optind; i < argc; i++ ) {
+                command.push_back( argv[ i ] );
+            }
+        }
+
+        PacketShell<PipelineQueue> pipeline_app( "pipeline", user_environment );
+
+        pipeline_app.start_uplink( "[pipeline] ", command,
+                                   "Uplink", uplink_stages, command_line );
+        pipeline_app.start_downlink( "Downlink", downlink_stages, command_line );
+        return pipeline_app.wait_for_exit();
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+}
@@ -67,6 +67,18 @@ int main( int argc, char *argv[] )
         /* bring up egress */
         assign_address( egress_name, egress_addr, ingress_addr );
 
+        /* event backend for the event loops (see mahimahi(1)) */
+        Poller::Backend backend = Poller::Backend::Poll;
+        {
+            TemporarilyUnprivileged tu;
+            TemporaryEnvironment te { user_environment };
+
+            const char * const backend_name = getenv( "MAHIMAHI_EVENT_BACKEND" );
+            if ( backend_name ) {
+                backend = Poller::backend_from_name( backend_name );
+            }
+        }
+
         /* create DNS proxy */
         DNSProxy dns_outside( egress_addr, nameserver, nameserver );
 
@@ -80,7 +92,7 @@ int main( int argc, char *argv[] )
         DNAT dnat( http_proxy.tcp_listener().local_address(), egress_name );
 
         /* prepare event loop */
-        EventLoop outer_event_loop;
+        EventLoop outer_event_loop( backend );
 
         /* Fork */
         {
@@ -117,7 +129,7 @@ int main( int argc, char *argv[] )
                     drop_privileges();
 
                     /* prepare child's event loop */
-                    EventLoop shell_event_loop;
+                    EventLoop shell_event_loop( backend );
 
                     shell_event_loop.add_child_process( join( command ), [&]() {
                             /* restore environment and tweak prompt */
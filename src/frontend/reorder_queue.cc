@@ -0,0 +1,58 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <stdexcept>
+
+#include "reorder_queue.hh"
+#include "timestamp.hh"
+
+using namespace std;
+
+ReorderQueue::ReorderQueue( const uint64_t & s_delay_ms, const double reorder_probability, const unsigned int gap,
+                            const double duplicate_probability, const uint64_t seed )
+    : delay_us_( s_delay_ms * 1000 ),
+      reorder_probability_( reorder_probability ),
+      gap_( gap ),
+      duplicate_probability_( duplicate_probability ),
+      prng_( seed ),
+      held_since_reorder_( 0 ),
+      packets_(),
+      last_timestamp_( 0 )
+{
+    if ( not ( 0 <= reorder_probability and reorder_probability <= 1 )
+         or not ( 0 <= duplicate_probability and duplicate_probability <= 1 ) ) {
+        throw runtime_error( "reorder and duplicate probabilities must be between 0 and 1" );
+    }
+
+    if ( gap == 0 ) {
+        throw runtime_error( "reorder gap must be at least 1" );
+    }
+}
+
+uint64_t ReorderQueue::release_time( const uint64_t now )
+{
+    if ( reorder_probability_ > 0 and held_since_reorder_ + 1 >= gap_
+         and prng_.uniform() < reorder_probability_ ) {
+        held_since_reorder_ = 0;
+        return now;
+    }
+
+    held_since_reorder_++;
+    return now + delay_us_;
+}
+
+void ReorderQueue::read_packet( const PacketBuffer & contents )
+{
+    last_timestamp_ = timestamp_us();
+
+    if ( duplicate_probability_ > 0 and prng_.uniform() < duplicate_probability_ ) {
+        packets_.insert( release_time( last_timestamp_ ), PacketBuffer( contents ) );
+    }
+
+    packets_.insert( release_time( last_timestamp_ ), PacketBuffer( contents ) );
+}
+
+void ReorderQueue::write_packets( PacketSink & sink )
+{
+    last_timestamp_ = timestamp_us();
+    packets_.advance( last_timestamp_, [&] ( PacketBuffer && packet ) { sink.send( packet ); } );
+}
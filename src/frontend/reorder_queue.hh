@@ -0,0 +1,59 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef REORDER_QUEUE_HH
+#define REORDER_QUEUE_HH
+
+#include <cstdint>
+#include <string>
+
+#include "packet_sink.hh"
+#include "timing_wheel.hh"
+#include "prng.hh"
+
+class ControlSocket;
+
+/* Reordering and duplication, as netem does them. Packets are held
+   for a delay, but once at least gap - 1 packets have been held since
+   the last one let through, each packet is let through at once (ahead
+   of those still held) with the reorder probability. With the
+   duplicate probability a packet is sent twice; the copy shares the
+   original's buffer and is held or let through on its own. Without a
+   delay, nothing can be reordered. */
+class ReorderQueue
+{
+private:
+    uint64_t delay_us_;
+    double reorder_probability_;
+    unsigned int gap_;
+    double duplicate_probability_;
+
+    Prng prng_;
+    unsigned int held_since_reorder_;
+
+    TimingWheel<PacketBuffer> packets_; /* by release timestamp (us) */
+    uint64_t last_timestamp_; /* the clock as last read */
+
+    uint64_t release_time( const uint64_t now );
+
+public:
+    /* a seed of 0 picks one at random */
+    ReorderQueue( const uint64_t & s_delay_ms, const double reorder_probability, const unsigned int gap,
+                  const double duplicate_probability, const uint64_t seed );
+
+    void read_packet( const PacketBuffer & contents );
+
+    /* everything due, with one reading of the clock */
+    void write_packets( PacketSink & sink );
+
+    uint64_t next_event_time( void ) const { return packets_.next_time(); }
+
+    bool pending_output( void ) const { return next_event_time() <= last_timestamp_; }
+
+    static bool finished( void ) { return false; }
+
+    /* takes no commands (see LinkQueue) */
+    static ControlSocket * control_socket( void ) { return nullptr; }
+    static std::string control( const std::string & ) { return ""; }
+};
+
+#endif /* REORDER_QUEUE_HH */
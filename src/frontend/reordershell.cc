@@ -0,0 +1,113 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <vector>
+#include <string>
+#include <getopt.h>
+
+#include "reorder_queue.hh"
+#include "util.hh"
+#include "ezio.hh"
+#include "packetshell.cc"
+
+using namespace std;
+
+void usage_error( const string & program_name )
+{
+    throw runtime_error( "Usage: " + program_name + " [--reorder=PROBABILITY] [--gap=N] [--duplicate=PROBABILITY]"
+                         " [--seed=N] delay-milliseconds [command...]" );
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        /* clear environment while running as root */
+        char ** const user_environment = environ;
+        environ = nullptr;
+
+        check_requirements( argc, argv );
+
+        const option command_line_options[] = {
+            { "reorder",   required_argument, nullptr, 'r' },
+            { "gap",       required_argument, nullptr, 'g' },
+            { "duplicate", required_argument, nullptr, 'd' },
+            { "seed",      required_argument, nullptr, 's' },
+            { 0,                           0, nullptr, 0 }
+        };
+
+        string reorder = "0", gap = "1", duplicate = "0";
+        uint64_t seed = 0;
+
+        while ( true ) {
+            const int opt = getopt_long( argc, argv, "+", command_line_options, nullptr );
+            if ( opt == -1 ) { /* end of options */
+                break;
+            }
+
+            switch ( opt ) {
+            case 'r':
+                reorder = optarg;
+                break;
+            case 'g':
+                gap = optarg;
+                break;
+            case 'd':
+                duplicate = optarg;
+                break;
+            case 's':
+                seed = myatoi( optarg );
+                break;
+            case '?':
+                usage_error( argv[ 0 ] );
+                break;
+            default:
+                throw runtime_error( "getopt_long: unexpected return value " + to_string( opt ) );
+            }
+        }
+
+        if ( optind >= argc ) {
+            usage_error( argv[ 0 ] );
+        }
+
+        const uint64_t delay_ms = myatoi( argv[ optind ] );
+        const double reorder_probability = myatof( reorder ), duplicate_probability = myatof( duplicate );
+        const long int reorder_gap = myatoi( gap );
+        if ( reorder_gap < 1 ) {
+            throw runtime_error( "reorder gap must be at least 1" );
+        }
+
+        /* check the rest now, not in the ferries */
+        ReorderQueue( delay_ms, reorder_probability, reorder_gap, duplicate_probability, 0 );
+
+        vector< string > command;
+
+        if ( optind + 1 == argc ) {
+            command.push_back( shell_path() );
+        } else {
+            for ( int i = optind + 1; i < argc; i++ ) {
+                command.push_back( argv[ i ] );
+            }
+        }
+
+        string shell_prefix = "[reorder " + to_string( delay_ms ) + " ms";
+        if ( reorder_probability > 0 ) {
+            shell_prefix += " reorder=" + reorder + " gap=" + gap;
+        }
+        if ( duplicate_probability > 0 ) {
+            shell_prefix += " duplicate=" + duplicate;
+        }
+        shell_prefix += "] ";
+
+        PacketShell<ReorderQueue> reorder_shell_app( "reorder", user_environment );
+
+        /* each direction gets its own draws from the same seed */
+        reorder_shell_app.start_uplink( shell_prefix,
+                                        command,
+                                        delay_ms, reorder_probability, reorder_gap, duplicate_probability, seed );
+        reorder_shell_app.start_downlink( delay_ms, reorder_probability, reorder_gap, duplicate_probability,
+                                          seed ? seed + 1 : 0 );
+        return reorder_shell_app.wait_for_exit();
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+}
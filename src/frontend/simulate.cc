@@ -0,0 +1,319 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* run a LinkQueue and packet queue on a virtual clock, faster than real time */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <getopt.h>
+
+#include "link_queue.hh"
+#include "link_schedule.hh"
+#include "packet_queue_factory.hh"
+#include "timestamp.hh"
+#include "prng.hh"
+#include "exception.hh"
+#include "ezio.hh"
+
+using namespace std;
+
+void usage_error( const string & program_name )
+{
+    cerr << "Usage: " << program_name << " [OPTION]... TRACE [ARRIVALS]" << endl;
+    cerr << endl;
+    cerr << "Options = --log=FILENAME [--binary-log]" << endl;
+    cerr << "          --queue=QUEUE_TYPE --queue-args=QUEUE_ARGS" << endl;
+    cerr << "          --once" << endl;
+    cerr << "          --cbr (TRACE is a rate, e.g. \"12M\")" << endl;
+    cerr << "          --traffic=poisson:RATE | --traffic=constant:RATE (instead of ARRIVALS)" << endl;
+    cerr << "          --packet-size=BYTES (default 1500) --seed=N (default 0: random)" << endl;
+    cerr << "          --duration=MS (stop then; required with --traffic)" << endl;
+    cerr << endl;
+    cerr << "          QUEUE_TYPE = " << packet_queue_types() << endl;
+    cerr << "          ARRIVALS has a line \"TIME-MS SIZE [SRC-PORT:DST-PORT]\" per packet" << endl;
+
+    throw runtime_error( "invalid arguments" );
+}
+
+struct Arrival
+{
+    uint64_t time; /* us */
+    unsigned int size;
+    uint16_t src_port, dst_port;
+};
+
+class ArrivalSource
+{
+public:
+    virtual ~ArrivalSource() {}
+
+    /* false when there are no more arrivals */
+    virtual bool next( Arrival & arrival ) = 0;
+};
+
+/* packets listed in a file, in order of arrival */
+class ArrivalFile : public ArrivalSource
+{
+private:
+    string filename_;
+    ifstream file_;
+    uint64_t last_time_;
+
+public:
+    ArrivalFile( const string & filename )
+        : filename_( filename ), file_( filename ), last_time_( 0 )
+    {
+        if ( not file_.good() ) {
+            throw runtime_error( filename + ": error opening for reading" );
+        }
+    }
+
+    bool next( Arrival & arrival ) override
+    {
+        string line;
+        while ( getline( file_, line ) ) {
+            istringstream fields( line.substr( 0, line.find( '#' ) ) );
+            string time, size, flow;
+            if ( not ( fields >> time ) ) {
+                continue; /* blank or comment */
+            }
+
+            if ( not ( fields >> size ) ) {
+                throw runtime_error( filename_ + ": expected \"TIME-MS SIZE [SRC-PORT:DST-PORT]\", got \"" + line + "\"" );
+            }
+
+            arrival.time = parse_trace_timestamp( time );
+            arrival.size = myatoi( size );
+            arrival.src_port = arrival.dst_port = 0;
+
+            if ( fields >> flow ) {
+                const auto colon = flow.find( ':' );
+                if ( colon == string::npos ) {
+                    throw runtime_error( filename_ + ": invalid flow \"" + flow + "\"" );
+                }
+                arrival.src_port = myatoi( flow.substr( 0, colon ) );
+                arrival.dst_port = myatoi( flow.substr( colon + 1 ) );
+            }
+
+            if ( arrival.time < last_time_ ) {
+                throw runtime_error( filename_ + ": arrival times must be nondecreasing" );
+            }
+            last_time_ = arrival.time;
+
+            return true;
+        }
+
+        return false;
+    }
+};
+
+/* evenly spaced or Poisson arrivals of fixed-size packets at an average rate */
+class SyntheticArrivals : public ArrivalSource
+{
+private:
+    bool poisson_;
+    double mean_gap_us_;
+    unsigned int packet_size_;
+    Prng prng_;
+    double next_time_;
+
+    double gap( void ) { return poisson_ ? mean_gap_us_ * prng_.exponential() : mean_gap_us_; }
+
+public:
+    /* a seed of 0 picks one at random */
+    SyntheticArrivals( const string & description, const unsigned int packet_size, const uint64_t seed )
+        : poisson_(), mean_gap_us_(), packet_size_( packet_size ), prng_( seed ), next_time_( 0 )
+    {
+        const auto colon = description.find( ':' );
+        const string kind = description.substr( 0, colon );
+        if ( colon == string::npos or ( kind != "poisson" and kind != "constant" ) ) {
+            throw runtime_error( "traffic must be poisson:RATE or constant:RATE" );
+        }
+
+        const uint64_t rate = parse_rate( description.substr( colon + 1 ) );
+        if ( rate == 0 ) {
+            throw runtime_error( "traffic rate must be positive" );
+        }
+
+        poisson_ = kind == "poisson";
+        mean_gap_us_ = packet_size_ * 8 * 1000000.0 / rate;
+        next_time_ = poisson_ ? gap() : 0;
+    }
+
+    bool next( Arrival & arrival ) override
+    {
+        arrival.time = next_time_;
+        arrival.size = packet_size_;
+        arrival.src_port = arrival.dst_port = 0;
+
+        next_time_ += gap();
+
+        return true;
+    }
+};
+
+/* what the link delivers */
+class CountingSink : public PacketSink
+{
+public:
+    uint64_t packets = 0, bytes = 0;
+
+    void send( const PacketBuffer & packet ) override
+    {
+        packets++;
+        bytes += packet.size();
+    }
+};
+
+/* a UDP-over-IPv4 TUN frame of the given size, so the classifier finds its ports */
+static PacketBuffer make_packet( const Arrival & arrival )
+{
+    string contents( arrival.size, 0 );
+    if ( contents.size() >= 28 ) {
+        contents[ 2 ] = 0x08; /* ETH_P_IP */
+        contents[ 4 ] = 0x45; /* version 4, 20-byte header */
+        contents[ 13 ] = 17; /* UDP */
+        contents[ 24 ] = arrival.src_port >> 8;
+        contents[ 25 ] = arrival.src_port & 0xff;
+        contents[ 26 ] = arrival.dst_port >> 8;
+        contents[ 27 ] = arrival.dst_port & 0xff;
+    }
+
+    return PacketBuffer( contents );
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        if ( argc < 1 ) {
+            throw runtime_error( "missing argv[ 0 ]" );
+        }
+
+        string command_line = argv[ 0 ]; /* for the log file */
+        for ( int i = 1; i < argc; i++ ) {
+            command_line += string( " " ) + argv[ i ];
+        }
+
+        const option command_line_options[] = {
+            { "log",          required_argument, nullptr, 'l' },
+            { "binary-log",         no_argument, nullptr, 'b' },
+            { "queue",        required_argument, nullptr, 'q' },
+            { "queue-args",   required_argument, nullptr, 'a' },
+            { "once",               no_argument, nullptr, 'o' },
+            { "cbr",                no_argument, nullptr, 'c' },
+            { "traffic",      required_argument, nullptr, 't' },
+            { "packet-size",  required_argument, nullptr, 'p' },
+            { "seed",         required_argument, nullptr, 's' },
+            { "duration",     required_argument, nullptr, 'd' },
+            { 0,                              0, nullptr, 0 }
+        };
+
+        string logfile, queue_type = "infinite", queue_args, traffic;
+        bool binary_log = false, repeat = true, constant_bitrate = false;
+        unsigned int packet_size = 1500;
+        uint64_t seed = 0, duration = -1;
+
+        while ( true ) {
+            const int opt = getopt_long( argc, argv, "", command_line_options, nullptr );
+            if ( opt == -1 ) { /* end of options */
+                break;
+            }
+
+            switch ( opt ) {
+            case 'l': logfile = optarg; break;
+            case 'b': binary_log = true; break;
+            case 'q': queue_type = optarg; break;
+            case 'a': queue_args = optarg; break;
+            case 'o': repeat = false; break;
+            case 'c': constant_bitrate = true; break;
+            case 't': traffic = optarg; break;
+            case 'p': packet_size = myatoi( optarg ); break;
+            case 's': seed = myatoi( optarg ); break;
+            case 'd': duration = parse_trace_timestamp( optarg ); break;
+            default: usage_error( argv[ 0 ] );
+            }
+        }
+
+        if ( optind + ( traffic.empty() ? 2 : 1 ) != argc
+             or ( not traffic.empty() and duration == uint64_t( -1 ) ) ) {
+            usage_error( argv[ 0 ] );
+        }
+
+        if ( packet_size == 0 or packet_size > LinkSchedule::OPPORTUNITY_BYTES ) {
+            throw runtime_error( "packet size must be between 1 and " + to_string( LinkSchedule::OPPORTUNITY_BYTES ) );
+        }
+
+        unique_ptr<AbstractPacketQueue> packet_queue = make_packet_queue( queue_type, queue_args );
+        if ( not packet_queue ) {
+            cerr << "Unknown queue type: " << queue_type << endl;
+            usage_error( argv[ 0 ] );
+        }
+
+        unique_ptr<ArrivalSource> arrivals;
+        if ( traffic.empty() ) {
+            arrivals.reset( new ArrivalFile( argv[ optind + 1 ] ) );
+        } else {
+            arrivals.reset( new SyntheticArrivals( traffic, packet_size, seed ) );
+        }
+
+        /* the simulation starts at time 0 */
+        set_virtual_clock( 0 );
+
+        LinkQueue link( "Simulated", argv[ optind ], logfile, repeat, false, false,
+                        move( packet_queue ), command_line, constant_bitrate, binary_log );
+
+        CountingSink delivered;
+        uint64_t arrived = 0;
+
+        Arrival next_arrival;
+        bool more_arrivals = arrivals->next( next_arrival ) and next_arrival.time <= duration;
+
+        const auto start = chrono::steady_clock::now();
+
+        /* jump from event to event: arrivals, and departures while the link is busy */
+        while ( not link.finished() ) {
+            uint64_t now = more_arrivals ? next_arrival.time : -1;
+            if ( not link.idle() ) {
+                now = min( now, link.next_event_time() );
+            }
+
+            if ( now == uint64_t( -1 ) or now > duration ) {
+                break;
+            }
+
+            set_virtual_clock( now * 1000 );
+
+            while ( more_arrivals and next_arrival.time <= now ) {
+                link.read_packet( make_packet( next_arrival ) );
+                arrived++;
+                more_arrivals = arrivals->next( next_arrival ) and next_arrival.time <= duration;
+            }
+
+            link.write_packets( delivered );
+        }
+
+        /* account for the link's capacity up to the end */
+        if ( duration != uint64_t( -1 ) and not link.finished() ) {
+            set_virtual_clock( duration * 1000 );
+            link.write_packets( delivered );
+        }
+
+        const double elapsed = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+        const double simulated = timestamp_us() / 1000000.0;
+
+        cerr << "Arrived: " << arrived << " packets" << endl;
+        cerr << "Delivered: " << delivered.packets << " packets (" << delivered.bytes << " bytes)" << endl;
+        cerr << "Not delivered: " << arrived - delivered.packets << " packets" << endl;
+        cerr << "Simulated " << simulated << " s in " << elapsed << " s";
+        if ( elapsed > 0 ) {
+            cerr << " (" << simulated / elapsed << "x real time)";
+        }
+        cerr << endl;
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
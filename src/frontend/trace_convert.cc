@@ -0,0 +1,68 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/* convert mm-link traces between the text and binary formats */
+
+#include <iostream>
+#include <fstream>
+
+#include "link_schedule.hh"
+#include "exception.hh"
+
+using namespace std;
+
+void usage_error( const string & program_name )
+{
+    cerr << "Usage: " << program_name << " [--to-text] INPUT-TRACE OUTPUT-TRACE" << endl;
+    cerr << endl;
+    cerr << "Writes INPUT-TRACE (text or binary) as a binary trace that mm-link maps" << endl;
+    cerr << "into memory, or as a text trace with --to-text (\"-\" for standard output)." << endl;
+
+    throw runtime_error( "invalid arguments" );
+}
+
+int main( int argc, char *argv[] )
+{
+    try {
+        if ( argc < 1 ) {
+            throw runtime_error( "missing argv[ 0 ]" );
+        }
+
+        bool to_text = false;
+        int first_argument = 1;
+        if ( argc > 1 and string( argv[ 1 ] ) == "--to-text" ) {
+            to_text = true;
+            first_argument = 2;
+        }
+
+        if ( argc != first_argument + 2 ) {
+            usage_error( argv[ 0 ] );
+        }
+
+        const string input = argv[ first_argument ], output = argv[ first_argument + 1 ];
+
+        const TraceSchedule schedule( input );
+
+        if ( not to_text ) {
+            schedule.write_binary( output );
+        } else if ( output == "-" ) {
+            schedule.write_text( cout );
+        } else {
+            ofstream out( output );
+            if ( not out.good() ) {
+                throw runtime_error( output + ": error opening for writing" );
+            }
+            schedule.write_text( out );
+            if ( not out.good() ) {
+                throw runtime_error( output + ": error writing" );
+            }
+        }
+
+        cerr << input << ": " << schedule.size() << " delivery opportunities over "
+             << schedule.duration() / 1000.0 << " ms" << endl;
+    } catch ( const exception & e ) {
+        print_exception( e );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -14,6 +14,11 @@ public:
 
     virtual QueuedPacket dequeue( void ) = 0;
 
+    /* take the next packet out as it is, without the drops, marks or
+       pacing of dequeue(), to move it to a replacement queue (queues
+       whose dequeue() only takes a packet need not override this) */
+    virtual QueuedPacket pop( void ) { return dequeue(); }
+
     virtual bool empty( void ) const = 0;
 
 		virtual unsigned int size_bytes( void ) const = 0;
@@ -24,6 +29,11 @@ public:
     virtual std::string to_string( void ) const = 0;
 
     virtual void set_bdp( int bytes ) { (void)bytes; }
+
+    /* congestion signals so far: packets dropped (other than by
+       the link itself), and ECN-capable packets marked CE instead */
+    virtual uint64_t drops( void ) const { return 0; }
+    virtual uint64_t marks( void ) const { return 0; }
 };
 
 #endif /* ABSTRACT_PACKET_QUEUE */ 
@@ -5,10 +5,9 @@
 
 using namespace std;
 
-CODELPacketQueue::CODELPacketQueue( const string & args )
-  : DroppingPacketQueue(args),
-    target_ ( get_arg( args, "target") ),
-    interval_ ( get_arg( args, "interval") ),
+CoDelControl::CoDelControl( const uint32_t target, const uint32_t interval )
+  : target_ ( target ),
+    interval_ ( interval ),
     first_above_time_ ( 0 ),
     drop_next_( 0 ),
     count_ ( 0 ),
@@ -20,85 +19,63 @@ CODELPacketQueue::CODELPacketQueue( const string & args )
   }
 }
 
-//NOTE: CoDel makes drop decisions at dequeueing. 
-//However, this function cannot return NULL. Therefore we ignore
-//the drop decision if the current packet is the only one in the queue.
-//We know that if this function is called, there is at least one packet in the queue.
-dodequeue_result CODELPacketQueue::dodequeue ( uint64_t now )
+//NOTE: CoDel makes drop decisions at dequeueing.
+//However, dequeue cannot return NULL. Therefore we ignore
+//the drop decision if the current packet is the only one in the queue,
+//and drop the packets behind it instead.
+bool CoDelControl::ok_to_drop ( const uint64_t now, const QueuedPacket & p, const unsigned int backlog )
 {
-  uint64_t sojourn_time;
-
-  dodequeue_result r;
-  r.p = std::move( DroppingPacketQueue::dequeue () );
-  r.ok_to_drop = false;
-
-  if ( empty() ) {
+  const uint64_t sojourn_time = now - p.arrival_time;
+  if ( sojourn_time < target_ || backlog <= PACKET_SIZE ) {
     first_above_time_ = 0;
-    return r;
+    return false;
   }
 
-  sojourn_time = now - r.p.arrival_time;
-  if ( sojourn_time < target_ || size_bytes() <= PACKET_SIZE ) {
-    first_above_time_ = 0;
-  }
-  else {
-    if ( first_above_time_ == 0 ) {
-      first_above_time_ = now + interval_;
-    }
-    else if (now >= first_above_time_) {
-      r.ok_to_drop = true;
-    }
+  if ( first_above_time_ == 0 ) {
+    first_above_time_ = now + interval_;
+    return false;
   }
 
-  return r;
+  return now >= first_above_time_;
 }
 
-uint64_t CODELPacketQueue::control_law ( uint64_t t, uint32_t count ) 
+uint64_t CoDelControl::control_law ( uint64_t t, uint32_t count )
 {
   double d = interval_ / sqrt (count);
   return t + (uint64_t) d;
 }
 
+CODELPacketQueue::CODELPacketQueue( const string & args )
+  : DroppingPacketQueue(args),
+    codel_ ( get_arg( args, "target") * 1000, get_arg( args, "interval") * 1000 )
+{
+}
+
 QueuedPacket CODELPacketQueue::dequeue( void )
-{   
-  const uint64_t now = timestamp();
-  dodequeue_result r = std::move( dodequeue ( now ) );
-  uint32_t delta;
-    
-  if ( dropping_ ) {
-    if ( !r.ok_to_drop ) {
-      dropping_ = false;
-    }
+{
+  const uint64_t now = timestamp_us();
+  QueuedPacket ret = DroppingPacketQueue::dequeue();
 
-    while ( now >= drop_next_ && dropping_ ) {
-      dodequeue_result r = std::move( dodequeue ( now ) );
-      count_++;
-      if ( ! r.ok_to_drop ) {
-	dropping_ = false;
-      } else {
-	drop_next_ = control_law(drop_next_, count_);
-      }
-    }
-  }
-  else if ( r.ok_to_drop ) {
-    dodequeue_result r = std::move( dodequeue ( now ) );
-    dropping_ = true;
-    delta = count_ - lastcount_;
-    count_ = ( ( delta > 1 ) && ( now - drop_next_ < 16 * interval_ ))? 
-      delta : 1;
-    drop_next_ = control_law ( now, count_ );
-    lastcount_ = count_;
-  }
+  codel_.dequeued( now, codel_.ok_to_drop( now, ret, size_bytes() ),
+                   [&] () { return mark( ret ); },
+                   [&] () {
+                     QueuedPacket dropped = DroppingPacketQueue::dequeue();
+                     const bool ok = codel_.ok_to_drop( now, dropped, size_bytes() );
+                     drop( std::move( dropped ) );
+                     return ok;
+                   } );
 
-  return r.p;
+  return ret;
 }
 
 
 void CODELPacketQueue::enqueue( QueuedPacket && p )
 {
-  if ( good_with( size_bytes() + p.contents.size(),
+  if ( good_with( size_bytes() + p.metadata.size,
 		  size_packets() + 1 ) ) {
     accept( std::move( p ) );
+  } else {
+    drop( std::move( p ) );
   }
   assert( good() );
 }
@@ -6,15 +6,6 @@
 #include <random>
 #include "dropping_packet_queue.hh"
 
-struct dodequeue_result {
-    QueuedPacket p;
-    bool ok_to_drop;
-
-    dodequeue_result ( )
-        : p ( "", 0 ), ok_to_drop ( false )
-    {}
-};
-
 /*
    Controlled Delay (CoDel) AQM Implementation
    based on IETF draft-ietf-aqm-codel-04
@@ -22,11 +13,14 @@ struct dodequeue_result {
    Contributed by
       Joseph D. Beshay <joseph.beshay@utdallas.edu>
 */
-class CODELPacketQueue : public DroppingPacketQueue
+
+/* CoDel's state and control law for one queue, kept apart from the
+   queue so that fq_codel can run one per flow */
+class CoDelControl
 {
 private:
     const static unsigned int PACKET_SIZE = 1504;
-    //Configuration parameters
+    //Configuration parameters (kept in us)
     uint32_t target_, interval_;
 
     //State variables
@@ -34,6 +28,67 @@ private:
     uint32_t count_, lastcount_;
     bool dropping_;
 
+    uint64_t control_law ( uint64_t t, uint32_t count );
+
+public:
+    CoDelControl( const uint32_t target, const uint32_t interval );
+
+    /* having just taken p from the queue, leaving backlog bytes
+       behind: has the delay stayed above target for an interval? */
+    bool ok_to_drop ( const uint64_t now, const QueuedPacket & p, const unsigned int backlog );
+
+    /* Finish a dequeue, given the verdict on the packet taken. mark()
+       may signal congestion on that packet by ECN instead of a drop,
+       returning false if it can't. drop_next() takes and discards the
+       next packet in the queue (only called when there is one),
+       returning the verdict on it. */
+    template <class Mark, class DropNext>
+    void dequeued ( const uint64_t now, const bool ok, Mark && mark, DropNext && drop_next );
+
+    uint32_t target( void ) const { return target_; }
+    uint32_t interval( void ) const { return interval_; }
+};
+
+template <class Mark, class DropNext>
+void CoDelControl::dequeued ( const uint64_t now, const bool ok, Mark && mark, DropNext && drop_next )
+{
+  if ( dropping_ ) {
+    if ( !ok ) {
+      dropping_ = false;
+    }
+
+    while ( now >= drop_next_ && dropping_ ) {
+      count_++;
+      if ( mark() ) {
+        drop_next_ = control_law(drop_next_, count_);
+        break;
+      }
+
+      const bool next_ok = drop_next();
+      if ( ! next_ok ) {
+        dropping_ = false;
+      } else {
+        drop_next_ = control_law(drop_next_, count_);
+      }
+    }
+  }
+  else if ( ok ) {
+    if ( ! mark() ) {
+      drop_next();
+    }
+    dropping_ = true;
+    const uint32_t delta = count_ - lastcount_;
+    count_ = ( ( delta > 1 ) && ( now - drop_next_ < 16 * interval_ ))?
+      delta : 1;
+    drop_next_ = control_law ( now, count_ );
+    lastcount_ = count_;
+  }
+}
+
+class CODELPacketQueue : public DroppingPacketQueue
+{
+private:
+    CoDelControl codel_;
 
     virtual const std::string & type( void ) const override
     {
@@ -41,9 +96,6 @@ private:
         return type_;
     }
 
-    dodequeue_result dodequeue ( uint64_t now );
-    uint64_t control_law ( uint64_t t, uint32_t count );
-
 public:
     CODELPacketQueue( const std::string & args );
 
@@ -52,4 +104,4 @@ public:
     QueuedPacket dequeue( void ) override;
 };
 
-#endif /* PIE_PACKET_QUEUE_HH */ 
+#endif /* CODEL_PACKET_QUEUE_HH */ 
@@ -24,7 +24,7 @@ public:
 
         /* do we need to drop from the head? */
         while ( not good() ) {
-            dequeue();
+            drop( dequeue() );
         }
     }
 };
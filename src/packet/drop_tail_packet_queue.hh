@@ -19,9 +19,11 @@ public:
 
     void enqueue( QueuedPacket && p ) override
     {
-        if ( good_with( size_bytes() + p.contents.size(),
+        if ( good_with( size_bytes() + p.metadata.size,
                         size_packets() + 1 ) ) {
             accept( std::move( p ) );
+        } else {
+            drop( std::move( p ) );
         }
 
         assert( good() );
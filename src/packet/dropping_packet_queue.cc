@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include "dropping_packet_queue.hh"
+#include "ecn.hh"
 #include "exception.hh"
 #include "ezio.hh"
 
@@ -12,7 +13,8 @@ DroppingPacketQueue::DroppingPacketQueue( const string & args )
     : bdp_byte_limit_( ),
       packet_limit_( get_arg( args, "packets" ) ),
       byte_limit_( get_arg( args, "bytes" ) ),
-      bdp_limit_( get_arg( args, "bdp" ) )
+      bdp_limit_( get_arg( args, "bdp" ) ),
+      ecn_( get_arg( args, "ecn" ) )
 {
     if ( packet_limit_ == 0 and byte_limit_ == 0 and bdp_limit_ == 0) {
         throw runtime_error( "Dropping queue must have a byte, packet, or BDP limit." );
@@ -26,7 +28,7 @@ QueuedPacket DroppingPacketQueue::dequeue( void )
     QueuedPacket ret = std::move( internal_queue_.front() );
     internal_queue_.pop();
 
-    queue_size_in_bytes_ -= ret.contents.size();
+    queue_size_in_bytes_ -= ret.metadata.size;
     queue_size_in_packets_--;
 
     assert( good() );
@@ -84,11 +86,27 @@ unsigned int DroppingPacketQueue::size_packets( void ) const
 /* put a packet on the back of the queue */
 void DroppingPacketQueue::accept( QueuedPacket && p )
 {
-    queue_size_in_bytes_ += p.contents.size();
+    queue_size_in_bytes_ += p.metadata.size;
     queue_size_in_packets_++;
     internal_queue_.emplace( std::move( p ) );
 }
 
+void DroppingPacketQueue::drop( QueuedPacket && p )
+{
+    const QueuedPacket dropped = std::move( p ); /* release its buffer now */
+    drops_++;
+}
+
+bool DroppingPacketQueue::mark( QueuedPacket & p )
+{
+    if ( ecn_ and set_congestion_experienced( p ) ) {
+        marks_++;
+        return true;
+    }
+
+    return false;
+}
+
 string DroppingPacketQueue::to_string( void ) const
 {
     string ret = type() + " [";
@@ -105,6 +123,14 @@ string DroppingPacketQueue::to_string( void ) const
         ret += string( "packets=" ) + ::to_string( packet_limit_ );
     }
 
+    if ( ecn_ ) {
+        if ( byte_limit_ or packet_limit_ ) {
+            ret += ", ";
+        }
+
+        ret += "ecn";
+    }
+
     ret += "]";
 
     return ret;
@@ -142,4 +168,9 @@ unsigned int DroppingPacketQueue::get_arg( const string & args, const string & n
     }
 }
 
-
+unsigned int DroppingPacketQueue::get_arg( const string & args, const string & name,
+                                           const unsigned int fallback )
+{
+    const unsigned int value = get_arg( args, name );
+    return value ? value : fallback;
+}
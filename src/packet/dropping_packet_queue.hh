@@ -15,18 +15,28 @@ private:
     int queue_size_in_bytes_ = 0, queue_size_in_packets_ = 0;
     unsigned int bdp_byte_limit_;
 
+    uint64_t drops_ = 0, marks_ = 0;
+
     virtual const std::string & type( void ) const = 0;
 
 protected:
     const unsigned int packet_limit_;
     const unsigned int byte_limit_;
     const unsigned int bdp_limit_;
+    const bool ecn_; /* ecn=1: the AQMs mark ECN-capable packets rather than drop them */
 
     std::queue<QueuedPacket> internal_queue_ {};
 
     /* put a packet on the back of the queue */
     void accept( QueuedPacket && p );
 
+    /* discard a packet, counting it */
+    void drop( QueuedPacket && p );
+
+    /* with ecn=1, mark an ECN-capable packet CE in place of dropping it;
+       false if the packet must be dropped after all */
+    bool mark( QueuedPacket & p );
+
     /* are the limits currently met? */
     bool good( void ) const;
     bool good_with( const unsigned int size_in_bytes,
@@ -39,6 +49,9 @@ public:
 
     QueuedPacket dequeue( void ) override;
 
+    /* the head of the queue, whatever an AQM's dequeue() would decide */
+    QueuedPacket pop( void ) override { return DroppingPacketQueue::dequeue(); }
+
     bool empty( void ) const override;
 
     unsigned int size_bytes( void ) const override;
@@ -46,9 +59,14 @@ public:
 
     void set_bdp( int bytes ) override;
 
+    uint64_t drops( void ) const override { return drops_; }
+    uint64_t marks( void ) const override { return marks_; }
+
     std::string to_string( void ) const override;
 
     static unsigned int get_arg( const std::string & args, const std::string & name );
+    static unsigned int get_arg( const std::string & args, const std::string & name,
+                                 const unsigned int fallback ); /* when absent or 0 */
 
 };
 
@@ -0,0 +1,125 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include "drr_packet_queue.hh"
+#include "dropping_packet_queue.hh"
+
+using namespace std;
+
+DRRPacketQueue::DRRPacketQueue( const string & args )
+    : DRRPacketQueue( args, DroppingPacketQueue::get_arg( args, "sparse" ) )
+{}
+
+DRRPacketQueue::DRRPacketQueue( const string & args, const bool sparse )
+    : packet_limit_( DroppingPacketQueue::get_arg( args, "packets" ) ),
+      byte_limit_( DroppingPacketQueue::get_arg( args, "bytes" ) ),
+      bdp_limit_( DroppingPacketQueue::get_arg( args, "bdp" ) ),
+      bdp_byte_limit_( 0 ),
+      quantum_( DroppingPacketQueue::get_arg( args, "quantum", PACKET_SIZE ) ),
+      sparse_( sparse ),
+      new_flows_(),
+      old_flows_(),
+      flows_( DroppingPacketQueue::get_arg( args, "flows", 1024 ) ),
+      drops_( 0 )
+{
+    if ( packet_limit_ == 0 and byte_limit_ == 0 and bdp_limit_ == 0 ) {
+        throw runtime_error( "DRR queue must have a byte, packet, or BDP limit." );
+    }
+}
+
+bool DRRPacketQueue::good( void ) const
+{
+    return ( not packet_limit_ or flows_.packets() <= packet_limit_ )
+        and ( not byte_limit_ or flows_.bytes() <= byte_limit_ )
+        and ( not bdp_byte_limit_ or flows_.bytes() <= bdp_byte_limit_ );
+}
+
+void DRRPacketQueue::enqueue( QueuedPacket && p )
+{
+    const uint32_t index = flows_.flow_of( p );
+    flows_.push( index, move( p ) );
+
+    FlowTable::Flow & flow = flows_.flow( index );
+    if ( not flow.listed ) {
+        flow.deficit = quantum_;
+        ( sparse_ ? new_flows_ : old_flows_ ).push_back( flows_, index );
+    }
+
+    while ( not good() ) {
+        drop_from_fattest();
+    }
+}
+
+/* drop from the head, as the packet that has waited longest
+   is the one whose loss the sender will notice soonest */
+void DRRPacketQueue::drop_from_fattest( void )
+{
+    flows_.pop( flows_.fattest() );
+    drops_++;
+    /* an emptied flow stays listed, and leaves the lists when its turn comes */
+}
+
+uint32_t DRRPacketQueue::next_flow( void )
+{
+    assert( not empty() );
+
+    while ( true ) {
+        FlowList & list = new_flows_.empty() ? old_flows_ : new_flows_;
+        const uint32_t index = list.front();
+        FlowTable::Flow & flow = flows_.flow( index );
+
+        if ( flow.deficit <= 0 ) {
+            /* out of credit for this round: to the back of the line */
+            flow.deficit += quantum_;
+            list.pop_front( flows_ );
+            old_flows_.push_back( flows_, index );
+            continue;
+        }
+
+        if ( flow.packets == 0 ) {
+            list.pop_front( flows_ );
+            if ( &list == &new_flows_ and not old_flows_.empty() ) {
+                /* a sparse flow gets its priority once per backlog, not once per packet */
+                old_flows_.push_back( flows_, index );
+            }
+            continue;
+        }
+
+        return index;
+    }
+}
+
+QueuedPacket DRRPacketQueue::dequeue( void )
+{
+    const uint32_t index = next_flow();
+    QueuedPacket ret = take( index );
+    flows_.flow( index ).deficit -= ret.metadata.size;
+    return ret;
+}
+
+QueuedPacket DRRPacketQueue::pop( void )
+{
+    const uint32_t index = next_flow();
+    QueuedPacket ret = flows_.pop( index );
+    flows_.flow( index ).deficit -= ret.metadata.size;
+    return ret;
+}
+
+string DRRPacketQueue::parameters( void ) const
+{
+    string ret;
+
+    if ( byte_limit_ ) {
+        ret += "bytes=" + ::to_string( byte_limit_ ) + ", ";
+    }
+
+    if ( packet_limit_ ) {
+        ret += "packets=" + ::to_string( packet_limit_ ) + ", ";
+    }
+
+    return ret + "flows=" + ::to_string( flows_.flow_count() ) + ", quantum=" + ::to_string( quantum_ );
+}
+
+string DRRPacketQueue::to_string( void ) const
+{
+    return string( sparse_ ? "drr++" : "drr" ) + " [" + parameters() + "]";
+}
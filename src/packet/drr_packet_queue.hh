@@ -0,0 +1,75 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef DRR_PACKET_QUEUE_HH
+#define DRR_PACKET_QUEUE_HH
+
+#include "abstract_packet_queue.hh"
+#include "flow_table.hh"
+
+/* Deficit round robin (Shreedhar and Varghese) over a FlowTable. Only
+   flows with packets are on the round-robin lists, and the totals are
+   kept as packets come and go, so enqueue and dequeue are O(1) in the
+   number of flows. On overflow the queue drops from the flow with the
+   most packets, which the FlowTable keeps track of, so that is O(1)
+   too (Linux's fq_codel_drop() scans for the flow with the most bytes
+   instead, and drops a batch to spread the cost).
+
+   Arguments: packets=, bytes= and/or bdp= (limits over all flows, as
+   for droptail), flows= (buckets, default 1024), quantum= (bytes per
+   round, default one MTU-sized packet), and sparse=1 for DRR++, which
+   serves a newly active flow ahead of the flows already backlogged. */
+class DRRPacketQueue : public AbstractPacketQueue
+{
+private:
+    const static unsigned int PACKET_SIZE = 1504; /* default max TUN payload size */
+
+    const unsigned int packet_limit_, byte_limit_, bdp_limit_;
+    unsigned int bdp_byte_limit_;
+
+    const int32_t quantum_;
+    const bool sparse_;
+
+    FlowList new_flows_, old_flows_;
+
+    bool good( void ) const;
+
+    void drop_from_fattest( void );
+
+    /* the flow whose turn it is, moving the others along the lists */
+    uint32_t next_flow( void );
+
+protected:
+    FlowTable flows_;
+    uint64_t drops_;
+
+    DRRPacketQueue( const std::string & args, const bool sparse );
+
+    /* take the next packet to send from a flow that has one */
+    virtual QueuedPacket take( const uint32_t flow ) { return flows_.pop( flow ); }
+
+    /* the limits, flows and quantum, for to_string() */
+    std::string parameters( void ) const;
+
+public:
+    DRRPacketQueue( const std::string & args );
+
+    void enqueue( QueuedPacket && p ) override;
+
+    QueuedPacket dequeue( void ) override;
+
+    /* in the same order, but without take() */
+    QueuedPacket pop( void ) override;
+
+    bool empty( void ) const override { return flows_.packets() == 0; }
+
+    unsigned int size_bytes( void ) const override { return flows_.bytes(); }
+    unsigned int size_packets( void ) const override { return flows_.packets(); }
+
+    void set_bdp( int bytes ) override { bdp_byte_limit_ = bytes * bdp_limit_; }
+
+    uint64_t drops( void ) const override { return drops_; }
+
+    std::string to_string( void ) const override;
+};
+
+#endif /* DRR_PACKET_QUEUE_HH */
@@ -0,0 +1,166 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <cassert>
+
+#include "dualpi2_packet_queue.hh"
+#include "dropping_packet_queue.hh"
+#include "ecn.hh"
+#include "timestamp.hh"
+
+using namespace std;
+
+DualPI2PacketQueue::DualPI2PacketQueue( const string & args )
+    : packet_limit_( DroppingPacketQueue::get_arg( args, "packets" ) ),
+      byte_limit_( DroppingPacketQueue::get_arg( args, "bytes" ) ),
+      bdp_limit_( DroppingPacketQueue::get_arg( args, "bdp" ) ),
+      bdp_byte_limit_( 0 ),
+      target_( DroppingPacketQueue::get_arg( args, "target_us", 15000 ) ),
+      step_( DroppingPacketQueue::get_arg( args, "step_us", 1000 ) ),
+      t_update_( DroppingPacketQueue::get_arg( args, "tupdate_us", 16000 ) ),
+      tshift_( DroppingPacketQueue::get_arg( args, "tshift_us", 50000 ) ),
+      coupling_( DroppingPacketQueue::get_arg( args, "coupling", 2 ) ),
+      alpha_( 0.16 * t_update_ / 1000000 ), /* RFC 9332's ALPHA and BETA (Hz), per update */
+      beta_( 3.2 * t_update_ / 1000000 ),
+      l_bytes_( 0 ),
+      c_bytes_( 0 ),
+      base_prob_( 0 ),
+      qdelay_old_( 0 ),
+      last_update_( timestamp_us() ),
+      drops_( 0 ),
+      marks_( 0 ),
+      uniform_generator_( 0.0, 1.0 ),
+      prng_( random_device()() )
+{
+    if ( packet_limit_ == 0 and byte_limit_ == 0 and bdp_limit_ == 0 ) {
+        throw runtime_error( "DualPI2 queue must have a byte, packet, or BDP limit." );
+    }
+}
+
+bool DualPI2PacketQueue::good_with( const unsigned int size_in_bytes,
+                                    const unsigned int size_in_packets ) const
+{
+    return ( not packet_limit_ or size_in_packets <= packet_limit_ )
+        and ( not byte_limit_ or size_in_bytes <= byte_limit_ )
+        and ( not bdp_byte_limit_ or size_in_bytes <= bdp_byte_limit_ );
+}
+
+bool DualPI2PacketQueue::random_below( const double probability )
+{
+    return uniform_generator_( prng_ ) < probability;
+}
+
+/* As for PIE, there is no timer in the ferry, so catch up on the
+   periodic updates missed since the last packet. The queues haven't
+   changed in between, so each update sees the delay of the packets
+   at their heads at that moment, as a timer would have. */
+void DualPI2PacketQueue::update_prob( void )
+{
+    const uint64_t now = timestamp_us();
+
+    while ( now >= last_update_ + t_update_ ) {
+        last_update_ += t_update_;
+
+        uint64_t qdelay = 0;
+        for ( const auto * queue : { &l_queue_, &c_queue_ } ) {
+            if ( not queue->empty() and queue->front().arrival_time < last_update_ ) {
+                qdelay = max( qdelay, last_update_ - queue->front().arrival_time );
+            }
+        }
+
+        base_prob_ += alpha_ * ( double( qdelay ) - target_ ) / 1000000
+            + beta_ * ( double( qdelay ) - qdelay_old_ ) / 1000000;
+        base_prob_ = min( max( base_prob_, 0.0 ), 1.0 );
+
+        qdelay_old_ = qdelay;
+    }
+}
+
+void DualPI2PacketQueue::enqueue( QueuedPacket && p )
+{
+    update_prob();
+
+    if ( not good_with( size_bytes() + p.metadata.size, size_packets() + 1 ) ) {
+        drops_++;
+        return;
+    }
+
+    /* L4S traffic: its congestion signal comes as it leaves */
+    if ( p.metadata.ecn == ECT_1 or p.metadata.ecn == CE ) {
+        l_bytes_ += p.metadata.size;
+        l_queue_.emplace( move( p ) );
+        return;
+    }
+
+    /* classic traffic: p'^2, the square making up for its 1/sqrt(p) response */
+    if ( random_below( base_prob_ * base_prob_ ) ) {
+        if ( not set_congestion_experienced( p ) ) {
+            drops_++;
+            return;
+        }
+        marks_++;
+    }
+
+    c_bytes_ += p.metadata.size;
+    c_queue_.emplace( move( p ) );
+}
+
+QueuedPacket DualPI2PacketQueue::take( queue<QueuedPacket> & queue, unsigned int & bytes )
+{
+    QueuedPacket ret = move( queue.front() );
+    queue.pop();
+    bytes -= ret.metadata.size;
+    return ret;
+}
+
+bool DualPI2PacketQueue::l_first( void ) const
+{
+    return not l_queue_.empty()
+        and ( c_queue_.empty() or c_queue_.front().arrival_time + tshift_ >= l_queue_.front().arrival_time );
+}
+
+QueuedPacket DualPI2PacketQueue::dequeue( void )
+{
+    assert( not empty() );
+
+    update_prob();
+    const uint64_t now = timestamp_us();
+
+    if ( not l_first() ) {
+        return take( c_queue_, c_bytes_ );
+    }
+
+    const bool step = now - l_queue_.front().arrival_time > step_ and l_bytes_ > PACKET_SIZE;
+    QueuedPacket ret = take( l_queue_, l_bytes_ );
+
+    if ( step or random_below( coupling_ * base_prob_ ) ) {
+        if ( set_congestion_experienced( ret ) ) {
+            marks_++;
+        }
+    }
+
+    return ret;
+}
+
+QueuedPacket DualPI2PacketQueue::pop( void )
+{
+    assert( not empty() );
+
+    return l_first() ? take( l_queue_, l_bytes_ ) : take( c_queue_, c_bytes_ );
+}
+
+string DualPI2PacketQueue::to_string( void ) const
+{
+    string ret = "dualpi2 [";
+
+    if ( byte_limit_ ) {
+        ret += "bytes=" + ::to_string( byte_limit_ ) + ", ";
+    }
+
+    if ( packet_limit_ ) {
+        ret += "packets=" + ::to_string( packet_limit_ ) + ", ";
+    }
+
+    return ret + "target_us=" + ::to_string( target_ ) + ", step_us=" + ::to_string( step_ )
+        + ", tupdate_us=" + ::to_string( t_update_ ) + ", tshift_us=" + ::to_string( tshift_ )
+        + ", coupling=" + ::to_string( coupling_ ) + "]";
+}
@@ -0,0 +1,90 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef DUALPI2_PACKET_QUEUE_HH
+#define DUALPI2_PACKET_QUEUE_HH
+
+#include <queue>
+#include <random>
+
+#include "abstract_packet_queue.hh"
+
+/*
+   DualQ Coupled AQM (RFC 9332) with the PI2 controller, for L4S.
+   Packets marked ECT(1) or CE go to the low-latency L queue, and all
+   others to the classic C queue. One PI controller, updated every
+   tupdate as PIE's is, sets a base probability p' from the queueing
+   delay:
+     - a C packet is marked (ECT(0)) or dropped with probability p'^2
+       as it arrives;
+     - an L packet is marked with probability coupling * p' as it
+       leaves, or always if it waited more than the step threshold.
+   The scheduler is a time-shifted FIFO: an L packet goes first unless
+   the C packet at the head has waited tshift longer.
+
+   Arguments: packets=, bytes= and/or bdp= (limits over both queues),
+   and, in microseconds so sub-millisecond delays can be set,
+   target_us= (default 15000), step_us= (1000), tupdate_us= (16000)
+   and tshift_us= (50000); coupling= (default 2).
+*/
+class DualPI2PacketQueue : public AbstractPacketQueue
+{
+private:
+    const static unsigned int PACKET_SIZE = 1504; /* default max TUN payload size */
+
+    const unsigned int packet_limit_, byte_limit_, bdp_limit_;
+    unsigned int bdp_byte_limit_;
+
+    //Configurable parameters (us)
+    const uint32_t target_, step_, t_update_, tshift_;
+    const unsigned int coupling_;
+
+    //PI gains, per second of queueing delay per second
+    const double alpha_, beta_;
+
+    std::queue<QueuedPacket> l_queue_ {}, c_queue_ {};
+    unsigned int l_bytes_, c_bytes_;
+
+    //Status variables
+    double base_prob_; /* p' */
+    uint64_t qdelay_old_; /* us */
+    uint64_t last_update_;
+
+    uint64_t drops_, marks_;
+
+    std::uniform_real_distribution<double> uniform_generator_;
+    std::default_random_engine prng_;
+
+    bool good_with( const unsigned int size_in_bytes, const unsigned int size_in_packets ) const;
+
+    void update_prob( void );
+    bool random_below( const double probability );
+
+    QueuedPacket take( std::queue<QueuedPacket> & queue, unsigned int & bytes );
+
+    /* is it the L queue's turn, by the time-shifted FIFO? */
+    bool l_first( void ) const;
+
+public:
+    DualPI2PacketQueue( const std::string & args );
+
+    void enqueue( QueuedPacket && p ) override;
+
+    QueuedPacket dequeue( void ) override;
+
+    /* in the same order, but without marking */
+    QueuedPacket pop( void ) override;
+
+    bool empty( void ) const override { return l_queue_.empty() and c_queue_.empty(); }
+
+    unsigned int size_bytes( void ) const override { return l_bytes_ + c_bytes_; }
+    unsigned int size_packets( void ) const override { return l_queue_.size() + c_queue_.size(); }
+
+    void set_bdp( int bytes ) override { bdp_byte_limit_ = bytes * bdp_limit_; }
+
+    uint64_t drops( void ) const override { return drops_; }
+    uint64_t marks( void ) const override { return marks_; }
+
+    std::string to_string( void ) const override;
+};
+
+#endif /* DUALPI2_PACKET_QUEUE_HH */
@@ -19,7 +19,7 @@ ECMPPacketQueue::ECMPPacketQueue( const string & args )
       work_conserving_ ((bool) get_arg(args, "nonworkconserving") == 0),
       mean_jitter_     ((size_t) get_arg(args, "mean_jitter")),
       prng_( random_device()() ),
-      poisson_gen_( get_arg(args, "mean_jitter") )
+      poisson_gen_( max( 1u, get_arg(args, "mean_jitter") ) ) /* the mean must be positive */
 {
     if (num_queues_ == 0) {
         throw runtime_error( "ECMP queue must have > 0 queues" );
@@ -35,59 +35,12 @@ ECMPPacketQueue::ECMPPacketQueue( const string & args )
     default_random_engine generator;
 }
 
-inline uint32_t simple_hash(const char *str, size_t len) {
-    uint32_t hash = 5381;
-    size_t i=0;
-    int c;
-    while (i < len) {
-        c = *str++;
-        hash = ((hash << 5) + hash) + c;
-        i++;
-    }
-    return hash; 
-}
-
-typedef uint64_t Fnv64_t;
-/*
- * 64 bit magic FNV-0 and FNV-1 prime
- */
-#define FNV1_64_INIT ((Fnv64_t)0xcbf29ce484222325ULL)
-#define FNV_64_PRIME ((Fnv64_t)0x100000001b3ULL)
-
-Fnv64_t
-fnv_64_buf(const void *buf, size_t len, Fnv64_t hval)
-{
-    size_t i;
-    uint64_t v;
-    uint8_t *b = (uint8_t*) buf;
-    for (i = 0; i < len; i++) {
-        v = (uint64_t) b[i];
-        hval = hval ^ v;
-        hval *= FNV_64_PRIME;
-    }
-
-    return hval;
-}
-
-#define FIVE_TUPLE_START 24
-#define FIVE_TUPLE_LEN 4
-
-inline size_t hash_flow(const char *pkt) {
-    //return simple_hash(pkt, FIVE_TUPLE_LEN);
-    return fnv_64_buf(pkt, FIVE_TUPLE_LEN, FNV1_64_INIT);
-}
-
 void ECMPPacketQueue::enqueue(QueuedPacket &&p ) {
 
-    size_t hash;
-    if(p.contents.size() < 28) { 
-        hash = 1;
-    } else {
-        hash = hash_flow(p.contents.substr(FIVE_TUPLE_START, FIVE_TUPLE_LEN).c_str());
-    }
-    size_t qid = hash % num_queues_;
+    /* the classifier hashed the 5-tuple on arrival */
+    size_t qid = p.metadata.flow_hash % num_queues_;
 
-    qlen_bytes_ += p.contents.size();
+    qlen_bytes_ += p.metadata.size;
     qlen_pkts_++;
 
     //cerr << "enqueue hash=" << hash << " q=" << qid << " qlen=" << qlen_pkts_ << endl;
@@ -97,16 +50,17 @@ void ECMPPacketQueue::enqueue(QueuedPacket &&p ) {
 
 QueuedPacket ECMPPacketQueue::dequeue( void )
 {
-    QueuedPacket ret = QueuedPacket("", 0);
-    const uint64_t now = timestamp();
+    QueuedPacket ret = QueuedPacket(PacketBuffer(), 0);
+    const uint64_t now = timestamp_us();
 
     size_t i = 0;
     while (i < num_queues_) {
         DropTailPacketQueue *q = internal_queues_[(curr_queue_ + i) % num_queues_];
         if (!q->empty()) {
-            if (mean_jitter_ > 0 && (now - q->peek().arrival_time) >= poisson_gen_(prng_)) {
+            /* mean_jitter=0 (the default) releases packets without delay */
+            if (mean_jitter_ == 0 || (now - q->peek().arrival_time) >= 1000 * poisson_gen_(prng_)) {
                 ret = q->dequeue(); 
-                qlen_bytes_ -= ret.contents.size();
+                qlen_bytes_ -= ret.metadata.size;
                 qlen_pkts_--;
                 i++;
                 break;
@@ -123,6 +77,20 @@ QueuedPacket ECMPPacketQueue::dequeue( void )
     return ret;
 }
 
+QueuedPacket ECMPPacketQueue::pop( void )
+{
+    assert( not empty() );
+
+    while (internal_queues_[curr_queue_]->empty()) {
+        curr_queue_ = (curr_queue_ + 1) % num_queues_;
+    }
+
+    QueuedPacket ret = internal_queues_[curr_queue_]->dequeue();
+    qlen_bytes_ -= ret.metadata.size;
+    qlen_pkts_--;
+    return ret;
+}
+
 void ECMPPacketQueue::set_bdp( int bytes )
 {
     for (size_t i=0; i < num_queues_; i++) {
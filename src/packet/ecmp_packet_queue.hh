@@ -41,6 +41,9 @@ public:
 
     QueuedPacket dequeue( void ) override;
 
+    /* the next packet of any path, without waiting out jitter */
+    QueuedPacket pop( void ) override;
+
     bool empty( void ) const override;
 
     unsigned int size_bytes( void ) const override;
@@ -0,0 +1,55 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include "ecn.hh"
+
+using namespace std;
+
+/* RFC 1624 eqn. 3: HC' = ~(~HC + ~m + m') */
+static uint16_t update_checksum( const uint16_t checksum, const uint16_t old_word, const uint16_t new_word )
+{
+    uint32_t sum = uint16_t( ~checksum ) + uint16_t( ~old_word ) + new_word;
+    sum = ( sum & 0xffff ) + ( sum >> 16 );
+    sum = ( sum & 0xffff ) + ( sum >> 16 );
+    return ~sum;
+}
+
+bool set_congestion_experienced( QueuedPacket & p )
+{
+    if ( p.metadata.ecn == NOT_ECT ) {
+        return false;
+    }
+
+    if ( p.metadata.ecn == CE ) {
+        return true; /* already marked by an earlier hop */
+    }
+
+    /* the slab may be shared with other packets (as in mm-sim) */
+    p.contents.unshare();
+    uint8_t * const ip = reinterpret_cast<uint8_t *>( p.contents.mutable_data() ) + p.metadata.ip_offset;
+
+    switch ( p.metadata.key.ip_version ) {
+    case 4:
+    {
+        /* the TOS byte shares a checksummed 16-bit word with version and IHL */
+        const uint16_t old_word = ( ip[ 0 ] << 8 ) | ip[ 1 ];
+        ip[ 1 ] |= CE;
+        const uint16_t new_word = ( ip[ 0 ] << 8 ) | ip[ 1 ];
+
+        const uint16_t checksum = update_checksum( ( ip[ 10 ] << 8 ) | ip[ 11 ], old_word, new_word );
+        ip[ 10 ] = checksum >> 8;
+        ip[ 11 ] = checksum & 0xff;
+        break;
+    }
+
+    case 6:
+        /* the traffic class straddles the first two bytes; ECN is in the second, and no checksum covers it */
+        ip[ 1 ] |= CE << 4;
+        break;
+
+    default:
+        return false;
+    }
+
+    p.metadata.ecn = CE;
+    return true;
+}
@@ -0,0 +1,17 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef ECN_HH
+#define ECN_HH
+
+#include "queued_packet.hh"
+
+/* ECN codepoints (RFC 3168), as in PacketMetadata::ecn */
+enum ECNCodepoint : uint8_t { NOT_ECT = 0, ECT_1 = 1, ECT_0 = 2, CE = 3 };
+
+/* Signal congestion to an ECN-capable packet in place of dropping it:
+   set CE in its IPv4 or IPv6 header, updating the IPv4 header checksum
+   incrementally (RFC 1624). Returns false, leaving the packet alone,
+   if it isn't ECN-capable. */
+bool set_congestion_experienced( QueuedPacket & p );
+
+#endif /* ECN_HH */
@@ -22,13 +22,9 @@ FairPacketQueue::FairPacketQueue(const std::string& args_)
     curr_queue_ = 0;
 }
 
-inline void hash_flow( size_t *qid, const uint32_t *p, size_t num_buckets ) {
-    (*qid) = (*p) % num_buckets;
-}
-
 void FairPacketQueue::enqueue(QueuedPacket&& p) {
-    size_t qid;
-    hash_flow(&qid, (uint32_t *) p.contents.substr(24,4).c_str(), num_queues_);
+    /* the classifier hashed the 5-tuple on arrival */
+    size_t qid = p.metadata.flow_hash % num_queues_;
 
     internal_queues_[qid]->enqueue((QueuedPacket &&) p);
 }
@@ -0,0 +1,89 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <sstream>
+#include <iomanip>
+#include <cassert>
+#include <algorithm>
+
+#include "ferry_stats.hh"
+
+using namespace std;
+
+BatchStatistics::BatchStatistics( const unsigned int max_batch_size )
+    : wakeups_by_batch_size_( max_batch_size + 1 ),
+      wakeups_( 0 ),
+      packets_( 0 )
+{}
+
+void BatchStatistics::record( const unsigned int batch_size )
+{
+    assert( batch_size < wakeups_by_batch_size_.size() );
+
+    wakeups_by_batch_size_[ batch_size ]++;
+    wakeups_++;
+    packets_ += batch_size;
+}
+
+string BatchStatistics::summary( void ) const
+{
+    ostringstream out;
+
+    out << packets_ << " packets in " << wakeups_ << " wakeups";
+    if ( wakeups_ ) {
+        out << " (mean " << fixed << setprecision( 2 )
+            << double( packets_ ) / wakeups_ << " packets/wakeup)";
+    }
+    out << endl;
+
+    for ( unsigned int i = 0; i < wakeups_by_batch_size_.size(); i++ ) {
+        if ( wakeups_by_batch_size_[ i ] ) {
+            out << "  " << setw( 4 ) << i << " packets: "
+                << wakeups_by_batch_size_[ i ] << " wakeups" << endl;
+        }
+    }
+
+    return out.str();
+}
+
+LatenessStatistics::LatenessStatistics()
+    : events_by_bucket_( 64 ),
+      events_( 0 ),
+      total_ns_( 0 ),
+      max_ns_( 0 )
+{}
+
+void LatenessStatistics::record( const uint64_t lateness_ns )
+{
+    /* bucket 0 is under 1 us, bucket i is [2^(i-1), 2^i) us */
+    unsigned int bucket = 0;
+    for ( uint64_t us = lateness_ns / 1000; us; us >>= 1 ) {
+        bucket++;
+    }
+
+    events_by_bucket_.at( bucket )++;
+    events_++;
+    total_ns_ += lateness_ns;
+    max_ns_ = max( max_ns_, lateness_ns );
+}
+
+string LatenessStatistics::summary( void ) const
+{
+    ostringstream out;
+
+    out << events_ << " timer wakeups";
+    if ( events_ ) {
+        out << " (mean lateness " << fixed << setprecision( 1 )
+            << total_ns_ / 1000.0 / events_ << " us, max "
+            << max_ns_ / 1000.0 << " us)";
+    }
+    out << endl;
+
+    for ( unsigned int i = 0; i < events_by_bucket_.size(); i++ ) {
+        if ( events_by_bucket_[ i ] ) {
+            out << "  " << setw( 8 ) << ( i ? "< " + to_string( uint64_t( 1 ) << i ) : string( "< 1" ) )
+                << " us late: " << events_by_bucket_[ i ] << endl;
+        }
+    }
+
+    return out.str();
+}
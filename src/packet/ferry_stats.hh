@@ -0,0 +1,46 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef FERRY_STATS_HH
+#define FERRY_STATS_HH
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/* how many packets the ferry handled on each wakeup of its event loop */
+class BatchStatistics
+{
+private:
+    std::vector<uint64_t> wakeups_by_batch_size_;
+    uint64_t wakeups_, packets_;
+
+public:
+    BatchStatistics( const unsigned int max_batch_size );
+
+    void record( const unsigned int batch_size );
+
+    uint64_t wakeups( void ) const { return wakeups_; }
+    uint64_t packets( void ) const { return packets_; }
+
+    std::string summary( void ) const;
+};
+
+/* how late the ferry woke for each scheduled queue event, in
+   power-of-two buckets of microseconds */
+class LatenessStatistics
+{
+private:
+    std::vector<uint64_t> events_by_bucket_;
+    uint64_t events_, total_ns_, max_ns_;
+
+public:
+    LatenessStatistics();
+
+    void record( const uint64_t lateness_ns );
+
+    uint64_t events( void ) const { return events_; }
+
+    std::string summary( void ) const;
+};
+
+#endif /* FERRY_STATS_HH */
@@ -0,0 +1,160 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <stdexcept>
+#include <algorithm>
+
+#include "flow_table.hh"
+
+using namespace std;
+
+const uint32_t FlowTable::NONE;
+
+FlowTable::FlowTable( const uint32_t flow_count )
+    : flows_( flow_count ),
+      pool_(),
+      next_packet_(),
+      free_( NONE ),
+      packets_( 0 ),
+      bytes_( 0 ),
+      by_packets_( 1, NONE ),
+      most_packets_( 0 )
+{
+    if ( flow_count == 0 ) {
+        throw runtime_error( "FlowTable: need at least one flow" );
+    }
+}
+
+/* put a flow on the list for its packet count */
+void FlowTable::link_by_packets( const uint32_t index )
+{
+    Flow & flow = flows_[ index ];
+    if ( flow.packets == 0 ) {
+        return;
+    }
+
+    if ( flow.packets >= by_packets_.size() ) {
+        by_packets_.push_back( NONE );
+    }
+
+    uint32_t & first = by_packets_[ flow.packets ];
+    flow.thinner = NONE;
+    flow.fatter = first;
+    if ( first != NONE ) {
+        flows_[ first ].thinner = index;
+    }
+    first = index;
+
+    most_packets_ = max( most_packets_, flow.packets );
+}
+
+/* take a flow off the list for its packet count */
+void FlowTable::unlink_by_packets( const uint32_t index )
+{
+    Flow & flow = flows_[ index ];
+    if ( flow.packets == 0 ) {
+        return;
+    }
+
+    if ( flow.thinner == NONE ) {
+        by_packets_[ flow.packets ] = flow.fatter;
+    } else {
+        flows_[ flow.thinner ].fatter = flow.fatter;
+    }
+    if ( flow.fatter != NONE ) {
+        flows_[ flow.fatter ].thinner = flow.thinner;
+    }
+    flow.fatter = flow.thinner = NONE;
+
+    /* counts change by one, so the most is now the same or one less */
+    if ( flow.packets == most_packets_ and by_packets_[ most_packets_ ] == NONE ) {
+        most_packets_--;
+    }
+}
+
+void FlowTable::push( const uint32_t index, QueuedPacket && p )
+{
+    uint32_t slot = free_;
+    if ( slot == NONE ) {
+        slot = pool_.size();
+        pool_.emplace_back( move( p ) );
+        next_packet_.push_back( NONE );
+    } else {
+        free_ = next_packet_[ slot ];
+        pool_[ slot ] = move( p );
+        next_packet_[ slot ] = NONE;
+    }
+
+    Flow & flow = flows_[ index ];
+    if ( flow.tail == NONE ) {
+        flow.head = slot;
+    } else {
+        next_packet_[ flow.tail ] = slot;
+    }
+    flow.tail = slot;
+
+    const uint32_t size = pool_[ slot ].metadata.size;
+    unlink_by_packets( index );
+    flow.packets++;
+    link_by_packets( index );
+    flow.bytes += size;
+    packets_++;
+    bytes_ += size;
+}
+
+QueuedPacket FlowTable::pop( const uint32_t index )
+{
+    Flow & flow = flows_[ index ];
+    assert( flow.packets );
+
+    const uint32_t slot = flow.head;
+    QueuedPacket ret = move( pool_[ slot ] );
+
+    flow.head = next_packet_[ slot ];
+    if ( flow.head == NONE ) {
+        flow.tail = NONE;
+    }
+
+    next_packet_[ slot ] = free_;
+    free_ = slot;
+
+    unlink_by_packets( index );
+    flow.packets--;
+    link_by_packets( index );
+    flow.bytes -= ret.metadata.size;
+    packets_--;
+    bytes_ -= ret.metadata.size;
+
+    return ret;
+}
+
+void FlowList::push_back( FlowTable & table, const uint32_t index )
+{
+    FlowTable::Flow & flow = table.flow( index );
+    assert( not flow.listed );
+
+    flow.next = FlowTable::NONE;
+    flow.listed = true;
+
+    if ( empty() ) {
+        head_ = index;
+    } else {
+        table.flow( tail_ ).next = index;
+    }
+    tail_ = index;
+}
+
+uint32_t FlowList::pop_front( FlowTable & table )
+{
+    const uint32_t index = front();
+    FlowTable::Flow & flow = table.flow( index );
+
+    head_ = flow.next;
+    if ( head_ == FlowTable::NONE ) {
+        tail_ = FlowTable::NONE;
+    }
+
+    flow.next = FlowTable::NONE;
+    flow.listed = false;
+
+    return index;
+}
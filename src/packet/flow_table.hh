@@ -0,0 +1,106 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef FLOW_TABLE_HH
+#define FLOW_TABLE_HH
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+#include "queued_packet.hh"
+
+/* A fixed number of per-flow FIFOs for the fair queues. A packet's
+   flow is a bucket chosen by its flow hash (flows that collide share
+   a bucket). Packets of all flows live in one pool, linked through
+   it, so enqueue and dequeue are O(1) and allocate nothing once the
+   pool has grown to the largest backlog. Flows link into FlowLists
+   through the table too.
+
+   Each flow with packets is also on the list for its packet count.
+   A push or pop moves the flow to the neighbouring list, so the
+   fattest flow (the most packets queued) is always known in O(1). */
+
+class FlowTable
+{
+public:
+    static const uint32_t NONE = -1;
+
+    struct Flow
+    {
+        uint32_t head = NONE, tail = NONE; /* packets, in the pool */
+        uint32_t packets = 0, bytes = 0;
+        int32_t deficit = 0; /* bytes it may still send this round */
+        uint32_t next = NONE; /* in its FlowList */
+        bool listed = false; /* on a FlowList? */
+        uint32_t fatter = NONE, thinner = NONE; /* neighbours with the same packet count */
+    };
+
+private:
+    std::vector<Flow> flows_;
+
+    std::vector<QueuedPacket> pool_;
+    std::vector<uint32_t> next_packet_; /* in a flow, or in the free list */
+    uint32_t free_;
+
+    uint32_t packets_, bytes_;
+
+    std::vector<uint32_t> by_packets_; /* the first flow with each packet count */
+    uint32_t most_packets_;
+
+    void link_by_packets( const uint32_t index );
+    void unlink_by_packets( const uint32_t index );
+
+public:
+    FlowTable( const uint32_t flow_count );
+
+    uint32_t flow_count( void ) const { return flows_.size(); }
+
+    /* the bucket for a packet, by multiplying rather than dividing the hash */
+    uint32_t flow_of( const QueuedPacket & p ) const
+    {
+        return ( uint64_t( p.metadata.flow_hash ) * flows_.size() ) >> 32;
+    }
+
+    Flow & flow( const uint32_t index ) { return flows_[ index ]; }
+    const Flow & flow( const uint32_t index ) const { return flows_[ index ]; }
+
+    /* add a packet to the back of a flow, or take one from its front */
+    void push( const uint32_t index, QueuedPacket && p );
+    QueuedPacket pop( const uint32_t index );
+
+    const QueuedPacket & front( const uint32_t index ) const
+    {
+        assert( flows_[ index ].packets );
+        return pool_[ flows_[ index ].head ];
+    }
+
+    /* a flow with the most packets queued (there must be some) */
+    uint32_t fattest( void ) const
+    {
+        assert( packets_ );
+        return by_packets_[ most_packets_ ];
+    }
+
+    /* totals over every flow */
+    uint32_t packets( void ) const { return packets_; }
+    uint32_t bytes( void ) const { return bytes_; }
+};
+
+/* a singly-linked list of flows in a FlowTable, such as the flows
+   waiting their turn in a round robin */
+class FlowList
+{
+private:
+    uint32_t head_, tail_;
+
+public:
+    FlowList() : head_( FlowTable::NONE ), tail_( FlowTable::NONE ) {}
+
+    bool empty( void ) const { return head_ == FlowTable::NONE; }
+    uint32_t front( void ) const { assert( not empty() ); return head_; }
+
+    void push_back( FlowTable & table, const uint32_t index );
+    uint32_t pop_front( FlowTable & table );
+};
+
+#endif /* FLOW_TABLE_HH */
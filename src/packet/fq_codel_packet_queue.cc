@@ -0,0 +1,49 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include "fq_codel_packet_queue.hh"
+#include "ecn.hh"
+#include "timestamp.hh"
+
+using namespace std;
+
+FQCoDelPacketQueue::FQCoDelPacketQueue( const string & args )
+    : DRRPacketQueue( args, true ),
+      codel_( flows_.flow_count(),
+              CoDelControl( DroppingPacketQueue::get_arg( args, "target", 5 ) * 1000,
+                            DroppingPacketQueue::get_arg( args, "interval", 100 ) * 1000 ) ),
+      ecn_( DroppingPacketQueue::get_arg( args, "ecn" ) ),
+      marks_( 0 )
+{}
+
+QueuedPacket FQCoDelPacketQueue::take( const uint32_t flow )
+{
+    const uint64_t now = timestamp_us();
+    CoDelControl & codel = codel_[ flow ];
+
+    QueuedPacket ret = flows_.pop( flow );
+
+    /* CoDel sees only this flow's backlog */
+    codel.dequeued( now, codel.ok_to_drop( now, ret, flows_.flow( flow ).bytes ),
+                    [&] () {
+                        if ( ecn_ and set_congestion_experienced( ret ) ) {
+                            marks_++;
+                            return true;
+                        }
+                        return false;
+                    },
+                    [&] () {
+                        const QueuedPacket dropped = flows_.pop( flow );
+                        drops_++;
+                        return codel.ok_to_drop( now, dropped, flows_.flow( flow ).bytes );
+                    } );
+
+    return ret;
+}
+
+string FQCoDelPacketQueue::to_string( void ) const
+{
+    return "fq_codel [" + parameters()
+        + ", target=" + ::to_string( codel_.front().target() / 1000 )
+        + ", interval=" + ::to_string( codel_.front().interval() / 1000 )
+        + ( ecn_ ? ", ecn]" : "]" );
+}
@@ -0,0 +1,35 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef FQ_CODEL_PACKET_QUEUE_HH
+#define FQ_CODEL_PACKET_QUEUE_HH
+
+#include <vector>
+
+#include "drr_packet_queue.hh"
+#include "codel_packet_queue.hh"
+
+/* FQ-CoDel (RFC 8290): DRR++ over the flows, as for "drr" with
+   sparse=1, with each flow's delay kept in check by its own CoDel.
+
+   Arguments: as for drr, plus target= and interval= in ms for CoDel
+   (default 5 and 100), and ecn=1 to mark ECN-capable packets rather
+   than drop them. */
+class FQCoDelPacketQueue : public DRRPacketQueue
+{
+private:
+    std::vector<CoDelControl> codel_; /* by flow */
+
+    const bool ecn_;
+    uint64_t marks_;
+
+    QueuedPacket take( const uint32_t flow ) override;
+
+public:
+    FQCoDelPacketQueue( const std::string & args );
+
+    uint64_t marks( void ) const override { return marks_; }
+
+    std::string to_string( void ) const override;
+};
+
+#endif /* FQ_CODEL_PACKET_QUEUE_HH */
@@ -0,0 +1,134 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <netinet/in.h>
+
+#include "packet_metadata.hh"
+
+using namespace std;
+
+static_assert( sizeof( FlowKey ) == 40, "FlowKey must have no implicit padding" );
+
+static const unsigned int TUN_HEADER_LENGTH = 4; /* flags and protocol, ahead of the IP header */
+
+uint32_t FlowKey::hash( void ) const
+{
+    uint64_t words[ sizeof( *this ) / sizeof( uint64_t ) ];
+    memcpy( words, this, sizeof( words ) );
+
+    uint64_t hash = 0x9e3779b97f4a7c15;
+    for ( const uint64_t word : words ) {
+        hash = ( hash ^ word ) * 0xff51afd7ed558ccd;
+        hash ^= hash >> 32;
+    }
+
+    return uint32_t( hash );
+}
+
+static uint16_t read_u16( const uint8_t * data )
+{
+    return ( data[ 0 ] << 8 ) | data[ 1 ];
+}
+
+/* are the first four bytes of the transport header the two ports? */
+static bool has_ports( const uint8_t protocol )
+{
+    return protocol == IPPROTO_TCP or protocol == IPPROTO_UDP or protocol == IPPROTO_UDPLITE
+        or protocol == IPPROTO_SCTP or protocol == IPPROTO_DCCP;
+}
+
+PacketMetadata::PacketMetadata( const PacketBuffer & contents )
+    : key(), flow_hash( 0 ), size( contents.size() ), ip_offset( TUN_HEADER_LENGTH ), dscp( 0 ), ecn( 0 )
+{
+    const uint8_t * const packet = reinterpret_cast<const uint8_t *>( contents.data() );
+    const size_t length = contents.size();
+
+    if ( length < ip_offset + 1u ) {
+        return;
+    }
+
+    const uint8_t * const ip = packet + ip_offset;
+    size_t transport_offset = 0; /* 0: no ports to read */
+
+    switch ( ip[ 0 ] >> 4 ) {
+    case 4:
+    {
+        const size_t header_length = ( ip[ 0 ] & 0x0f ) * 4; /* with any options */
+        if ( length < ip_offset + 20u or header_length < 20 ) {
+            return;
+        }
+
+        key.ip_version = 4;
+        dscp = ip[ 1 ] >> 2;
+        ecn = ip[ 1 ] & 0x03;
+        key.protocol = ip[ 9 ];
+        memcpy( key.src, ip + 12, 4 );
+        memcpy( key.dst, ip + 16, 4 );
+
+        const bool later_fragment = read_u16( ip + 6 ) & 0x1fff;
+        if ( not later_fragment ) {
+            transport_offset = ip_offset + header_length;
+        }
+        break;
+    }
+
+    case 6:
+    {
+        if ( length < ip_offset + 40u ) {
+            return;
+        }
+
+        key.ip_version = 6;
+        const uint8_t traffic_class = ( ( ip[ 0 ] & 0x0f ) << 4 ) | ( ip[ 1 ] >> 4 );
+        dscp = traffic_class >> 2;
+        ecn = traffic_class & 0x03;
+        memcpy( key.src, ip + 8, 16 );
+        memcpy( key.dst, ip + 24, 16 );
+
+        /* skip the extension headers to the transport header */
+        uint8_t next_header = ip[ 6 ];
+        size_t offset = ip_offset + 40;
+        for ( unsigned int headers = 0; headers < 8; headers++ ) {
+            if ( next_header == IPPROTO_HOPOPTS or next_header == IPPROTO_ROUTING
+                 or next_header == IPPROTO_DSTOPTS ) {
+                if ( length < offset + 2 ) {
+                    break; /* truncated */
+                }
+                next_header = packet[ offset ];
+                offset += ( packet[ offset + 1 ] + 1 ) * 8;
+            } else if ( next_header == IPPROTO_FRAGMENT ) {
+                if ( length < offset + 8 ) {
+                    break; /* truncated */
+                }
+                const bool later_fragment = read_u16( packet + offset + 2 ) & 0xfff8;
+                next_header = packet[ offset ];
+                offset += 8;
+                if ( later_fragment ) {
+                    key.protocol = next_header;
+                    break;
+                }
+            } else if ( next_header == IPPROTO_AH ) {
+                if ( length < offset + 2 ) {
+                    break; /* truncated */
+                }
+                next_header = packet[ offset ];
+                offset += ( packet[ offset + 1 ] + 2 ) * 4;
+            } else {
+                key.protocol = next_header;
+                transport_offset = offset;
+                break;
+            }
+        }
+        break;
+    }
+
+    default:
+        return;
+    }
+
+    if ( transport_offset and has_ports( key.protocol ) and length >= transport_offset + 4 ) {
+        key.src_port = read_u16( packet + transport_offset );
+        key.dst_port = read_u16( packet + transport_offset + 2 );
+    }
+
+    flow_hash = key.hash();
+}
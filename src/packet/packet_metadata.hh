@@ -0,0 +1,45 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef PACKET_METADATA_HH
+#define PACKET_METADATA_HH
+
+#include <cstdint>
+#include <cstring>
+
+#include "packet_buffer.hh"
+
+/* the 5-tuple, laid out so it can be hashed and compared as five words */
+struct FlowKey
+{
+    uint8_t src[ 16 ], dst[ 16 ]; /* IPv4 addresses take the first four bytes */
+    uint16_t src_port, dst_port; /* host byte order */
+    uint8_t protocol; /* IPPROTO_* */
+    uint8_t ip_version; /* 4 or 6; 0 for anything else */
+    uint8_t padding[ 2 ];
+
+    FlowKey() : src(), dst(), src_port( 0 ), dst_port( 0 ), protocol( 0 ), ip_version( 0 ), padding() {}
+
+    bool operator==( const FlowKey & other ) const { return not memcmp( this, &other, sizeof( *this ) ); }
+    bool operator!=( const FlowKey & other ) const { return not operator==( other ); }
+
+    uint32_t hash( void ) const;
+};
+
+/* What the queues and logs need from a packet's headers, parsed once
+   when it arrives. The contents are a TUN frame: the 4-byte packet
+   information header, then an IPv4 or IPv6 packet. */
+struct PacketMetadata
+{
+    FlowKey key;
+    uint32_t flow_hash;
+    uint32_t size; /* of the contents, so the queues needn't touch the packet */
+    uint16_t ip_offset; /* of the IP header in the contents */
+    uint8_t dscp, ecn;
+
+    /* on anything but TCP-like or UDP-like traffic over IP, or a
+       truncated or later-fragment packet, the ports (and perhaps more
+       of the key) are 0, so such packets share a flow */
+    PacketMetadata( const PacketBuffer & contents );
+};
+
+#endif /* PACKET_METADATA_HH */
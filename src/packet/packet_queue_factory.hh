@@ -0,0 +1,18 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef PACKET_QUEUE_FACTORY_HH
+#define PACKET_QUEUE_FACTORY_HH
+
+#include <memory>
+#include <string>
+
+#include "abstract_packet_queue.hh"
+
+/* the queue named by type ("infinite", "droptail", "codel", ...), or
+   nullptr if there is no such type */
+std::unique_ptr<AbstractPacketQueue> make_packet_queue( const std::string & type, const std::string & args );
+
+/* the names make_packet_queue() accepts, for usage messages */
+const std::string & packet_queue_types( void );
+
+#endif /* PACKET_QUEUE_FACTORY_HH */
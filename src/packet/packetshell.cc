@@ -16,6 +16,9 @@
 #include "timestamp.hh"
 #include "exception.hh"
 #include "bindworkaround.hh"
+#include "ferry_stats.hh"
+#include "ezio.hh"
+#include "control_socket.hh"
 #include "config.h"
 
 using namespace std;
@@ -24,6 +27,7 @@ using namespace PollerShortNames;
 template <class FerryQueueType>
 PacketShell<FerryQueueType>::PacketShell( const std::string & device_prefix, char ** const user_environment )
     : user_environment_( user_environment ),
+      ferry_config_( get_ferry_config() ),
       egress_ingress( two_unassigned_addresses( get_mahimahi_base() ) ),
       nameserver_( first_nameserver() ),
       egress_tun_( device_prefix + "-" + to_string( getpid() ) , egress_addr(), ingress_addr() ),
@@ -77,7 +81,7 @@ void PacketShell<FerryQueueType>::start_uplink( const string & shell_prefix,
 
             SystemCall( "ioctl SIOCADDRT", ioctl( UDPSocket().fd_num(), SIOCADDRT, &route ) );
 
-            Ferry inner_ferry;
+            Ferry inner_ferry( ferry_config_, "uplink" );
 
             /* dnsmasq doesn't distinguish between UDP and TCP forwarding nameservers,
                so use a DNSProxy that listens on the same UDP and TCP port */
@@ -149,7 +153,7 @@ void PacketShell<FerryQueueType>::start_downlink( Targs&&... Fargs )
             /* downlink packets go to inner namespace's TUN device */
             FileDescriptor ingress_tun = pipe_.second.recv_fd();
 
-            Ferry outer_ferry;
+            Ferry outer_ferry( ferry_config_, "downlink" );
 
             dns_outside_.register_handlers( outer_ferry );
 
@@ -169,21 +173,62 @@ int PacketShell<FerryQueueType>::Ferry::loop( FerryQueueType & ferry_queue,
                                               FileDescriptor & tun,
                                               FileDescriptor & sibling )
 {
-    /* tun device gets datagram -> read it -> give to ferry */
-    add_simple_input_handler( tun, 
-                              [&] () {
-                                  ferry_queue.read_packet( tun.read() );
-                                  return ResultType::Continue;
-                              } );
+    BatchStatistics batch_statistics( config_.batch_size );
+    LatenessStatistics lateness_statistics;
+
+    /* datagrams go out through the event loop (queued as io_uring submissions, or written directly) */
+    PacketSink & sibling_sink = packet_sink( sibling );
+
+    /* arm the timer for the queue's next event, early by the spin interval */
+    const uint64_t spin_ns = uint64_t( config_.spin_us ) * 1000;
+    uint64_t next_event_ns = -1;
+    const auto schedule_next_event = [&] () {
+        const uint64_t next_event_us = ferry_queue.next_event_time();
+        next_event_ns = next_event_us == uint64_t( -1 ) ? -1 : next_event_us * 1000;
+        set_timer( next_event_ns == uint64_t( -1 ) or next_event_ns <= spin_ns
+                   ? next_event_ns : next_event_ns - spin_ns );
+    };
+
+    /* tun device gets datagrams -> read them (several per wakeup) -> give to ferry */
+    add_packet_reader( tun, config_.batch_size,
+                       [&] ( vector<PacketBuffer> & packets ) {
+                           for ( const auto & packet : packets ) {
+                               ferry_queue.read_packet( packet );
+                           }
+
+                           batch_statistics.record( packets.size() );
+
+                           /* flush whatever the batch made ready without another trip through the poller */
+                           if ( ferry_queue.pending_output() ) {
+                               ferry_queue.write_packets( sibling_sink );
+                           }
+
+                           schedule_next_event();
+                       } );
 
     /* ferry ready to write datagram -> send to sibling's tun device */
     add_action( Poller::Action( sibling, Direction::Out,
                                 [&] () {
-                                    ferry_queue.write_packets( sibling );
+                                    ferry_queue.write_packets( sibling_sink );
+                                    schedule_next_event();
                                     return ResultType::Continue;
                                 },
                                 [&] () { return ferry_queue.pending_output(); } ) );
 
+    /* queue's next event is due -> let it send whatever is ready */
+    add_timer_handler( [&] () {
+            uint64_t now = timestamp_ns();
+            while ( now < next_event_ns ) {
+                now = timestamp_ns(); /* spin out the rest */
+            }
+
+            lateness_statistics.record( now - next_event_ns );
+
+            ferry_queue.write_packets( sibling_sink );
+            schedule_next_event();
+            return ResultType::Continue;
+        } );
+
     /* exit if finished */
     add_action( Poller::Action( sibling, Direction::Out,
                                 [&] () {
@@ -191,24 +236,30 @@ int PacketShell<FerryQueueType>::Ferry::loop( FerryQueueType & ferry_queue,
                                 },
                                 [&] () { return ferry_queue.finished(); } ) );
 
-    return internal_loop( [&] () { return ferry_queue.wait_time(); } );
-}
-
-struct TemporaryEnvironment
-{
-    TemporaryEnvironment( char ** const env )
-    {
-        if ( environ != nullptr ) {
-            throw runtime_error( "TemporaryEnvironment: cannot be entered recursively" );
-        }
-        environ = env;
+    /* command on the control socket -> change the link between packets */
+    ControlSocket * const control = ferry_queue.control_socket();
+    if ( control ) {
+        add_simple_input_handler( *control,
+                                  [&] () {
+                                      control->serve( [&] ( const string & command ) {
+                                              return ferry_queue.control( command );
+                                          } );
+                                      schedule_next_event();
+                                      return ResultType::Continue;
+                                  } );
     }
 
-    ~TemporaryEnvironment()
-    {
-        environ = nullptr;
+    schedule_next_event();
+
+    const int ret = internal_loop();
+
+    if ( config_.print_statistics ) {
+        cerr << "mahimahi " << name_ << " ferry: " << batch_statistics.summary();
+        cerr << "mahimahi " << name_ << " ferry: " << lateness_statistics.summary();
     }
-};
+
+    return ret;
+}
 
 template <class FerryQueueType>
 Address PacketShell<FerryQueueType>::get_mahimahi_base( void ) const
@@ -225,3 +276,43 @@ Address PacketShell<FerryQueueType>::get_mahimahi_base( void ) const
 
     return Address( mahimahi_base, 0 );
 }
+
+template <class FerryQueueType>
+FerryConfig PacketShell<FerryQueueType>::get_ferry_config( void ) const
+{
+    /* as above, read the user's environment before dropping privileges */
+    TemporarilyUnprivileged tu;
+    TemporaryEnvironment te { user_environment_ };
+
+    FerryConfig config;
+
+    const char * const batch_size = getenv( "MAHIMAHI_FERRY_BATCH" );
+    if ( batch_size ) {
+        const long int value = myatoi( batch_size );
+        if ( value < 1 or value > 4096 ) {
+            throw runtime_error( "MAHIMAHI_FERRY_BATCH must be between 1 and 4096" );
+        }
+        config.batch_size = value;
+    }
+
+    const char * const print_statistics = getenv( "MAHIMAHI_FERRY_STATS" );
+    if ( print_statistics and string( print_statistics ) != "0" ) {
+        config.print_statistics = true;
+    }
+
+    const char * const spin_us = getenv( "MAHIMAHI_FERRY_SPIN" );
+    if ( spin_us ) {
+        const long int value = myatoi( spin_us );
+        if ( value < 0 or value > 1000 ) {
+            throw runtime_error( "MAHIMAHI_FERRY_SPIN must be between 0 and 1000 (microseconds)" );
+        }
+        config.spin_us = value;
+    }
+
+    const char * const backend = getenv( "MAHIMAHI_EVENT_BACKEND" );
+    if ( backend ) {
+        config.backend = Poller::backend_from_name( backend );
+    }
+
+    return config;
+}
@@ -13,11 +13,28 @@
 #include "event_loop.hh"
 #include "socketpair.hh"
 
+/* ferry tuning, taken from the user's environment (see mahimahi(1)) */
+struct FerryConfig
+{
+    /* most packets drained from the TUN device per wakeup (MAHIMAHI_FERRY_BATCH) */
+    unsigned int batch_size = 32;
+
+    /* print per-wakeup statistics when the ferry exits (MAHIMAHI_FERRY_STATS) */
+    bool print_statistics = false;
+
+    /* event loop backend for the ferries (MAHIMAHI_EVENT_BACKEND) */
+    Poller::Backend backend = Poller::Backend::Poll;
+
+    /* wake this long before each queue deadline and spin until it (MAHIMAHI_FERRY_SPIN, us) */
+    unsigned int spin_us = 0;
+};
+
 template <class FerryQueueType>
 class PacketShell
 {
 private:
     char ** const user_environment_;
+    FerryConfig ferry_config_;
     std::pair<Address, Address> egress_ingress;
     Address nameserver_;
     TunDevice egress_tun_;
@@ -33,11 +50,19 @@ private:
 
     class Ferry : public EventLoop
     {
+    private:
+        const FerryConfig & config_;
+        const std::string name_;
+
     public:
+        Ferry( const FerryConfig & config, const std::string & name )
+            : EventLoop( config.backend ), config_( config ), name_( name ) {}
+
         int loop( FerryQueueType & ferry_queue, FileDescriptor & tun, FileDescriptor & sibling );
     };
 
     Address get_mahimahi_base( void ) const;
+    FerryConfig get_ferry_config( void ) const;
 
 public:
     PacketShell( const std::string & device_prefix, char ** const user_environment );
@@ -10,22 +10,22 @@ using namespace std;
 
 PIEPacketQueue::PIEPacketQueue( const string & args )
   : DroppingPacketQueue(args),
-    qdelay_ref_ ( get_arg( args, "qdelay_ref" ) ),
-    max_burst_ ( get_arg( args, "max_burst" ) ),
+    qdelay_ref_ ( get_arg( args, "qdelay_ref" ) * 1000 ),
+    max_burst_ ( get_arg( args, "max_burst" ) * 1000 ),
     alpha_ ( 0.125 ),
     beta_ ( 1.25 ),
-    t_update_ ( 30 ),
+    t_update_ ( 30000 ),
     dq_threshold_ ( 16384 ),
     drop_prob_ ( 0.0 ),
     burst_allowance_ ( 0 ),
     qdelay_old_ ( 0 ),
     current_qdelay_ ( 0 ),
     dq_count_ ( DQ_COUNT_INVALID ),
-    dq_tstamp_ ( 0 ),
     avg_dq_rate_ ( 0 ),
+    dq_tstamp_ ( 0 ),
     uniform_generator_ ( 0.0, 1.0 ),
     prng_( random_device()() ),
-    last_update_( timestamp() )
+    last_update_( timestamp_us() )
 {
   if ( qdelay_ref_ == 0 || max_burst_ == 0 ) {
     throw runtime_error( "PIE AQM queue must have qdelay_ref and max_burst parameters" );
@@ -36,9 +36,10 @@ void PIEPacketQueue::enqueue( QueuedPacket && p )
 {
   calculate_drop_prob();
 
-  if ( ! good_with( size_bytes() + p.contents.size(),
+  if ( ! good_with( size_bytes() + p.metadata.size,
 		    size_packets() + 1 ) ) {
     // Internal queue is full. Packet has to be dropped.
+    drop( std::move( p ) );
     return;
   } 
 
@@ -47,6 +48,11 @@ void PIEPacketQueue::enqueue( QueuedPacket && p )
     //It is used to enqueue rather than drop the packet
     //All other packets are dropped
     accept( std::move( p ) );
+  } else if ( drop_prob_ <= 0.1 && mark( p ) ) {
+    //With ECN, mark rather than drop while the probability is low (RFC 8033 5.1)
+    accept( std::move( p ) );
+  } else {
+    drop( std::move( p ) );
   }
 
   assert( good() );
@@ -79,7 +85,7 @@ bool PIEPacketQueue::drop_early ()
 QueuedPacket PIEPacketQueue::dequeue( void )
 {
   QueuedPacket ret = std::move( DroppingPacketQueue::dequeue () );
-  uint32_t now = timestamp();
+  const uint64_t now = timestamp_us();
 
   if ( size_bytes() >= dq_threshold_ && dq_count_ == DQ_COUNT_INVALID ) {
     dq_tstamp_ = now;
@@ -87,13 +93,13 @@ QueuedPacket PIEPacketQueue::dequeue( void )
   }
 
   if ( dq_count_ != DQ_COUNT_INVALID ) {
-    dq_count_ += ret.contents.size();
+    dq_count_ += ret.metadata.size;
 
     if ( dq_count_ > dq_threshold_ ) {
-      uint32_t dtime = now - dq_tstamp_;
+      const uint64_t dtime = now - dq_tstamp_;
 
       if ( dtime > 0 ) {
-	uint32_t rate_sample = dq_count_ / dtime;
+	uint32_t rate_sample = uint64_t( dq_count_ ) * 1000 / dtime;
 	if ( avg_dq_rate_ == 0 ) 
 	  avg_dq_rate_ = rate_sample;
 	else
@@ -125,7 +131,7 @@ QueuedPacket PIEPacketQueue::dequeue( void )
 
 void PIEPacketQueue::calculate_drop_prob( void )
 {
-  uint64_t now = timestamp();
+  uint64_t now = timestamp_us();
 
   //We can't have a fork inside the mahimahi shell so we simulate
   //the periodic drop probability calculation here by repeating it for the
@@ -138,7 +144,7 @@ void PIEPacketQueue::calculate_drop_prob( void )
     qdelay_old_ = current_qdelay_;
 
     if ( avg_dq_rate_ > 0 ) 
-      current_qdelay_ = size_bytes() / avg_dq_rate_;
+      current_qdelay_ = uint64_t( size_bytes() ) * 1000 / avg_dq_rate_;
     else
       current_qdelay_ = 0;
 
@@ -146,8 +152,9 @@ void PIEPacketQueue::calculate_drop_prob( void )
       update_prob = false;
     }
 
-    double p = (alpha_ * (int)(current_qdelay_ - qdelay_ref_) ) +
-      ( beta_ * (int)(current_qdelay_ - qdelay_old_) );
+    //alpha and beta are per millisecond of queueing delay
+    double p = (alpha_ * ( (double) current_qdelay_ - qdelay_ref_ ) / 1000 ) +
+      ( beta_ * ( (double) current_qdelay_ - qdelay_old_ ) / 1000 );
 
     if ( drop_prob_ < 0.01 ) {
       p /= 128;
@@ -3,15 +3,19 @@
 #ifndef QUEUED_PACKET_HH
 #define QUEUED_PACKET_HH
 
-#include <string>
+#include <cstdint>
+
+#include "packet_buffer.hh"
+#include "packet_metadata.hh"
 
 struct QueuedPacket
 {
-    uint64_t arrival_time;
-    std::string contents;
+    uint64_t arrival_time; /* microseconds (timestamp_us) */
+    PacketBuffer contents;
+    PacketMetadata metadata; /* classified once, on arrival */
 
-    QueuedPacket( const std::string & s_contents, uint64_t s_arrival_time )
-        : arrival_time( s_arrival_time ), contents( s_contents )
+    QueuedPacket( const PacketBuffer & s_contents, uint64_t s_arrival_time )
+        : arrival_time( s_arrival_time ), contents( s_contents ), metadata( contents )
     {}
 };
 
@@ -0,0 +1,138 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <vector>
+
+#include "control_socket.hh"
+#include "exception.hh"
+#include "util.hh"
+
+using namespace std;
+
+static const size_t MAX_MESSAGE = 65536;
+
+static sockaddr_un unix_address( const string & path )
+{
+    sockaddr_un address;
+    zero( address );
+    address.sun_family = AF_UNIX;
+
+    if ( path.empty() or path.size() >= sizeof( address.sun_path ) ) {
+        throw runtime_error( "control socket path must be between 1 and "
+                             + to_string( sizeof( address.sun_path ) - 1 ) + " characters: " + path );
+    }
+
+    path.copy( address.sun_path, path.size() );
+    return address;
+}
+
+static void bind_to( FileDescriptor & socket, const string & path )
+{
+    const sockaddr_un address = unix_address( path );
+    SystemCall( "bind " + path, ::bind( socket.fd_num(), reinterpret_cast<const sockaddr *>( &address ),
+                                       sizeof( address ) ) );
+}
+
+ControlSocket::ControlSocket( const string & path )
+    : FileDescriptor( SystemCall( "socket", socket( AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0 ) ) ),
+      path_( path )
+{
+    /* replace the socket left by an earlier run, but nothing else */
+    struct stat info;
+    if ( lstat( path_.c_str(), &info ) == 0 and S_ISSOCK( info.st_mode ) ) {
+        SystemCall( "unlink " + path_, unlink( path_.c_str() ) );
+    }
+
+    bind_to( *this, path_ );
+    set_blocking( false );
+}
+
+ControlSocket::~ControlSocket()
+{
+    unlink( path_.c_str() );
+}
+
+void ControlSocket::serve( const function<string(const string &)> & handler )
+{
+    vector<char> buffer( MAX_MESSAGE );
+    sockaddr_un sender;
+    socklen_t sender_length = sizeof( sender );
+
+    const ssize_t length = recvfrom( fd_num(), buffer.data(), buffer.size(), 0,
+                                     reinterpret_cast<sockaddr *>( &sender ), &sender_length );
+    if ( length < 0 ) {
+        if ( errno == EAGAIN or errno == EWOULDBLOCK ) {
+            return;
+        }
+        throw unix_error( "recvfrom" );
+    }
+
+    register_read();
+
+    string command( buffer.data(), length );
+    while ( not command.empty() and ( command.back() == '\n' or command.back() == '\r' ) ) {
+        command.pop_back();
+    }
+
+    const string reply = handler( command );
+
+    /* an unbound sender can't be answered; a sender that has gone away needn't be */
+    if ( sender_length > sizeof( sa_family_t ) ) {
+        if ( sendto( fd_num(), reply.data(), reply.size(), MSG_DONTWAIT,
+                     reinterpret_cast<const sockaddr *>( &sender ), sender_length ) >= 0 ) {
+            register_write();
+        }
+    }
+}
+
+string ControlSocket::request( const string & path, const string & command )
+{
+    /* the reply needs an address to come back to */
+    char directory_template[] = "/tmp/mm-control.XXXXXX";
+    if ( not mkdtemp( directory_template ) ) {
+        throw unix_error( "mkdtemp" );
+    }
+    const string directory = directory_template;
+    const string reply_path = directory + "/reply";
+
+    FileDescriptor reply_socket( SystemCall( "socket", ::socket( AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0 ) ) );
+
+    string reply;
+    try {
+        bind_to( reply_socket, reply_path );
+
+        /* the ferry runs unprivileged, perhaps as another user than ours */
+        SystemCall( "chmod", chmod( directory.c_str(), 0711 ) );
+        SystemCall( "chmod", chmod( reply_path.c_str(), 0666 ) );
+
+        const sockaddr_un server = unix_address( path );
+        SystemCall( "connect " + path, connect( reply_socket.fd_num(), reinterpret_cast<const sockaddr *>( &server ),
+                                                sizeof( server ) ) );
+
+        const timeval timeout { 5, 0 };
+        SystemCall( "setsockopt", setsockopt( reply_socket.fd_num(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof( timeout ) ) );
+
+        SystemCall( "send", send( reply_socket.fd_num(), command.data(), command.size(), 0 ) );
+
+        vector<char> buffer( MAX_MESSAGE );
+        const ssize_t length = recv( reply_socket.fd_num(), buffer.data(), buffer.size(), 0 );
+        if ( length < 0 ) {
+            const int recv_errno = errno;
+            throw unix_error( recv_errno == EAGAIN ? "no reply from " + path : "recv", recv_errno );
+        }
+        reply.assign( buffer.data(), length );
+    } catch ( ... ) {
+        unlink( reply_path.c_str() );
+        rmdir( directory.c_str() );
+        throw;
+    }
+
+    unlink( reply_path.c_str() );
+    rmdir( directory.c_str() );
+
+    return reply;
+}
@@ -0,0 +1,38 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef CONTROL_SOCKET_HH
+#define CONTROL_SOCKET_HH
+
+#include <string>
+#include <functional>
+
+#include "file_descriptor.hh"
+
+/* A Unix-domain datagram socket at a path in the filesystem, taking
+   commands for a running ferry: one command per datagram, answered
+   with one datagram back to the sender. (A path, not the abstract
+   namespace, so it can be reached from outside the ferry's network
+   namespace.) */
+class ControlSocket : public FileDescriptor
+{
+private:
+    std::string path_;
+
+public:
+    ControlSocket( const std::string & path );
+    ~ControlSocket();
+
+    const std::string & path( void ) const { return path_; }
+
+    /* read a waiting command, and send the sender what handler makes of it */
+    void serve( const std::function<std::string(const std::string &)> & handler );
+
+    /* send a command to the socket at path and wait for the reply */
+    static std::string request( const std::string & path, const std::string & command );
+
+    /* forbid copying */
+    ControlSocket( const ControlSocket & other ) = delete;
+    ControlSocket & operator=( const ControlSocket & other ) = delete;
+};
+
+#endif /* CONTROL_SOCKET_HH */
@@ -54,7 +54,8 @@ void DNSProxy::handle_udp( void )
                 dns_server.connect( udp_target_ );
                 dns_server.write( request.second );
 
-                /* wait up to 60 seconds for a reply */
+                /* wait up to 60 seconds for a reply (with poll(2), as
+                   setting up epoll or io_uring would cost more than one wait) */
                 Poller poller;
 
                 poller.add_action( Poller::Action( dns_server, Direction::In,
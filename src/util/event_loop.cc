@@ -8,9 +8,10 @@
 using namespace std;
 using namespace PollerShortNames;
 
-EventLoop::EventLoop()
+EventLoop::EventLoop( const Poller::Backend backend )
     : signals_( { SIGCHLD, SIGCONT, SIGHUP, SIGTERM, SIGQUIT, SIGINT } ),
-      poller_(),
+      poller_( backend ),
+      timer_(),
       child_processes_()
 {
     signals_.set_as_mask(); /* block signals so we can later use signalfd to read them */
@@ -22,6 +23,17 @@ void EventLoop::add_simple_input_handler( FileDescriptor & fd,
     poller_.add_action( Poller::Action( fd, Direction::In, callback ) );
 }
 
+void EventLoop::add_timer_handler( const Poller::Action::CallbackType & callback )
+{
+    poller_.add_action( Poller::Action( timer_, Direction::In,
+                                        [this, callback] () {
+                                            if ( not timer_.expire() ) {
+                                                return Result(); /* re-armed meanwhile */
+                                            }
+                                            return callback();
+                                        } ) );
+}
+
 Result EventLoop::handle_signal( const signalfd_siginfo & sig )
 {
     switch ( sig.ssi_signo ) {
@@ -80,7 +92,7 @@ Result EventLoop::handle_signal( const signalfd_siginfo & sig )
     return ResultType::Continue;
 }
 
-int EventLoop::internal_loop( const std::function<int(void)> & wait_time )
+int EventLoop::internal_loop( void )
 {
     TemporarilyUnprivileged tu;
 
@@ -98,7 +110,7 @@ int EventLoop::internal_loop( const std::function<int(void)> & wait_time )
                               [&] () { return handle_signal( signal_fd.read_signal() ); } );
 
     while ( true ) {
-        const auto poll_result = poller_.poll( wait_time() );
+        const auto poll_result = poller_.poll( -1 );
         if ( poll_result.result == Poller::Result::Type::Exit ) {
             return poll_result.exit_status;
         }
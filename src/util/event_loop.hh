@@ -5,10 +5,12 @@
 
 #include <vector>
 #include <functional>
+#include <cstdint>
 
 #include "poller.hh"
 #include "file_descriptor.hh"
 #include "signalfd.hh"
+#include "timerfd.hh"
 #include "child_process.hh"
 #include "util.hh"
 
@@ -17,19 +19,37 @@ class EventLoop
 private:
     SignalMask signals_;
     Poller poller_;
+    TimerFD timer_;
     std::vector<std::pair<int, ChildProcess>> child_processes_;
     PollerShortNames::Result handle_signal( const signalfd_siginfo & sig );
 
 protected:
     void add_action( Poller::Action action ) { poller_.add_action( action ); }
 
-    int internal_loop( const std::function<int(void)> & wait_time );
+    /* run callback once the deadline passed to set_timer() is reached */
+    void add_timer_handler( const Poller::Action::CallbackType & callback );
+
+    /* absolute deadline on the timestamp_ns() clock (-1: none); replaces any earlier one */
+    void set_timer( const uint64_t deadline_ns ) { timer_.set_deadline( deadline_ns ); }
+
+    int internal_loop( void );
 
 public:
-    EventLoop();
+    EventLoop( const Poller::Backend backend = Poller::Backend::Poll );
+
+    Poller::Backend backend( void ) const { return poller_.backend(); }
 
     void add_simple_input_handler( FileDescriptor & fd, const Poller::Action::CallbackType & callback );
 
+    /* datagrams from a packet device, delivered in batches of at most batch_size */
+    void add_packet_reader( FileDescriptor & fd, const unsigned int batch_size,
+                            const Poller::PacketCallbackType & callback )
+    {
+        poller_.add_packet_reader( fd, batch_size, callback );
+    }
+
+    PacketSink & packet_sink( FileDescriptor & fd ) { return poller_.packet_sink( fd ); }
+
     template <typename... Targs>
     void add_child_process( Targs&&... Fargs )
     {
@@ -45,7 +65,7 @@ public:
         child_processes_.emplace_back( continue_status, ChildProcess( std::forward<Targs>( Fargs )... ) );
     }
 
-    int loop( void ) { return internal_loop( [] () { return -1; } ); } /* no timeout */
+    int loop( void ) { return internal_loop(); }
 
     virtual ~EventLoop() {}
 };
@@ -5,6 +5,7 @@
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <cerrno>
 
 using namespace std;
 
@@ -49,6 +50,18 @@ FileDescriptor::~FileDescriptor()
     }
 }
 
+void FileDescriptor::set_blocking( const bool blocking )
+{
+    int flags = SystemCall( "fcntl F_GETFL", fcntl( fd_, F_GETFL ) );
+    if ( blocking ) {
+        flags &= ~O_NONBLOCK;
+    } else {
+        flags |= O_NONBLOCK;
+    }
+
+    SystemCall( "fcntl F_SETFL", fcntl( fd_, F_SETFL, flags ) );
+}
+
 /* attempt to write a portion of a string */
 string::const_iterator FileDescriptor::write( const string::const_iterator & begin,
                                               const string::const_iterator & end )
@@ -82,6 +95,49 @@ string FileDescriptor::read( const size_t limit )
     return string( buffer, bytes_read );
 }
 
+/* read method for pooled packet buffers */
+PacketBuffer FileDescriptor::read_buffer( void )
+{
+    PacketBuffer buffer = PacketBuffer::allocate();
+
+    ssize_t bytes_read = ::read( fd_, buffer.mutable_data(), PacketBuffer::CAPACITY );
+    if ( bytes_read < 0 and ( errno == EAGAIN or errno == EWOULDBLOCK ) ) {
+        return PacketBuffer();
+    }
+
+    SystemCall( "read", bytes_read );
+    if ( bytes_read == 0 ) {
+        set_eof();
+    }
+
+    register_read();
+
+    buffer.resize( bytes_read );
+    return buffer;
+}
+
+/* write method for pooled packet buffers */
+void FileDescriptor::write( const PacketBuffer & buffer )
+{
+    const char * it = buffer.data();
+    const char * const end = it + buffer.size();
+
+    if ( it >= end ) {
+        throw runtime_error( "nothing to write" );
+    }
+
+    do {
+        ssize_t bytes_written = SystemCall( "write", ::write( fd_, it, end - it ) );
+        if ( bytes_written == 0 ) {
+            throw runtime_error( "write returned 0" );
+        }
+
+        register_write();
+
+        it += bytes_written;
+    } while ( it != end );
+}
+
 /* write method */
 string::const_iterator FileDescriptor::write( const std::string & buffer, const bool write_all )
 {
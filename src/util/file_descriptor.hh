@@ -5,6 +5,8 @@
 
 #include <string>
 
+#include "packet_buffer.hh"
+
 /* Unix file descriptors (sockets, files, etc.) */
 class FileDescriptor
 {
@@ -22,6 +24,9 @@ protected:
     void register_write( void ) { write_count_++; }
     void set_eof( void ) { eof_ = true; }
 
+    /* the io_uring Poller reads and writes on our behalf */
+    friend class Poller;
+
 public:
     /* construct from fd number */
     FileDescriptor( const int fd );
@@ -38,12 +43,20 @@ public:
     unsigned int read_count( void ) const { return read_count_; }
     unsigned int write_count( void ) const { return write_count_; }
 
+    /* set or clear O_NONBLOCK */
+    void set_blocking( const bool blocking );
+
     /* read and write methods */
     std::string read( const size_t limit = BUFFER_SIZE );
     std::string::const_iterator write( const std::string & buffer, const bool write_all = true );
     std::string::const_iterator write( const std::string::const_iterator & begin,
                                        const std::string::const_iterator & end );
 
+    /* read one datagram straight into a pooled slab, and write one back out */
+    /* (on a non-blocking fd, read_buffer returns an empty buffer when nothing is ready) */
+    PacketBuffer read_buffer( void );
+    void write( const PacketBuffer & buffer );
+
     /* forbid copying FileDescriptor objects or assigning them */
     FileDescriptor( const FileDescriptor & other ) = delete;
     const FileDescriptor & operator=( const FileDescriptor & other ) = delete;
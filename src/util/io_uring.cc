@@ -0,0 +1,204 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <cstring>
+#include <csignal>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "io_uring.hh"
+#include "exception.hh"
+
+using namespace std;
+
+static int io_uring_setup( const unsigned int entries, io_uring_params & params )
+{
+    return syscall( __NR_io_uring_setup, entries, &params );
+}
+
+static int io_uring_enter( const int fd, const unsigned int to_submit, const unsigned int min_complete,
+                           const unsigned int flags, const void * arg, const size_t arg_size )
+{
+    return syscall( __NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size );
+}
+
+static int io_uring_register( const int fd, const unsigned int opcode, const void * arg, const unsigned int nr_args )
+{
+    return syscall( __NR_io_uring_register, fd, opcode, arg, nr_args );
+}
+
+static int setup_ring( const unsigned int entries, const unsigned int completion_entries, io_uring_params & params )
+{
+    memset( &params, 0, sizeof( params ) );
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = completion_entries;
+
+    return SystemCall( "io_uring_setup", io_uring_setup( entries, params ) );
+}
+
+static size_t ring_length( const io_uring_params & params )
+{
+    return max( params.sq_off.array + params.sq_entries * sizeof( unsigned int ),
+                params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe ) );
+}
+
+IOUring::Mapping::Mapping( const int fd, const size_t length, const uint64_t offset )
+    : addr_( mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset ) ),
+      length_( length )
+{
+    if ( addr_ == MAP_FAILED ) {
+        throw unix_error( "mmap io_uring" );
+    }
+}
+
+IOUring::Mapping::~Mapping()
+{
+    if ( munmap( addr_, length_ ) < 0 ) {
+        print_exception( unix_error( "munmap io_uring" ) );
+    }
+}
+
+IOUring::IOUring( const unsigned int entries, const unsigned int completion_entries )
+    : params_(),
+      fd_( setup_ring( entries, completion_entries, params_ ) ),
+      rings_( fd_.fd_num(), ring_length( params_ ), IORING_OFF_SQ_RING ),
+      sqes_mapping_( fd_.fd_num(), params_.sq_entries * sizeof( io_uring_sqe ), IORING_OFF_SQES ),
+      sq_head_( reinterpret_cast<unsigned int *>( rings_.get() + params_.sq_off.head ) ),
+      sq_tail_( reinterpret_cast<unsigned int *>( rings_.get() + params_.sq_off.tail ) ),
+      sq_array_( reinterpret_cast<unsigned int *>( rings_.get() + params_.sq_off.array ) ),
+      sq_mask_( *reinterpret_cast<unsigned int *>( rings_.get() + params_.sq_off.ring_mask ) ),
+      sqes_( reinterpret_cast<io_uring_sqe *>( sqes_mapping_.get() ) ),
+      sq_local_tail_( *sq_tail_ ),
+      cq_head_( reinterpret_cast<unsigned int *>( rings_.get() + params_.cq_off.head ) ),
+      cq_tail_( reinterpret_cast<unsigned int *>( rings_.get() + params_.cq_off.tail ) ),
+      cq_mask_( *reinterpret_cast<unsigned int *>( rings_.get() + params_.cq_off.ring_mask ) ),
+      cqes_( reinterpret_cast<io_uring_cqe *>( rings_.get() + params_.cq_off.cqes ) ),
+      supported_ops_()
+{
+    /* one mapping covers both rings only with IORING_FEAT_SINGLE_MMAP (Linux 5.4) */
+    if ( not ( params_.features & IORING_FEAT_SINGLE_MMAP ) ) {
+        throw runtime_error( "io_uring: kernel lacks IORING_FEAT_SINGLE_MMAP" );
+    }
+
+    /* submission slots map one-to-one onto entries */
+    for ( unsigned int i = 0; i < params_.sq_entries; i++ ) {
+        sq_array_[ i ] = i;
+    }
+
+    probe();
+}
+
+void IOUring::probe( void )
+{
+    const unsigned int max_ops = 256;
+    vector<char> buffer( sizeof( io_uring_probe ) + max_ops * sizeof( io_uring_probe_op ) );
+    io_uring_probe * const probe = reinterpret_cast<io_uring_probe *>( buffer.data() );
+
+    SystemCall( "io_uring_register PROBE",
+                io_uring_register( fd_.fd_num(), IORING_REGISTER_PROBE, probe, max_ops ) );
+
+    supported_ops_.assign( max_ops, false );
+    for ( unsigned int i = 0; i < probe->ops_len; i++ ) {
+        if ( probe->ops[ i ].flags & IO_URING_OP_SUPPORTED ) {
+            supported_ops_.at( probe->ops[ i ].op ) = true;
+        }
+    }
+}
+
+bool IOUring::supports( const uint8_t opcode ) const
+{
+    return opcode < supported_ops_.size() and supported_ops_[ opcode ];
+}
+
+bool IOUring::supported( void )
+{
+    static const bool is_supported = [] () {
+        try {
+            IOUring ring( 4, 8 );
+            return ( ring.params_.features & IORING_FEAT_EXT_ARG )
+                and ( ring.params_.features & IORING_FEAT_CQE_SKIP )
+                and ring.supports( IORING_OP_POLL_ADD )
+                and ring.supports( IORING_OP_PROVIDE_BUFFERS )
+                and ring.supports( IORING_OP_WRITE )
+                and ring.supports( OP_READ_MULTISHOT );
+        } catch ( const exception & e ) {
+            return false;
+        }
+    } ();
+
+    return is_supported;
+}
+
+io_uring_sqe & IOUring::next_sqe( void )
+{
+    if ( sq_local_tail_ - __atomic_load_n( sq_head_, __ATOMIC_ACQUIRE ) >= params_.sq_entries ) {
+        submit();
+    }
+
+    io_uring_sqe & sqe = sqes_[ sq_local_tail_ & sq_mask_ ];
+    memset( &sqe, 0, sizeof( sqe ) );
+    sq_local_tail_++;
+
+    return sqe;
+}
+
+void IOUring::submit( void )
+{
+    const unsigned int to_submit = sq_local_tail_ - *sq_tail_;
+    __atomic_store_n( sq_tail_, sq_local_tail_, __ATOMIC_RELEASE );
+
+    if ( to_submit ) {
+        SystemCall( "io_uring_enter", io_uring_enter( fd_.fd_num(), to_submit, 0, 0, nullptr, 0 ) );
+    }
+}
+
+bool IOUring::submit_and_wait( const int64_t timeout_us )
+{
+    const unsigned int to_submit = sq_local_tail_ - *sq_tail_;
+    __atomic_store_n( sq_tail_, sq_local_tail_, __ATOMIC_RELEASE );
+
+    if ( timeout_us == 0 ) {
+        if ( to_submit ) {
+            SystemCall( "io_uring_enter", io_uring_enter( fd_.fd_num(), to_submit, 0, 0, nullptr, 0 ) );
+        }
+        return true;
+    }
+
+    __kernel_timespec timeout;
+    timeout.tv_sec = timeout_us / 1000000;
+    timeout.tv_nsec = ( timeout_us % 1000000 ) * 1000;
+
+    io_uring_getevents_arg arg;
+    memset( &arg, 0, sizeof( arg ) );
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = timeout_us < 0 ? 0 : reinterpret_cast<uint64_t>( &timeout );
+
+    const int ret = io_uring_enter( fd_.fd_num(), to_submit, 1,
+                                    IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                    &arg, sizeof( arg ) );
+    if ( ret < 0 ) {
+        if ( errno == ETIME ) {
+            return false;
+        } else if ( errno == EINTR ) {
+            return true;
+        }
+        throw unix_error( "io_uring_enter" );
+    }
+
+    return true;
+}
+
+bool IOUring::pop_completion( io_uring_cqe & cqe )
+{
+    const unsigned int head = *cq_head_;
+    if ( head == __atomic_load_n( cq_tail_, __ATOMIC_ACQUIRE ) ) {
+        return false;
+    }
+
+    cqe = cqes_[ head & cq_mask_ ];
+    __atomic_store_n( cq_head_, head + 1, __ATOMIC_RELEASE );
+
+    return true;
+}
@@ -0,0 +1,83 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef IO_URING_HH
+#define IO_URING_HH
+
+#include <cstdint>
+#include <vector>
+
+#include <linux/io_uring.h>
+
+#include "file_descriptor.hh"
+
+/* minimal wrapper for a Linux io_uring instance, using the raw system calls */
+
+class IOUring
+{
+public:
+    /* multishot read was added in Linux 6.7, after many <linux/io_uring.h> were shipped */
+    const static uint8_t OP_READ_MULTISHOT = 49;
+
+private:
+    class Mapping
+    {
+    private:
+        void * addr_;
+        size_t length_;
+
+    public:
+        Mapping( const int fd, const size_t length, const uint64_t offset );
+        ~Mapping();
+
+        char * get( void ) const { return static_cast<char *>( addr_ ); }
+
+        Mapping( const Mapping & other ) = delete;
+        Mapping & operator=( const Mapping & other ) = delete;
+    };
+
+    io_uring_params params_;
+    FileDescriptor fd_;
+    Mapping rings_, sqes_mapping_;
+
+    /* submission queue */
+    unsigned int * sq_head_, * sq_tail_, * sq_array_;
+    unsigned int sq_mask_;
+    io_uring_sqe * sqes_;
+    unsigned int sq_local_tail_;
+
+    /* completion queue */
+    unsigned int * cq_head_, * cq_tail_;
+    unsigned int cq_mask_;
+    io_uring_cqe * cqes_;
+
+    std::vector<bool> supported_ops_;
+
+    void probe( void );
+
+public:
+    IOUring( const unsigned int entries, const unsigned int completion_entries );
+
+    /* true if the running kernel allows io_uring with everything the Poller relies on */
+    static bool supported( void );
+
+    bool supports( const uint8_t opcode ) const;
+
+    /* zeroed submission entry (submits the queue first if it is full) */
+    io_uring_sqe & next_sqe( void );
+
+    /* submit queued entries and wait for at least one completion
+       (timeout_us < 0 waits forever, 0 does not wait); returns false on timeout */
+    bool submit_and_wait( const int64_t timeout_us );
+
+    /* submit queued entries without waiting */
+    void submit( void );
+
+    /* copy out the next completion, if any */
+    bool pop_completion( io_uring_cqe & cqe );
+
+    /* forbid copying */
+    IOUring( const IOUring & other ) = delete;
+    IOUring & operator=( const IOUring & other ) = delete;
+};
+
+#endif /* IO_URING_HH */
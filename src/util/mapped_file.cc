@@ -0,0 +1,49 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mapped_file.hh"
+#include "file_descriptor.hh"
+#include "exception.hh"
+
+using namespace std;
+
+static size_t file_size( const FileDescriptor & fd )
+{
+    struct stat info;
+    SystemCall( "fstat", fstat( fd.fd_num(), &info ) );
+    return info.st_size;
+}
+
+static const char * map_file( const FileDescriptor & fd, const size_t size, const string & filename )
+{
+    if ( size == 0 ) {
+        throw runtime_error( filename + ": empty file" );
+    }
+
+    void * const addr = mmap( nullptr, size, PROT_READ, MAP_SHARED, fd.fd_num(), 0 );
+    if ( addr == MAP_FAILED ) {
+        throw unix_error( "mmap " + filename );
+    }
+
+    return static_cast<const char *>( addr );
+}
+
+MappedFile::MappedFile( const string & filename )
+    : size_( 0 ),
+      data_( nullptr )
+{
+    /* the mapping outlives the descriptor */
+    FileDescriptor fd( SystemCall( "open " + filename, open( filename.c_str(), O_RDONLY | O_CLOEXEC ) ) );
+    size_ = file_size( fd );
+    data_ = map_file( fd, size_, filename );
+}
+
+MappedFile::~MappedFile()
+{
+    if ( munmap( const_cast<char *>( data_ ), size_ ) < 0 ) {
+        print_exception( unix_error( "munmap" ) );
+    }
+}
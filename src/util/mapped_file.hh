@@ -0,0 +1,29 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef MAPPED_FILE_HH
+#define MAPPED_FILE_HH
+
+#include <string>
+
+/* read-only shared mapping of a whole file (pages come from the page
+   cache, so every process mapping the same file shares them) */
+
+class MappedFile
+{
+private:
+    size_t size_;
+    const char * data_;
+
+public:
+    MappedFile( const std::string & filename );
+    ~MappedFile();
+
+    const char * data( void ) const { return data_; }
+    size_t size( void ) const { return size_; }
+
+    /* forbid copying */
+    MappedFile( const MappedFile & other ) = delete;
+    MappedFile & operator=( const MappedFile & other ) = delete;
+};
+
+#endif /* MAPPED_FILE_HH */
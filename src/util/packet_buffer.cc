@@ -0,0 +1,147 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <cstring>
+#include <cassert>
+#include <stdexcept>
+
+#include "packet_buffer.hh"
+
+using namespace std;
+
+PacketBufferPool & PacketBufferPool::pool( void )
+{
+    static PacketBufferPool the_pool;
+    return the_pool;
+}
+
+void PacketBufferPool::grow( void )
+{
+    chunks_.emplace_back( new PacketBuffer::Slab[ SLABS_PER_CHUNK ] );
+
+    PacketBuffer::Slab * chunk = chunks_.back().get();
+    for ( size_t i = 0; i < SLABS_PER_CHUNK; i++ ) {
+        chunk[ i ].next_free = free_list_;
+        free_list_ = &chunk[ i ];
+    }
+}
+
+PacketBuffer::Slab * PacketBufferPool::get( void )
+{
+    if ( not free_list_ ) {
+        grow();
+    }
+
+    PacketBuffer::Slab * ret = free_list_;
+    free_list_ = ret->next_free;
+    slabs_in_use_++;
+
+    ret->references = 1;
+    ret->length = 0;
+    ret->next_free = nullptr;
+
+    return ret;
+}
+
+void PacketBufferPool::put( PacketBuffer::Slab * slab )
+{
+    assert( slab->references == 0 );
+    assert( slabs_in_use_ > 0 );
+
+    slab->next_free = free_list_;
+    free_list_ = slab;
+    slabs_in_use_--;
+}
+
+PacketBuffer::PacketBuffer( const string & contents )
+    : slab_( PacketBufferPool::pool().get() )
+{
+    if ( contents.size() > CAPACITY ) {
+        release();
+        throw runtime_error( "PacketBuffer: contents larger than slab" );
+    }
+
+    memcpy( slab_->data, contents.data(), contents.size() );
+    slab_->length = contents.size();
+}
+
+PacketBuffer PacketBuffer::allocate( void )
+{
+    return PacketBuffer( PacketBufferPool::pool().get() );
+}
+
+PacketBuffer::PacketBuffer( const PacketBuffer & other )
+    : slab_( other.slab_ )
+{
+    if ( slab_ ) {
+        slab_->references++;
+    }
+}
+
+PacketBuffer & PacketBuffer::operator=( const PacketBuffer & other )
+{
+    Slab * const new_slab = other.slab_;
+    if ( new_slab ) {
+        new_slab->references++;
+    }
+
+    release();
+    slab_ = new_slab;
+
+    return *this;
+}
+
+PacketBuffer & PacketBuffer::operator=( PacketBuffer && other ) noexcept
+{
+    if ( this != &other ) {
+        release();
+        slab_ = other.slab_;
+        other.slab_ = nullptr;
+    }
+
+    return *this;
+}
+
+void PacketBuffer::release( void )
+{
+    if ( not slab_ ) {
+        return;
+    }
+
+    assert( slab_->references > 0 );
+
+    if ( --slab_->references == 0 ) {
+        PacketBufferPool::pool().put( slab_ );
+    }
+
+    slab_ = nullptr;
+}
+
+void PacketBuffer::resize( const size_t length )
+{
+    if ( length > CAPACITY ) {
+        throw runtime_error( "PacketBuffer: resize beyond slab capacity" );
+    }
+
+    if ( not slab_ ) {
+        if ( length == 0 ) {
+            return;
+        }
+        slab_ = PacketBufferPool::pool().get();
+    }
+
+    slab_->length = length;
+}
+
+void PacketBuffer::unshare( void )
+{
+    if ( use_count() <= 1 ) {
+        return;
+    }
+
+    Slab * const copy = PacketBufferPool::pool().get();
+    memcpy( copy->data, slab_->data, slab_->length );
+    copy->length = slab_->length;
+
+    release();
+    slab_ = copy;
+}
@@ -0,0 +1,103 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef PACKET_BUFFER_HH
+#define PACKET_BUFFER_HH
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+/* reference-counted handle to a fixed-size packet slab from a PacketBufferPool */
+
+/* Copying a PacketBuffer shares the slab; the slab goes back to the
+   pool's free list when the last handle is destroyed. The pool is not
+   thread-safe: buffers must be created and released by the thread that
+   runs the ferry (each ferry lives in its own process). */
+
+class PacketBuffer
+{
+public:
+    /* room for the 1504-byte TUN payload (packet info header + 1500-byte MTU) */
+    const static size_t CAPACITY = 2048;
+
+    struct Slab
+    {
+        unsigned int references;
+        size_t length;
+        Slab * next_free;
+        char data[ CAPACITY ];
+    };
+
+private:
+    Slab * slab_;
+
+    explicit PacketBuffer( Slab * s_slab ) : slab_( s_slab ) {}
+
+    void release( void );
+
+public:
+    /* empty buffer that owns no slab */
+    PacketBuffer() : slab_( nullptr ) {}
+
+    /* copy a string into a freshly allocated slab */
+    explicit PacketBuffer( const std::string & contents );
+
+    /* new slab with length 0 and the full capacity available for writing */
+    static PacketBuffer allocate( void );
+
+    PacketBuffer( const PacketBuffer & other );
+    PacketBuffer & operator=( const PacketBuffer & other );
+
+    PacketBuffer( PacketBuffer && other ) noexcept : slab_( other.slab_ ) { other.slab_ = nullptr; }
+    PacketBuffer & operator=( PacketBuffer && other ) noexcept;
+
+    ~PacketBuffer() { release(); }
+
+    const char * data( void ) const { return slab_ ? slab_->data : nullptr; }
+    char * mutable_data( void ) { return slab_ ? slab_->data : nullptr; }
+
+    size_t size( void ) const { return slab_ ? slab_->length : 0; }
+    bool empty( void ) const { return size() == 0; }
+    void resize( const size_t length );
+
+    /* copy the contents into a slab of our own if others share this one,
+       so they can be modified through mutable_data() */
+    void unshare( void );
+
+    /* number of handles sharing this slab */
+    unsigned int use_count( void ) const { return slab_ ? slab_->references : 0; }
+
+    /* copy of the contents (not for the packet path) */
+    std::string str( void ) const { return std::string( data(), size() ); }
+};
+
+class PacketBufferPool
+{
+private:
+    /* slabs are allocated this many at a time and never returned to the heap */
+    const static size_t SLABS_PER_CHUNK = 256;
+
+    std::vector<std::unique_ptr<PacketBuffer::Slab[]>> chunks_;
+    PacketBuffer::Slab * free_list_;
+    size_t slabs_in_use_;
+
+    void grow( void );
+
+    PacketBufferPool() : chunks_(), free_list_( nullptr ), slabs_in_use_( 0 ) {}
+
+public:
+    static PacketBufferPool & pool( void );
+
+    PacketBuffer::Slab * get( void );
+    void put( PacketBuffer::Slab * slab );
+
+    size_t slabs_in_use( void ) const { return slabs_in_use_; }
+    size_t slabs_allocated( void ) const { return chunks_.size() * SLABS_PER_CHUNK; }
+
+    /* forbid copying */
+    PacketBufferPool( const PacketBufferPool & other ) = delete;
+    PacketBufferPool & operator=( const PacketBufferPool & other ) = delete;
+};
+
+#endif /* PACKET_BUFFER_HH */
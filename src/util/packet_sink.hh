@@ -0,0 +1,31 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef PACKET_SINK_HH
+#define PACKET_SINK_HH
+
+#include "packet_buffer.hh"
+#include "file_descriptor.hh"
+
+/* where a ferry queue sends its outgoing datagrams */
+
+class PacketSink
+{
+public:
+    virtual void send( const PacketBuffer & packet ) = 0;
+
+    virtual ~PacketSink() {}
+};
+
+/* write each datagram immediately */
+class FileDescriptorSink : public PacketSink
+{
+private:
+    FileDescriptor & fd_;
+
+public:
+    FileDescriptorSink( FileDescriptor & fd ) : fd_( fd ) {}
+
+    void send( const PacketBuffer & packet ) override { fd_.write( packet ); }
+};
+
+#endif /* PACKET_SINK_HH */
@@ -0,0 +1,68 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perf_counters.hh"
+#include "exception.hh"
+
+using namespace std;
+
+int PerfCounters::open_counter( const pid_t pid, const uint32_t type, const uint64_t config,
+                                const bool kernel )
+{
+    perf_event_attr attr;
+    memset( &attr, 0, sizeof( attr ) );
+    attr.size = sizeof( attr );
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = true;
+    attr.exclude_kernel = not kernel;
+    attr.exclude_hv = true;
+
+    return syscall( __NR_perf_event_open, &attr, pid, -1 /* any cpu */, -1 /* no group */,
+                    PERF_FLAG_FD_CLOEXEC );
+}
+
+PerfCounters::PerfCounters( const pid_t pid )
+    : counters_(), kernel_( true )
+{
+    const vector<pair<string, pair<uint32_t, uint64_t>>> events = {
+        { "cycles", { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES } },
+        { "instructions", { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS } },
+        { "cache_misses", { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES } },
+        { "context_switches", { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES } } };
+
+    for ( const auto & event : events ) {
+        int fd = open_counter( pid, event.second.first, event.second.second, kernel_ );
+        if ( fd < 0 and errno == EACCES and kernel_ ) {
+            /* perf_event_paranoid >= 2: user-mode events only, from here on */
+            kernel_ = false;
+            fd = open_counter( pid, event.second.first, event.second.second, kernel_ );
+        }
+
+        if ( fd >= 0 ) {
+            counters_.emplace_back( event.first, FileDescriptor( fd ) );
+        }
+    }
+}
+
+vector<pair<string, uint64_t>> PerfCounters::read( void )
+{
+    vector<pair<string, uint64_t>> ret;
+
+    for ( auto & counter : counters_ ) {
+        uint64_t count;
+        const ssize_t bytes_read = SystemCall( "read", ::read( counter.second.fd_num(), &count, sizeof( count ) ) );
+        if ( bytes_read != sizeof( count ) ) {
+            throw runtime_error( "PerfCounters: short read of " + counter.first );
+        }
+        ret.emplace_back( counter.first, count );
+    }
+
+    return ret;
+}
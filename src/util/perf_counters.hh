@@ -0,0 +1,41 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef PERF_COUNTERS_HH
+#define PERF_COUNTERS_HH
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <sys/types.h>
+
+#include "file_descriptor.hh"
+
+/* perf_event_open(2) counters on a process and the children it forks
+   from now on. Children's counts are added when they exit, so read()
+   is complete once the whole process tree has exited. */
+
+class PerfCounters
+{
+private:
+    std::vector<std::pair<std::string, FileDescriptor>> counters_;
+    bool kernel_;
+
+    /* the counter, or -1 if the kernel won't provide it */
+    static int open_counter( const pid_t pid, const uint32_t type, const uint64_t config,
+                             const bool kernel );
+
+public:
+    /* opens whichever counters this machine and perf_event_paranoid allow */
+    PerfCounters( const pid_t pid );
+
+    bool empty( void ) const { return counters_.empty(); }
+
+    /* are kernel-mode events counted too? */
+    bool counts_kernel( void ) const { return kernel_; }
+
+    /* name and count of each counter */
+    std::vector<std::pair<std::string, uint64_t>> read( void );
+};
+
+#endif /* PERF_COUNTERS_HH */
@@ -2,16 +2,346 @@
 
 #include <algorithm>
 #include <numeric>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+
 #include "poller.hh"
+#include "io_uring.hh"
 #include "exception.hh"
 
 using namespace std;
 using namespace PollerShortNames;
 
+/* io_uring backend: submissions and completions are tagged with
+   what they belong to (high 32 bits) and its index (low 32 bits) */
+enum class Tag : uint64_t { ActionPoll = 1, PacketRead = 2, PacketWrite = 3, ProvideBuffer = 4 };
+
+static uint64_t make_user_data( const Tag tag, const unsigned int index )
+{
+    return ( static_cast<uint64_t>( tag ) << 32 ) | index;
+}
+
+static const unsigned int SUBMISSION_ENTRIES = 256;
+static const unsigned int COMPLETION_ENTRIES = 4096;
+static const unsigned int WRITE_SLOTS = 256;
+
+/* datagrams read from one fd, and (io_uring backend) the slabs
+   handed to the kernel for its multishot read to fill */
+class Poller::PacketReader
+{
+public:
+    const static unsigned int PROVIDED_BUFFERS = 256;
+
+    FileDescriptor & fd;
+    const unsigned int batch_size;
+    const PacketCallbackType callback;
+
+    std::vector<PacketBuffer> batch;
+
+    /* io_uring backend: slabs the kernel may fill, by buffer id */
+    std::vector<PacketBuffer> provided;
+    bool armed;
+
+    /* epoll backend: may have datagrams we haven't read yet */
+    bool readable;
+
+    PacketReader( FileDescriptor & s_fd, const unsigned int s_batch_size,
+                  const PacketCallbackType & s_callback )
+        : fd( s_fd ), batch_size( s_batch_size ), callback( s_callback ),
+          batch(), provided(), armed( false ), readable( false )
+    {
+        batch.reserve( batch_size );
+    }
+
+    void deliver( void )
+    {
+        if ( not batch.empty() ) {
+            callback( batch );
+            batch.clear();
+        }
+    }
+};
+
+/* queues each datagram as a write submission, sent on the next poll() */
+class Poller::RingSink : public PacketSink
+{
+private:
+    Poller & poller_;
+    FileDescriptor & fd_;
+
+public:
+    RingSink( Poller & poller, FileDescriptor & fd ) : poller_( poller ), fd_( fd ) {}
+
+    void send( const PacketBuffer & packet ) override { poller_.queue_write( fd_, packet ); }
+};
+
+Poller::Poller( const Backend backend )
+    : backend_( ( backend == Backend::IOUring and not IOUring::supported() ) ? Backend::Poll : backend ),
+      ring_( backend_ == Backend::IOUring ? new IOUring( SUBMISSION_ENTRIES, COMPLETION_ENTRIES ) : nullptr ),
+      actions_(),
+      pollfds_(),
+      armed_(),
+      epoll_( backend_ == Backend::Epoll
+              ? new FileDescriptor( SystemCall( "epoll_create1", epoll_create1( EPOLL_CLOEXEC ) ) )
+              : nullptr ),
+      epoll_entries_(),
+      interest_(),
+      action_entries_(),
+      predicated_actions_(),
+      dirty_entries_(),
+      interested_entries_( 0 ),
+      packet_readers_(),
+      packet_sinks_(),
+      writes_in_flight_(),
+      free_write_slots_(),
+      deferred_completions_()
+{
+    if ( ring_ ) {
+        writes_in_flight_.resize( WRITE_SLOTS );
+        for ( unsigned int i = 0; i < WRITE_SLOTS; i++ ) {
+            free_write_slots_.push_back( WRITE_SLOTS - 1 - i );
+        }
+    }
+}
+
+Poller::~Poller()
+{
+    /* tear down the ring before the buffers it may still refer to */
+    ring_.reset();
+}
+
+Poller::Backend Poller::backend_from_name( const string & name )
+{
+    if ( name == "poll" ) {
+        return Backend::Poll;
+    } else if ( name == "epoll" ) {
+        return Backend::Epoll;
+    } else if ( name == "io_uring" ) {
+        return Backend::IOUring;
+    }
+
+    throw runtime_error( "unknown event backend \"" + name + "\" (expected poll, epoll or io_uring)" );
+}
+
 void Poller::add_action( Poller::Action action )
 {
     actions_.push_back( action );
     pollfds_.push_back( { action.fd.fd_num(), 0, 0 } );
+    armed_.push_back( false );
+    interest_.push_back( 0 );
+
+    if ( epoll_ ) {
+        const unsigned int index = actions_.size() - 1;
+        const unsigned int entry_index = epoll_entry( action.fd );
+        epoll_entries_.at( entry_index ).actions.push_back( index );
+        action_entries_.push_back( entry_index );
+        if ( action.when_interested ) {
+            predicated_actions_.push_back( index );
+        }
+        mark_dirty( entry_index );
+    }
+}
+
+unsigned int Poller::epoll_entry( FileDescriptor & fd )
+{
+    for ( unsigned int index = 0; index < epoll_entries_.size(); index++ ) {
+        if ( epoll_entries_[ index ].fd_num == fd.fd_num() ) {
+            return index;
+        }
+    }
+
+    /* register with no events; poll() fills them in */
+    epoll_event event;
+    event.events = 0;
+    event.data.u64 = 0;
+    event.data.u32 = epoll_entries_.size();
+    SystemCall( "epoll_ctl", epoll_ctl( epoll_->fd_num(), EPOLL_CTL_ADD, fd.fd_num(), &event ) );
+
+    epoll_entries_.push_back( { fd.fd_num(), {}, -1, 0, false } );
+    return epoll_entries_.size() - 1;
+}
+
+void Poller::mark_dirty( const unsigned int entry_index )
+{
+    EpollEntry & entry = epoll_entries_.at( entry_index );
+    if ( not entry.dirty ) {
+        entry.dirty = true;
+        dirty_entries_.push_back( entry_index );
+    }
+}
+
+/* work out an entry's events again, and tell the kernel if they changed */
+void Poller::update_epoll_entry( const unsigned int entry_index )
+{
+    EpollEntry & entry = epoll_entries_.at( entry_index );
+    entry.dirty = false;
+
+    uint32_t events = 0;
+    for ( const auto i : entry.actions ) {
+        const uint32_t direction = actions_.at( i ).direction == Direction::In ? EPOLLIN : EPOLLOUT;
+        interest_.at( i ) = interested( actions_.at( i ) ) ? direction : 0;
+        events |= interest_.at( i );
+    }
+
+    if ( entry.reader >= 0 and not packet_readers_.at( entry.reader )->fd.eof() ) {
+        events |= EPOLLIN;
+
+        /* Actions expect level-triggered readiness; a reader alone reads until EAGAIN */
+        if ( entry.actions.empty() ) {
+            events |= EPOLLET;
+        }
+    }
+
+    if ( events == entry.events ) {
+        return;
+    }
+
+    epoll_event event;
+    event.events = events;
+    event.data.u64 = 0;
+    event.data.u32 = entry_index;
+    SystemCall( "epoll_ctl", epoll_ctl( epoll_->fd_num(), EPOLL_CTL_MOD, entry.fd_num, &event ) );
+
+    const bool was_interested = entry.events & ( EPOLLIN | EPOLLOUT );
+    const bool now_interested = events & ( EPOLLIN | EPOLLOUT );
+    interested_entries_ += int( now_interested ) - int( was_interested );
+    entry.events = events;
+}
+
+void Poller::add_packet_reader( FileDescriptor & fd, const unsigned int batch_size,
+                                const PacketCallbackType & callback )
+{
+    if ( batch_size == 0 ) {
+        throw runtime_error( "Poller: packet batch size must be positive" );
+    }
+
+    packet_readers_.emplace_back( new PacketReader( fd, batch_size, callback ) );
+    PacketReader & reader = *packet_readers_.back();
+
+    if ( ring_ ) {
+        reader.provided.resize( PacketReader::PROVIDED_BUFFERS );
+        for ( unsigned int bid = 0; bid < PacketReader::PROVIDED_BUFFERS; bid++ ) {
+            provide_buffer( packet_readers_.size() - 1, bid );
+        }
+        arm_packet_reader( packet_readers_.size() - 1 );
+        return;
+    }
+
+    if ( epoll_ ) {
+        /* read until the device runs dry, as edge-triggered readiness requires */
+        fd.set_blocking( false );
+        const unsigned int entry_index = epoll_entry( fd );
+        epoll_entries_.at( entry_index ).reader = packet_readers_.size() - 1;
+        mark_dirty( entry_index );
+        return;
+    }
+
+    /* drain several datagrams per wakeup without blocking */
+    if ( batch_size > 1 ) {
+        fd.set_blocking( false );
+    }
+
+    add_action( Action( fd, Direction::In,
+                        [this, &reader] () {
+                            drain_packet_reader( reader );
+                            return ResultType::Continue;
+                        } ) );
+}
+
+void Poller::drain_packet_reader( PacketReader & reader )
+{
+    while ( reader.batch.size() < reader.batch_size ) {
+        PacketBuffer packet = reader.fd.read_buffer();
+        if ( packet.empty() ) {
+            break; /* nothing more to read */
+        }
+        reader.batch.push_back( move( packet ) );
+    }
+
+    /* a full batch may have left more behind */
+    reader.readable = reader.batch.size() == reader.batch_size and not reader.fd.eof();
+
+    reader.deliver();
+}
+
+PacketSink & Poller::packet_sink( FileDescriptor & fd )
+{
+    if ( ring_ ) {
+        packet_sinks_.emplace_back( new RingSink( *this, fd ) );
+    } else {
+        packet_sinks_.emplace_back( new FileDescriptorSink( fd ) );
+    }
+
+    return *packet_sinks_.back();
+}
+
+void Poller::provide_buffer( const unsigned int reader_index, const uint16_t bid )
+{
+    PacketBuffer & buffer = packet_readers_.at( reader_index )->provided.at( bid ) = PacketBuffer::allocate();
+
+    /* each reader's slabs form the buffer group with its index */
+    io_uring_sqe & sqe = ring_->next_sqe();
+    sqe.opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe.flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe.fd = 1; /* number of buffers */
+    sqe.addr = reinterpret_cast<uint64_t>( buffer.mutable_data() );
+    sqe.len = PacketBuffer::CAPACITY;
+    sqe.off = bid;
+    sqe.buf_group = reader_index;
+    sqe.user_data = make_user_data( Tag::ProvideBuffer, reader_index );
+}
+
+void Poller::arm_packet_reader( const unsigned int reader_index )
+{
+    PacketReader & reader = *packet_readers_.at( reader_index );
+
+    io_uring_sqe & sqe = ring_->next_sqe();
+    sqe.opcode = IOUring::OP_READ_MULTISHOT;
+    sqe.fd = reader.fd.fd_num();
+    sqe.flags = IOSQE_BUFFER_SELECT;
+    sqe.buf_group = reader_index;
+    sqe.user_data = make_user_data( Tag::PacketRead, reader_index );
+
+    reader.armed = true;
+}
+
+void Poller::queue_write( FileDescriptor & fd, const PacketBuffer & packet )
+{
+    if ( packet.empty() ) {
+        throw runtime_error( "nothing to write" );
+    }
+
+    /* out of slots: wait for earlier writes, saving other completions for poll() */
+    while ( free_write_slots_.empty() ) {
+        ring_->submit_and_wait( -1 );
+
+        io_uring_cqe cqe;
+        while ( ring_->pop_completion( cqe ) ) {
+            if ( static_cast<Tag>( cqe.user_data >> 32 ) == Tag::PacketWrite ) {
+                Result unused( Result::Type::Success );
+                handle_completion( cqe, unused );
+            } else {
+                deferred_completions_.push_back( cqe );
+            }
+        }
+    }
+
+    const unsigned int slot = free_write_slots_.back();
+    free_write_slots_.pop_back();
+    writes_in_flight_.at( slot ) = packet;
+
+    io_uring_sqe & sqe = ring_->next_sqe();
+    sqe.opcode = IORING_OP_WRITE;
+    sqe.fd = fd.fd_num();
+    sqe.addr = reinterpret_cast<uint64_t>( packet.data() );
+    sqe.len = packet.size();
+    sqe.off = -1; /* current file position (packet devices ignore it) */
+    sqe.user_data = make_user_data( Tag::PacketWrite, slot );
+
+    fd.register_write();
 }
 
 unsigned int Poller::Action::service_count( void ) const
@@ -19,21 +349,88 @@ unsigned int Poller::Action::service_count( void ) const
     return direction == Direction::In ? fd.read_count() : fd.write_count();
 }
 
+bool Poller::interested( Action & action )
+{
+    /* don't poll in on fds that have had EOF */
+    return action.active and ( not action.when_interested or action.when_interested() )
+        and not ( action.direction == Direction::In and action.fd.eof() );
+}
+
+bool Poller::service_action( Action & action, Result & result )
+{
+    const auto count_before = action.service_count();
+    auto callback_result = action.callback();
+
+    switch ( callback_result.result ) {
+    case ResultType::Exit:
+        result = Result( Result::Type::Exit, callback_result.exit_status );
+        return false;
+    case ResultType::Cancel:
+        action.active = false;
+        break;
+    case ResultType::Continue:
+        break;
+    }
+
+    if ( count_before == action.service_count() ) {
+        throw runtime_error( "Poller: busy wait detected: callback did not read/write fd" );
+    }
+
+    return true;
+}
+
 Poller::Result Poller::poll( const int & timeout_ms )
+{
+    return poll_us( timeout_ms < 0 ? -1 : int64_t( timeout_ms ) * 1000 );
+}
+
+Poller::Result Poller::poll_us( const int64_t & timeout_us )
+{
+    if ( ring_ ) {
+        return poll_with_io_uring( timeout_us );
+    } else if ( epoll_ ) {
+        return poll_with_epoll( timeout_us );
+    }
+
+    return poll_with_poll( timeout_us );
+}
+
+static timespec to_timespec( const int64_t & timeout_us )
+{
+    timespec ts;
+    ts.tv_sec = timeout_us / 1000000;
+    ts.tv_nsec = ( timeout_us % 1000000 ) * 1000;
+    return ts;
+}
+
+/* epoll_pwait2 (Linux 5.11) takes a timespec; older kernels get epoll_wait,
+   with the timeout rounded up to the next millisecond */
+static int epoll_wait_us( const int epfd, epoll_event * events, const int max_events,
+                          const int64_t & timeout_us )
+{
+    static bool have_pwait2 = true;
+
+    if ( have_pwait2 and timeout_us > 0 ) {
+        const timespec ts = to_timespec( timeout_us );
+        const int ret = syscall( __NR_epoll_pwait2, epfd, events, max_events, &ts, nullptr, 0 );
+        if ( ret >= 0 or errno != ENOSYS ) {
+            return ret;
+        }
+        have_pwait2 = false;
+    }
+
+    return epoll_wait( epfd, events, max_events,
+                       timeout_us <= 0 ? timeout_us : ( timeout_us + 999 ) / 1000 );
+}
+
+Poller::Result Poller::poll_with_poll( const int64_t & timeout_us )
 {
     assert( pollfds_.size() == actions_.size() );
 
     /* tell poll whether we care about each fd */
     for ( unsigned int i = 0; i < actions_.size(); i++ ) {
         assert( pollfds_.at( i ).fd == actions_.at( i ).fd.fd_num() );
-        pollfds_.at( i ).events = (actions_.at( i ).active and actions_.at( i ).when_interested())
-            ? actions_.at( i ).direction : 0;
-
-        /* don't poll in on fds that have had EOF */
-        if ( actions_.at( i ).direction == Direction::In
-             and actions_.at( i ).fd.eof() ) {
-            pollfds_.at( i ).events = 0;
-        }
+        pollfds_.at( i ).events = interested( actions_.at( i ) ) ? actions_.at( i ).direction : 0;
     }
 
     /* Quit if no member in pollfds_ has a non-zero direction */
@@ -42,7 +439,9 @@ Poller::Result Poller::poll( const int & timeout_ms )
         return Result::Type::Exit;
     }
 
-    if ( 0 == SystemCall( "poll", ::poll( &pollfds_[ 0 ], pollfds_.size(), timeout_ms ) ) ) {
+    const timespec timeout = to_timespec( timeout_us );
+    if ( 0 == SystemCall( "ppoll", ::ppoll( &pollfds_[ 0 ], pollfds_.size(),
+                                            timeout_us < 0 ? nullptr : &timeout, nullptr ) ) ) {
         return Result::Type::Timeout;
     }
 
@@ -55,24 +454,238 @@ Poller::Result Poller::poll( const int & timeout_ms )
         if ( pollfds_[ i ].revents & pollfds_[ i ].events ) {
             /* we only want to call callback if revents includes
                the event we asked for */
-            const auto count_before = actions_.at( i ).service_count();
-            auto result = actions_.at( i ).callback();
-
-            switch ( result.result ) {
-            case ResultType::Exit:
-                return Result( Result::Type::Exit, result.exit_status );
-            case ResultType::Cancel:
-                actions_.at( i ).active = false;
-                break;
-            case ResultType::Continue:
-                break;
+            Result result( Result::Type::Success );
+            if ( not service_action( actions_.at( i ), result ) ) {
+                return result;
             }
+        }
+    }
+
+    return Result::Type::Success;
+}
+
+Poller::Result Poller::poll_with_epoll( const int64_t & timeout_us )
+{
+    /* only predicates can change interest between iterations unseen */
+    for ( const auto i : predicated_actions_ ) {
+        const uint32_t direction = actions_.at( i ).direction == Direction::In ? EPOLLIN : EPOLLOUT;
+        if ( ( interested( actions_.at( i ) ) ? direction : 0 ) != interest_.at( i ) ) {
+            mark_dirty( action_entries_.at( i ) );
+        }
+    }
 
-            if ( count_before == actions_.at( i ).service_count() ) {
-                throw runtime_error( "Poller: busy wait detected: callback did not read/write fd" );
+    /* touch the kernel's interest list only for fds whose interest changed */
+    for ( const auto index : dirty_entries_ ) {
+        update_epoll_entry( index );
+    }
+    dirty_entries_.clear();
+
+    if ( interested_entries_ == 0 ) {
+        return Result::Type::Exit;
+    }
+
+    bool reader_pending = false;
+    for ( const auto & reader : packet_readers_ ) {
+        reader_pending |= reader->readable;
+    }
+
+    /* don't sleep while a reader still has datagrams waiting */
+    const unsigned int max_events = 64;
+    epoll_event events[ max_events ];
+    const int ready = SystemCall( "epoll_wait", epoll_wait_us( epoll_->fd_num(), events, max_events,
+                                                               reader_pending ? 0 : timeout_us ) );
+
+    if ( ready == 0 and not reader_pending ) {
+        return Result::Type::Timeout;
+    }
+
+    for ( int j = 0; j < ready; j++ ) {
+        if ( events[ j ].events & ( EPOLLERR | EPOLLHUP ) ) {
+            return Result::Type::Exit;
+        }
+
+        const EpollEntry & entry = epoll_entries_.at( events[ j ].data.u32 );
+
+        if ( entry.reader >= 0 and ( events[ j ].events & EPOLLIN ) ) {
+            packet_readers_.at( entry.reader )->readable = true;
+        }
+
+        for ( const auto i : entry.actions ) {
+            /* as with poll, only if the event is one we asked for */
+            if ( events[ j ].events & interest_.at( i ) ) {
+                Result result( Result::Type::Success );
+                if ( not service_action( actions_.at( i ), result ) ) {
+                    return result;
+                }
+
+                /* cancelled, or reached EOF */
+                const Action & action = actions_.at( i );
+                if ( not action.active or ( action.direction == Direction::In and action.fd.eof() ) ) {
+                    mark_dirty( events[ j ].data.u32 );
+                }
+            }
+        }
+    }
+
+    for ( auto & reader : packet_readers_ ) {
+        if ( reader->readable ) {
+            drain_packet_reader( *reader );
+            if ( reader->fd.eof() ) {
+                mark_dirty( epoll_entry( reader->fd ) );
             }
         }
     }
 
     return Result::Type::Success;
 }
+
+Poller::Result Poller::poll_with_io_uring( const int64_t & timeout_us )
+{
+    /* ask for a one-shot poll on each interested Action that doesn't have one outstanding */
+    bool any_interested = not packet_readers_.empty();
+    for ( unsigned int i = 0; i < actions_.size(); i++ ) {
+        if ( not interested( actions_.at( i ) ) ) {
+            continue;
+        }
+
+        any_interested = true;
+
+        if ( not armed_.at( i ) ) {
+            io_uring_sqe & sqe = ring_->next_sqe();
+            sqe.opcode = IORING_OP_POLL_ADD;
+            sqe.fd = actions_.at( i ).fd.fd_num();
+            sqe.poll32_events = actions_.at( i ).direction;
+            sqe.user_data = make_user_data( Tag::ActionPoll, i );
+            armed_.at( i ) = true;
+        }
+    }
+
+    if ( not any_interested ) {
+        return Result::Type::Exit;
+    }
+
+    /* one system call submits the queued writes and polls, and waits */
+    const bool timed_out = not ring_->submit_and_wait( deferred_completions_.empty() ? timeout_us : 0 );
+
+    vector<io_uring_cqe> completions;
+    swap( completions, deferred_completions_ );
+
+    io_uring_cqe cqe;
+    while ( ring_->pop_completion( cqe ) ) {
+        completions.push_back( cqe );
+    }
+
+    if ( completions.empty() and timed_out ) {
+        return Result::Type::Timeout;
+    }
+
+    Result result( Result::Type::Success );
+    for ( const auto & completion : completions ) {
+        if ( not handle_completion( completion, result ) ) {
+            return result;
+        }
+    }
+
+    /* hand over partial batches and rearm reads the kernel has ended */
+    for ( unsigned int i = 0; i < packet_readers_.size(); i++ ) {
+        packet_readers_.at( i )->deliver();
+        if ( not packet_readers_.at( i )->armed ) {
+            arm_packet_reader( i );
+        }
+    }
+
+    return result;
+}
+
+bool Poller::handle_completion( const io_uring_cqe & cqe, Result & result )
+{
+    const unsigned int index = cqe.user_data & 0xffffffff;
+
+    switch ( static_cast<Tag>( cqe.user_data >> 32 ) ) {
+    case Tag::ActionPoll:
+    {
+        armed_.at( index ) = false;
+
+        if ( cqe.res < 0 ) {
+            throw unix_error( "io_uring poll", -cqe.res );
+        }
+
+        if ( cqe.res & (POLLERR | POLLHUP | POLLNVAL) ) {
+            result = Result::Type::Exit;
+            return false;
+        }
+
+        /* interest may have lapsed since the poll was requested */
+        Action & action = actions_.at( index );
+        if ( not interested( action ) ) {
+            return true;
+        }
+
+        return service_action( action, result );
+    }
+
+    case Tag::PacketRead:
+    {
+        PacketReader & reader = *packet_readers_.at( index );
+
+        if ( not ( cqe.flags & IORING_CQE_F_MORE ) ) {
+            reader.armed = false;
+        }
+
+        if ( cqe.res == -ENOBUFS ) {
+            return true; /* kernel ran out of slabs; rearmed once the replacements are queued */
+        }
+
+        if ( cqe.res < 0 ) {
+            throw unix_error( "io_uring read", -cqe.res );
+        }
+
+        if ( not ( cqe.flags & IORING_CQE_F_BUFFER ) ) {
+            throw runtime_error( "io_uring read completed without a buffer" );
+        }
+
+        /* keep the filled slab, and queue a fresh one under the same id */
+        const uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+        PacketBuffer packet = move( reader.provided.at( bid ) );
+        provide_buffer( index, bid );
+
+        if ( cqe.res == 0 ) {
+            reader.fd.set_eof();
+            result = Result::Type::Exit;
+            return false;
+        }
+
+        reader.fd.register_read();
+        packet.resize( cqe.res );
+        reader.batch.push_back( move( packet ) );
+
+        if ( reader.batch.size() >= reader.batch_size ) {
+            reader.deliver();
+        }
+
+        return true;
+    }
+
+    case Tag::ProvideBuffer:
+        /* only failures are reported */
+        throw unix_error( "io_uring provide buffers", -cqe.res );
+
+    case Tag::PacketWrite:
+    {
+        PacketBuffer packet = move( writes_in_flight_.at( index ) );
+        free_write_slots_.push_back( index );
+
+        if ( cqe.res < 0 ) {
+            throw unix_error( "io_uring write", -cqe.res );
+        }
+
+        if ( static_cast<size_t>( cqe.res ) != packet.size() ) {
+            throw runtime_error( "io_uring write: short write to packet device" );
+        }
+
+        return true;
+    }
+    }
+
+    throw runtime_error( "Poller: unexpected io_uring completion" );
+}
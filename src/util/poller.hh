@@ -5,11 +5,18 @@
 
 #include <functional>
 #include <vector>
+#include <memory>
+#include <string>
 #include <cassert>
 
 #include <poll.h>
+#include <linux/io_uring.h>
 
 #include "file_descriptor.hh"
+#include "packet_buffer.hh"
+#include "packet_sink.hh"
+
+class IOUring;
 
 class Poller
 {
@@ -29,24 +36,32 @@ public:
         FileDescriptor & fd;
         enum PollDirection : short { In = POLLIN, Out = POLLOUT } direction;
         CallbackType callback;
-        std::function<bool(void)> when_interested;
+        std::function<bool(void)> when_interested; /* empty: always interested */
         bool active;
 
         Action( FileDescriptor & s_fd,
                 const PollDirection & s_direction,
                 const CallbackType & s_callback,
-                const std::function<bool(void)> & s_when_interested = [] () { return true; } )
+                const std::function<bool(void)> & s_when_interested = nullptr )
             : fd( s_fd ), direction( s_direction ), callback( s_callback ),
               when_interested( s_when_interested ), active( true ) {}
 
         unsigned int service_count( void ) const;
     };
 
-private:
-    std::vector< Action > actions_;
-    std::vector< pollfd > pollfds_;
+    /* Poll: poll(2) on every interested fd each iteration.
+       Epoll: one registration per fd, changed only when the interest
+       of its Actions changes (edge-triggered for packet readers). Each
+       iteration asks only the Actions with a when_interested()
+       predicate; the others can only lose interest when cancelled or
+       at EOF, which the Poller sees as it services them.
+       IOUring: one-shot poll requests for Actions, multishot reads
+       for packet readers, and packet writes queued as submissions. */
+    enum class Backend { Poll, Epoll, IOUring };
+
+    /* called with up to batch_size datagrams at a time */
+    typedef std::function<void(std::vector<PacketBuffer> &)> PacketCallbackType;
 
-public:
     struct Result
     {
         enum class Type { Success, Timeout, Exit } result;
@@ -55,9 +70,98 @@ public:
             : result( s_result ), exit_status( s_status ) {}
     };
 
-    Poller() : actions_(), pollfds_() {}
+private:
+    class PacketReader;
+    class RingSink;
+
+    Backend backend_;
+    std::unique_ptr<IOUring> ring_;
+
+    std::vector< Action > actions_;
+    std::vector< pollfd > pollfds_;
+
+    /* io_uring backend: which Actions have a poll request outstanding */
+    std::vector< bool > armed_;
+
+    /* epoll backend: the Actions (and packet reader) sharing each fd,
+       and the events currently registered for it */
+    struct EpollEntry
+    {
+        int fd_num;
+        std::vector< unsigned int > actions;
+        int reader;
+        uint32_t events;
+        bool dirty; /* on dirty_entries_ */
+    };
+
+    std::unique_ptr<FileDescriptor> epoll_;
+    std::vector< EpollEntry > epoll_entries_;
+    std::vector< uint32_t > interest_;
+
+    /* epoll backend: each Action's entry, the Actions with predicates,
+       the entries whose events must be worked out again, and how many
+       entries are registered for input or output */
+    std::vector< unsigned int > action_entries_;
+    std::vector< unsigned int > predicated_actions_;
+    std::vector< unsigned int > dirty_entries_;
+    unsigned int interested_entries_;
+
+    std::vector< std::unique_ptr<PacketReader> > packet_readers_;
+    std::vector< std::unique_ptr<PacketSink> > packet_sinks_;
+
+    /* io_uring backend: datagrams being written, by submission slot */
+    std::vector< PacketBuffer > writes_in_flight_;
+    std::vector< unsigned int > free_write_slots_;
+
+    /* completions reaped while waiting for a write slot */
+    std::vector< io_uring_cqe > deferred_completions_;
+
+    Result poll_with_poll( const int64_t & timeout_us );
+    Result poll_with_epoll( const int64_t & timeout_us );
+    Result poll_with_io_uring( const int64_t & timeout_us );
+
+    unsigned int epoll_entry( FileDescriptor & fd );
+    void mark_dirty( const unsigned int entry_index );
+    void update_epoll_entry( const unsigned int entry_index );
+    void drain_packet_reader( PacketReader & reader );
+
+    void queue_write( FileDescriptor & fd, const PacketBuffer & packet );
+    bool handle_completion( const io_uring_cqe & cqe, Result & result );
+    void provide_buffer( const unsigned int reader_index, const uint16_t bid );
+    void arm_packet_reader( const unsigned int reader_index );
+
+    static bool interested( Action & action );
+
+    /* run an Action's callback; false if the loop should exit with result */
+    bool service_action( Action & action, Result & result );
+
+public:
+    Poller( const Backend backend = Backend::Poll );
+    ~Poller();
+
+    /* the backend in use (IOUring falls back to Poll when the kernel lacks support) */
+    Backend backend( void ) const { return backend_; }
+
     void add_action( Action action );
+
+    /* deliver datagrams read from fd in batches (the fd must be a packet device) */
+    void add_packet_reader( FileDescriptor & fd, const unsigned int batch_size,
+                            const PacketCallbackType & callback );
+
+    /* sink that writes datagrams to fd (owned by the Poller) */
+    PacketSink & packet_sink( FileDescriptor & fd );
+
     Result poll( const int & timeout_ms );
+
+    /* same, with a timeout in microseconds (negative waits forever) */
+    Result poll_us( const int64_t & timeout_us );
+
+    /* "poll", "epoll" or "io_uring" */
+    static Backend backend_from_name( const std::string & name );
+
+    /* forbid copying */
+    Poller( const Poller & other ) = delete;
+    Poller & operator=( const Poller & other ) = delete;
 };
 
 namespace PollerShortNames {
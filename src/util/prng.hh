@@ -0,0 +1,84 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef PRNG_HH
+#define PRNG_HH
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <random>
+
+/* xoshiro256** (Blackman and Vigna): a few shifts and multiplies per
+   64-bit draw, with 32 bytes of state, so every queue can have its
+   own. A seed gives the same draws and uniform() values on every run
+   and machine (and the same normal() and exponential() samples, up to
+   libm rounding); a seed of 0 picks one at random. It also works as
+   the engine for the <random> distributions, but how those turn draws
+   into samples is up to the standard library, so they repeat only
+   with the same one. */
+
+class Prng
+{
+private:
+    uint64_t state_[ 4 ];
+
+    static uint64_t rotl( const uint64_t x, const int k ) { return ( x << k ) | ( x >> ( 64 - k ) ); }
+
+    /* splitmix64, to spread a seed over the whole state */
+    static uint64_t splitmix( uint64_t & x )
+    {
+        uint64_t z = ( x += 0x9e3779b97f4a7c15 );
+        z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9;
+        z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111eb;
+        return z ^ ( z >> 31 );
+    }
+
+public:
+    typedef uint64_t result_type;
+
+    Prng( uint64_t seed = 0 )
+        : state_()
+    {
+        if ( seed == 0 ) {
+            std::random_device device;
+            seed = ( uint64_t( device() ) << 32 ) | device();
+        }
+
+        for ( auto & word : state_ ) {
+            word = splitmix( seed );
+        }
+    }
+
+    static constexpr result_type min( void ) { return 0; }
+    static constexpr result_type max( void ) { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()( void )
+    {
+        const uint64_t ret = rotl( state_[ 1 ] * 5, 7 ) * 9;
+        const uint64_t t = state_[ 1 ] << 17;
+
+        state_[ 2 ] ^= state_[ 0 ];
+        state_[ 3 ] ^= state_[ 1 ];
+        state_[ 1 ] ^= state_[ 2 ];
+        state_[ 0 ] ^= state_[ 3 ];
+        state_[ 2 ] ^= t;
+        state_[ 3 ] = rotl( state_[ 3 ], 45 );
+
+        return ret;
+    }
+
+    /* in [0, 1), from the top 53 bits */
+    double uniform( void ) { return ( (*this)() >> 11 ) * ( 1.0 / ( uint64_t( 1 ) << 53 ) ); }
+
+    /* mean 0 and standard deviation 1, by Box-Muller from two uniform() values */
+    double normal( void )
+    {
+        const double radius = std::sqrt( -2 * std::log( 1 - uniform() ) );
+        return radius * std::cos( 6.283185307179586 * uniform() );
+    }
+
+    /* mean 1, by inversion */
+    double exponential( void ) { return -std::log( 1 - uniform() ); }
+};
+
+#endif /* PRNG_HH */
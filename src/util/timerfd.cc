@@ -0,0 +1,56 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "timerfd.hh"
+#include "timestamp.hh"
+#include "exception.hh"
+#include "util.hh"
+
+using namespace std;
+
+TimerFD::TimerFD()
+    : FileDescriptor( SystemCall( "timerfd_create", timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC ) ) ),
+      deadline_ns_( -1 )
+{}
+
+void TimerFD::set_deadline( const uint64_t deadline_ns )
+{
+    if ( deadline_ns == deadline_ns_ ) {
+        return;
+    }
+
+    itimerspec spec;
+    zero( spec ); /* an all-zero it_value disarms */
+
+    if ( deadline_ns != uint64_t( -1 ) ) {
+        const uint64_t monotonic_ns = monotonic_time_ns( deadline_ns );
+        spec.it_value.tv_sec = monotonic_ns / 1000000000;
+        spec.it_value.tv_nsec = monotonic_ns % 1000000000;
+    }
+
+    SystemCall( "timerfd_settime", timerfd_settime( fd_num(), TFD_TIMER_ABSTIME, &spec, nullptr ) );
+    deadline_ns_ = deadline_ns;
+}
+
+bool TimerFD::expire( void )
+{
+    uint64_t expirations;
+    const ssize_t bytes_read = ::read( fd_num(), &expirations, sizeof( expirations ) );
+    register_read();
+
+    if ( bytes_read < 0 ) {
+        if ( errno == EAGAIN ) {
+            return false; /* re-armed since it became readable */
+        }
+        throw unix_error( "read timerfd" );
+    } else if ( bytes_read != sizeof( expirations ) ) {
+        throw runtime_error( "timerfd read size mismatch" );
+    }
+
+    deadline_ns_ = -1;
+    return true;
+}
@@ -0,0 +1,31 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef TIMERFD_HH
+#define TIMERFD_HH
+
+#include <cstdint>
+
+#include "file_descriptor.hh"
+
+/* wrapper class for a CLOCK_MONOTONIC timerfd armed with absolute deadlines */
+
+class TimerFD : public FileDescriptor
+{
+private:
+    uint64_t deadline_ns_; /* timestamp_ns() scale; -1 when disarmed */
+
+public:
+    TimerFD();
+
+    /* fire once timestamp_ns() reaches deadline_ns (-1 disarms);
+       a deadline already in the past fires at once, and setting the
+       current deadline again costs no system call */
+    void set_deadline( const uint64_t deadline_ns );
+
+    uint64_t deadline( void ) const { return deadline_ns_; }
+
+    /* acknowledge expiry (disarms); false if the timer had not fired */
+    bool expire( void );
+};
+
+#endif /* TIMERFD_HH */
@@ -5,24 +5,66 @@
 #include "timestamp.hh"
 #include "exception.hh"
 
-uint64_t raw_timestamp( void )
+static uint64_t raw_timestamp_ns( const clockid_t clock )
 {
     timespec ts;
-    SystemCall( "clock_gettime", clock_gettime( CLOCK_REALTIME, &ts ) );
+    SystemCall( "clock_gettime", clock_gettime( clock, &ts ) );
 
-    uint64_t millis = ts.tv_nsec / 1000000;
-    millis += uint64_t( ts.tv_sec ) * 1000;
+    return uint64_t( ts.tv_sec ) * 1000000000 + ts.tv_nsec;
+}
+
+struct Epoch
+{
+    uint64_t wall_ms, monotonic_ns;
 
-    return millis;
+    Epoch()
+        : wall_ms( raw_timestamp_ns( CLOCK_REALTIME ) / 1000000 ),
+          monotonic_ns( raw_timestamp_ns( CLOCK_MONOTONIC ) )
+    {}
+};
+
+static const Epoch & epoch( void )
+{
+    static const Epoch initial_value;
+    return initial_value;
+}
+
+/* set by mm-sim */
+static bool virtual_clock_in_use = false;
+static uint64_t virtual_now_ns = 0;
+
+void set_virtual_clock( const uint64_t t_ns )
+{
+    virtual_clock_in_use = true;
+    virtual_now_ns = t_ns;
 }
 
 uint64_t initial_timestamp( void )
 {
-    static uint64_t initial_value = raw_timestamp();
-    return initial_value;
+    return epoch().wall_ms;
+}
+
+uint64_t monotonic_time_ns( const uint64_t t_ns )
+{
+    return epoch().monotonic_ns + t_ns;
+}
+
+uint64_t timestamp_ns( void )
+{
+    if ( virtual_clock_in_use ) {
+        return virtual_now_ns;
+    }
+
+    const uint64_t base = epoch().monotonic_ns;
+    return raw_timestamp_ns( CLOCK_MONOTONIC ) - base;
+}
+
+uint64_t timestamp_us( void )
+{
+    return timestamp_ns() / 1000;
 }
 
 uint64_t timestamp( void )
 {
-    return raw_timestamp() - initial_timestamp();
+    return timestamp_ns() / 1000000;
 }
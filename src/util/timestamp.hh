@@ -5,7 +5,21 @@
 
 #include <cstdint>
 
-uint64_t timestamp( void );
+/* time elapsed since initial_timestamp() was first called, read from
+   CLOCK_MONOTONIC (so unaffected by changes to the wall clock) */
+uint64_t timestamp_ns( void );
+uint64_t timestamp_us( void );
+uint64_t timestamp( void ); /* milliseconds */
+
+/* wall-clock time (in ms since the epoch) of the first call */
 uint64_t initial_timestamp( void );
 
+/* the raw CLOCK_MONOTONIC reading at which timestamp_ns() equals t_ns */
+uint64_t monotonic_time_ns( const uint64_t t_ns );
+
+/* From now on, timestamp_ns() and friends read t_ns (and later
+   settings) instead of the clock, so a simulation can run the queues
+   faster than real time. The wall-clock initial_timestamp() is kept. */
+void set_virtual_clock( const uint64_t t_ns );
+
 #endif /* TIMESTAMP_HH */
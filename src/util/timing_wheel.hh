@@ -0,0 +1,255 @@
+/* -*-mode:c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+#ifndef TIMING_WHEEL_HH
+#define TIMING_WHEEL_HH
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+
+/* Items due at given times (us), in a hierarchical timing wheel
+   (Varghese and Lauck). Four levels of 256 slots reach 2^32 us (about
+   71 minutes) past the wheel's current time, and items due later wait
+   in an overflow list. A level-0 slot holds the items due in one
+   microsecond; a slot on a higher level holds a whole block of the
+   level below, and is spread over it when the wheel reaches that
+   block. advance() skips empty slots with a bitmap per level, so
+   insertion is O(1) and release is O(1) per item and per block
+   crossed, however many items are waiting and whatever their times.
+   Items due at the same time come out in the order they went in.
+
+   Items live in one pool, linked through it, so nothing is allocated
+   once the pool has grown to the largest backlog. */
+
+template <class T>
+class TimingWheel
+{
+private:
+    static const unsigned int LEVELS = 4;
+    static const unsigned int SLOT_BITS = 8;
+    static const unsigned int SLOTS = 1 << SLOT_BITS;
+    static const uint32_t NONE = -1;
+
+    struct Node
+    {
+        T item;
+        uint64_t time;
+        uint32_t next; /* in a slot, or in the free list */
+    };
+
+    struct List
+    {
+        uint32_t head = NONE, tail = NONE;
+    };
+
+    struct Level
+    {
+        std::array<List, SLOTS> slots {};
+        std::array<uint64_t, SLOTS / 64> occupied {};
+    };
+
+    std::vector<Node> pool_ {};
+    uint32_t free_ = NONE;
+
+    std::array<Level, LEVELS> levels_ {};
+    List overflow_ {};
+
+    uint64_t now_; /* everything due before this has been released */
+    size_t size_ = 0;
+
+    /* earliest(), kept between changes that could move it later */
+    struct Slot
+    {
+        unsigned int level, slot;
+        uint64_t start;
+    };
+    mutable Slot earliest_ {};
+    mutable bool earliest_known_ = false;
+
+    void append( List & list, const uint32_t node )
+    {
+        if ( list.tail == NONE ) {
+            list.head = node;
+        } else {
+            pool_[ list.tail ].next = node;
+        }
+        list.tail = node;
+    }
+
+    /* the level is chosen by the highest slot digit where the time differs from now */
+    Slot place( const uint32_t node )
+    {
+        const uint64_t time = pool_[ node ].time;
+        const uint64_t difference = time ^ now_;
+
+        for ( unsigned int level = 0; level < LEVELS; level++ ) {
+            const unsigned int shift = SLOT_BITS * level;
+            if ( difference >> ( shift + SLOT_BITS ) == 0 ) {
+                const unsigned int slot = ( time >> shift ) & ( SLOTS - 1 );
+                append( levels_[ level ].slots[ slot ], node );
+                levels_[ level ].occupied[ slot / 64 ] |= uint64_t( 1 ) << ( slot % 64 );
+                return { level, slot, time >> shift << shift };
+            }
+        }
+
+        append( overflow_, node );
+        return { LEVELS, 0, overflow_start() };
+    }
+
+    uint64_t overflow_start( void ) const
+    {
+        return ( ( now_ >> ( SLOT_BITS * LEVELS ) ) + 1 ) << ( SLOT_BITS * LEVELS );
+    }
+
+    /* the first occupied slot numbered at least from, or SLOTS if none */
+    static unsigned int first_occupied( const Level & level, const unsigned int from )
+    {
+        for ( unsigned int word = from / 64; word < SLOTS / 64; word++ ) {
+            uint64_t bits = level.occupied[ word ];
+            if ( word == from / 64 ) {
+                bits &= ~uint64_t( 0 ) << ( from % 64 );
+            }
+            if ( bits ) {
+                return word * 64 + __builtin_ctzll( bits );
+            }
+        }
+
+        return SLOTS;
+    }
+
+    /* The earliest occupied slot and the time its block starts, if
+       the wheel isn't empty. Every item on a level is due after every
+       item on the levels below, and a higher level's slot for the
+       current time is always empty (it was spread out when the wheel
+       reached it). */
+    const Slot * earliest( void ) const
+    {
+        if ( empty() ) {
+            return nullptr;
+        }
+
+        if ( earliest_known_ ) {
+            return &earliest_;
+        }
+
+        for ( unsigned int level = 0; level < LEVELS; level++ ) {
+            const unsigned int shift = SLOT_BITS * level;
+            const unsigned int current = ( now_ >> shift ) & ( SLOTS - 1 );
+            const unsigned int slot = first_occupied( levels_[ level ], level == 0 ? current : current + 1 );
+
+            if ( slot < SLOTS ) {
+                earliest_ = { level, slot, ( now_ >> ( shift + SLOT_BITS ) << ( shift + SLOT_BITS ) )
+                                           | ( uint64_t( slot ) << shift ) };
+                earliest_known_ = true;
+                return &earliest_;
+            }
+        }
+
+        if ( overflow_.head == NONE ) {
+            return nullptr; /* the rest are being released */
+        }
+
+        earliest_ = { LEVELS, 0, overflow_start() };
+        earliest_known_ = true;
+        return &earliest_;
+    }
+
+    List take( const unsigned int level, const unsigned int slot )
+    {
+        if ( level == LEVELS ) {
+            const List ret = overflow_;
+            overflow_ = List();
+            return ret;
+        }
+
+        const List ret = levels_[ level ].slots[ slot ];
+        levels_[ level ].slots[ slot ] = List();
+        levels_[ level ].occupied[ slot / 64 ] &= ~( uint64_t( 1 ) << ( slot % 64 ) );
+        return ret;
+    }
+
+public:
+    TimingWheel( const uint64_t now = 0 ) : now_( now ) {}
+
+    /* an item due before now() is due at now() */
+    void insert( const uint64_t time, T && item )
+    {
+        uint32_t node = free_;
+        if ( node == NONE ) {
+            node = pool_.size();
+            pool_.push_back( Node { std::move( item ), 0, NONE } );
+        } else {
+            free_ = pool_[ node ].next;
+            pool_[ node ].item = std::move( item );
+        }
+
+        pool_[ node ].time = std::max( time, now_ );
+        pool_[ node ].next = NONE;
+        const Slot slot = place( node );
+        size_++;
+
+        if ( size_ == 1 or ( earliest_known_ and slot.start < earliest_.start ) ) {
+            earliest_ = slot;
+            earliest_known_ = true;
+        }
+    }
+
+    /* hand release() every item due by time, in order of their times,
+       and move the wheel on to time; release() may insert more */
+    template <class Callback>
+    void advance( const uint64_t time, Callback && release )
+    {
+        const Slot * next;
+
+        while ( ( next = earliest() ) and next->start <= time ) {
+            const unsigned int level = next->level;
+            now_ = next->start;
+
+            const List list = take( level, next->slot );
+            earliest_known_ = false;
+            uint32_t node = list.head;
+            while ( node != NONE ) {
+                const uint32_t following = pool_[ node ].next;
+
+                if ( level == 0 ) {
+                    T item = std::move( pool_[ node ].item );
+                    pool_[ node ].next = free_;
+                    free_ = node;
+                    size_--;
+                    release( std::move( item ) );
+                } else {
+                    /* spread over the levels below */
+                    pool_[ node ].next = NONE;
+                    place( node );
+                }
+
+                node = following;
+            }
+        }
+
+        now_ = std::max( now_, time );
+    }
+
+    /* When the next item is due, or -1 if none. This is exact for
+       items due in the current 256 us; otherwise it is the start of
+       the block the earliest item is in, and advancing to it moves
+       the block's items down, after which the time is exact. */
+    uint64_t next_time( void ) const
+    {
+        const Slot * next = earliest();
+        return next ? next->start : -1;
+    }
+
+    uint64_t now( void ) const { return now_; }
+
+    size_t size( void ) const { return size_; }
+    bool empty( void ) const { return size_ == 0; }
+};
+
+template <class T> const unsigned int TimingWheel<T>::LEVELS;
+template <class T> const unsigned int TimingWheel<T>::SLOT_BITS;
+template <class T> const unsigned int TimingWheel<T>::SLOTS;
+template <class T> const uint32_t TimingWheel<T>::NONE;
+
+#endif /* TIMING_WHEEL_HH */
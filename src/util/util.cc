@@ -186,6 +186,35 @@ TemporarilyUnprivileged::~TemporarilyUnprivileged()
     SystemCall( "setegid", setegid( orig_egid ) );
 }
 
+TemporaryEnvironment::TemporaryEnvironment( char ** const env )
+{
+    if ( environ != nullptr ) {
+        throw runtime_error( "TemporaryEnvironment: cannot be entered recursively" );
+    }
+    environ = env;
+}
+
+TemporaryEnvironment::~TemporaryEnvironment()
+{
+    environ = nullptr;
+}
+
+/* quote an argument for sh, e.g. to record a command line in a log */
+string shell_quote( const string & arg )
+{
+    string ret = "'";
+    for ( const auto & ch : arg ) {
+        if ( ch != '\'' ) {
+            ret.push_back( ch );
+        } else {
+            ret += "'\\''";
+        }
+    }
+    ret += "'";
+
+    return ret;
+}
+
 string join( const vector< string > & command )
 {
     return accumulate( command.begin() + 1, command.end(),
@@ -208,16 +237,6 @@ string get_working_directory( void )
     return cwd_ptr.get();
 }
 
-int gcd(int a, int b) {
-    int c;
-    while (b != 0) {
-        c = b;
-        b = a % b;
-        a = c;
-    }
-    return a;
-}
-
 bool file_exists( const string& filename ) {
     ifstream f(filename.c_str());
     return f.good();
@@ -241,57 +260,3 @@ double str_to_mbps( string& bw ) {
 double bdp_bytes( double bw_mbps, double delay_ms ) {
     return ((bw_mbps * 1000000) / 8) * ((delay_ms * 2) / 1000);
 }
-
-void create_cbr_trace( string& bw, const string& trace_filename ) {
-
-    ofstream trace_file(trace_filename);
-    if (!trace_file.is_open()) {
-        throw runtime_error( "unable to create new cbr trace file " + trace_filename );
-    }
-
-    double mbps = str_to_mbps( bw );
-
-    double ppms   = mbps / 12.0;
-    int pps       = round(ppms * 1000.0);
-    int divisor   = gcd(pps, 1000);
-    int packets   = pps / divisor;
-    int num_slots = 1000 / divisor;
-    vector<int>     slots(num_slots, 0);
-    
-    if (packets >= num_slots) {
-        int i = 0;
-        while (packets > 0) {
-            slots[i % num_slots] += 1;
-            i++;
-            packets--;
-        }
-    } else {
-        int i = num_slots - 1;
-        int spacing = num_slots / packets;
-        while (packets > 0) {
-            slots[i] += 1;
-            i -= spacing;
-            packets--;
-        }
-    }
-
-    for (int ms = 0; ms < num_slots; ms++) {
-        if (slots[ms]) {
-            for (int j=0; j<slots[ms]; j++) {
-                trace_file << (ms + 1) << endl;
-            }
-        }
-    }
-
-    trace_file.close();
-}
-
-string get_cbr_trace( string& bw )
-{
-    string trace_filename = string(MACRO_AS_STR(TRACE_DIR)) + "/" + bw + ".cbr";
-    if (!file_exists(trace_filename)) {
-        create_cbr_trace( bw, trace_filename );
-    }
-    return trace_filename;
-}
-
@@ -24,11 +24,11 @@ std::vector< std::string > list_directory_contents( const std::string & dir );
 void prepend_shell_prefix( const std::string & str );
 template <typename T> void zero( T & x ) { memset( &x, 0, sizeof( x ) ); }
 std::string join( const std::vector< std::string > & command );
+std::string shell_quote( const std::string & arg );
 std::string get_working_directory( void );
 bool file_exists( const std::string& filename );
 double str_to_mbps( std::string& bw );
 double bdp_bytes( double bw_mbps, double delay_ms );
-std::string get_cbr_trace( std::string& bw );
 
 class TemporarilyUnprivileged {
 private:
@@ -40,6 +40,13 @@ public:
     ~TemporarilyUnprivileged();
 };
 
+/* briefly restore the user's environment (e.g. to read configuration) */
+class TemporaryEnvironment {
+public:
+    TemporaryEnvironment( char ** const env );
+    ~TemporaryEnvironment();
+};
+
 void assert_not_root( void );
 
 #endif /* UTIL_HH */